@@ -0,0 +1,883 @@
+#include "common/Window.h"
+#include "common/Shader.h"
+#include "common/Buffer.h"
+#include "common/FrameScheduler.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <algorithm>
+
+#define GLSL(src) "#version 440\n" #src
+
+
+
+typedef std::vector<unsigned char> Bytes;
+
+// A read-only memory mapping of a whole file.
+class MappedFile
+{
+private:
+	void * _data;
+	std::size_t _size;
+public:
+	MappedFile(const std::string& path) : _data(MAP_FAILED), _size(0)
+	{
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			return;
+		}
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			_size = st.st_size;
+			_data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (_data != MAP_FAILED)
+			{
+				madvise(_data, _size, MADV_SEQUENTIAL);
+			}
+		}
+		close(fd);
+	}
+	~MappedFile()
+	{
+		if (_data != MAP_FAILED)
+		{
+			munmap(_data, _size);
+		}
+	}
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	bool valid() const
+	{
+		return _data != MAP_FAILED;
+	}
+	const unsigned char * data() const
+	{
+		return static_cast<const unsigned char *>(_data);
+	}
+	std::size_t size() const
+	{
+		return _size;
+	}
+};
+
+
+// The result of reading and decoding one asset on an I/O thread.
+struct Decoded
+{
+	// Texture: RGBA8, level 0 first.
+	int width;
+	int height;
+	std::vector<std::shared_ptr<Bytes> > levels;
+	// Mesh: interleaved XYZ RGB floats and 32 bit indices, as in Cube1.
+	std::shared_ptr<Bytes> vertices;
+	std::shared_ptr<Bytes> indices;
+};
+
+// Binary PPM (P6) with 8 bit channels.
+static bool decodePPM(const MappedFile& file, Decoded& out)
+{
+	const unsigned char * p = file.data();
+	const unsigned char * end = p + file.size();
+	if (file.size() < 2 || p[0] != 'P' || p[1] != '6')
+	{
+		return false;
+	}
+	p += 2;
+	int values[3];
+	for (int i = 0; i < 3; i++)
+	{
+		while (p < end && (isspace(*p) || *p == '#'))
+		{
+			if (*p == '#')
+			{
+				while (p < end && *p != '\n')
+				{
+					p++;
+				}
+			}
+			else
+			{
+				p++;
+			}
+		}
+		values[i] = 0;
+		while (p < end && isdigit(*p))
+		{
+			values[i] = values[i] * 10 + (*p++ - '0');
+		}
+	}
+	p++;
+	int width = values[0];
+	int height = values[1];
+	if (width <= 0 || height <= 0 || values[2] != 255 || end - p < std::ptrdiff_t(width) * height * 3)
+	{
+		return false;
+	}
+	std::shared_ptr<Bytes> level(new Bytes(std::size_t(width) * height * 4));
+	unsigned char * d = &(*level)[0];
+	for (int i = 0; i < width * height; i++)
+	{
+		d[i * 4 + 0] = p[i * 3 + 0];
+		d[i * 4 + 1] = p[i * 3 + 1];
+		d[i * 4 + 2] = p[i * 3 + 2];
+		d[i * 4 + 3] = 255;
+	}
+	out.width = width;
+	out.height = height;
+	out.levels.push_back(level);
+	return true;
+}
+
+// Box filter down to 1x1.
+static void generateMipmaps(Decoded& d)
+{
+	int w = d.width;
+	int h = d.height;
+	while (w > 1 || h > 1)
+	{
+		int nw = w > 1 ? w / 2 : 1;
+		int nh = h > 1 ? h / 2 : 1;
+		const Bytes& src = *d.levels.back();
+		std::shared_ptr<Bytes> level(new Bytes(std::size_t(nw) * nh * 4));
+		for (int y = 0; y < nh; y++)
+		{
+			int y0 = std::min(y * 2, h - 1);
+			int y1 = std::min(y * 2 + 1, h - 1);
+			for (int x = 0; x < nw; x++)
+			{
+				int x0 = std::min(x * 2, w - 1);
+				int x1 = std::min(x * 2 + 1, w - 1);
+				for (int c = 0; c < 4; c++)
+				{
+					int sum = src[(y0 * w + x0) * 4 + c] + src[(y0 * w + x1) * 4 + c]
+						+ src[(y1 * w + x0) * 4 + c] + src[(y1 * w + x1) * 4 + c];
+					(*level)[(y * nw + x) * 4 + c] = (sum + 2) / 4;
+				}
+			}
+		}
+		d.levels.push_back(level);
+		w = nw;
+		h = nh;
+	}
+}
+
+// Header: "MESH", vertex count, index count (little endian uint32), then the
+// vertices as 6 floats each and the indices as uint32.
+static bool decodeMesh(const MappedFile& file, Decoded& out)
+{
+	const unsigned char * p = file.data();
+	uint32_t header[3];
+	if (file.size() < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(header, p, sizeof(header));
+	std::size_t vertexBytes = std::size_t(header[1]) * 6 * sizeof(float);
+	std::size_t indexBytes = std::size_t(header[2]) * sizeof(uint32_t);
+	if (memcmp(p, "MESH", 4) != 0 || file.size() < sizeof(header) + vertexBytes + indexBytes)
+	{
+		return false;
+	}
+	p += sizeof(header);
+	out.vertices.reset(new Bytes(p, p + vertexBytes));
+	out.indices.reset(new Bytes(p + vertexBytes, p + vertexBytes + indexBytes));
+	return true;
+}
+
+
+// A persistently mapped pixel unpack buffer used as a ring. Every frame's
+// uploads are fenced; space is reclaimed once the GPU has consumed them.
+class StagingRing
+{
+private:
+	struct Segment
+	{
+		GLsync fence;
+		std::size_t end;
+	};
+	GLuint _buffer;
+	unsigned char * _memory;
+	std::size_t _size;
+	std::size_t _head;
+	std::size_t _tail;
+	std::size_t _frameStart;
+	std::deque<Segment> _segments;
+public:
+	StagingRing(std::size_t size) : _size(size), _head(0), _tail(0), _frameStart(0)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &_buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+		_memory = static_cast<unsigned char *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (_memory == NULL)
+		{
+			throw 0;
+		}
+	}
+	~StagingRing()
+	{
+		for (std::size_t i = 0; i < _segments.size(); i++)
+		{
+			glDeleteSync(_segments[i].fence);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &_buffer);
+	}
+	GLuint buffer() const
+	{
+		return _buffer;
+	}
+	std::size_t size() const
+	{
+		return _size;
+	}
+	unsigned char * memory(std::size_t offset) const
+	{
+		return _memory + offset;
+	}
+	// Release the space of every frame the GPU has finished with.
+	void reclaim()
+	{
+		while (!_segments.empty())
+		{
+			GLenum status = glClientWaitSync(_segments.front().fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			{
+				break;
+			}
+			glDeleteSync(_segments.front().fence);
+			_tail = _segments.front().end;
+			_segments.pop_front();
+		}
+		if (_segments.empty() && _head == _frameStart)
+		{
+			_head = _tail = _frameStart = 0;
+		}
+	}
+	// Returns false if n bytes do not fit until more frames are reclaimed.
+	bool allocate(std::size_t n, std::size_t& offset)
+	{
+		n = (n + 255) & ~std::size_t(255);
+		bool empty = _segments.empty() && _head == _frameStart && _head == _tail;
+		if (empty || _head >= _tail)
+		{
+			if (_head + n <= _size)
+			{
+				offset = _head;
+			}
+			else if (n < _tail || (empty && n <= _size))
+			{
+				offset = 0;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (_head + n < _tail)
+		{
+			offset = _head;
+		}
+		else
+		{
+			return false;
+		}
+		_head = offset + n;
+		return true;
+	}
+	// Fence everything allocated since the last call.
+	void fence()
+	{
+		if (_head == _frameStart)
+		{
+			return;
+		}
+		Segment s = {glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), _head};
+		_segments.push_back(s);
+		_frameStart = _head;
+	}
+};
+
+
+// Loads textures (.ppm) and meshes (.mesh) in the background and uploads
+// them progressively.
+//
+// I/O threads map and decode files and build the mip chain. The GL thread
+// calls update() once per frame; it copies the pending pieces into the
+// staging ring and issues the uploads, smallest first so that every texture
+// shows its coarse mips before any texture gets its full resolution, and
+// stops once the frame's byte or time budget is spent. Pieces larger than a
+// quarter of the ring go up in parts, whole rows for textures, so a full
+// resolution level never has to fit at once.
+class AssetStreamer
+{
+public:
+	enum Type
+	{
+		TEXTURE,
+		MESH
+	};
+	struct Asset
+	{
+		Type type;
+		std::string path;
+		bool failed;
+		// Texture
+		GLuint texture;
+		int width;
+		int height;
+		int levels;
+		// Lowest mip level whose chain is complete, levels if none. Stays
+		// above 0 if a row of a finer level does not fit the staging ring.
+		int resident;
+		// Mesh
+		GLuint vertexBuffer;
+		GLuint indexBuffer;
+		GLsizei indexCount;
+		int parts;
+	};
+	struct Budget
+	{
+		std::size_t bytes;
+		double microseconds;
+	};
+	struct Stats
+	{
+		std::size_t bytes;
+		std::size_t uploads;
+		double microseconds;
+	};
+private:
+	struct Piece
+	{
+		int asset;
+		// Mip level, or 0 for vertices and 1 for indices.
+		int part;
+		std::shared_ptr<Bytes> data;
+		// Bytes of data already uploaded.
+		std::size_t begin;
+		bool operator<(const Piece& other) const
+		{
+			// Smallest on top of the priority queue.
+			return data->size() > other.data->size();
+		}
+	};
+	struct Result
+	{
+		int asset;
+		bool ok;
+		Decoded decoded;
+	};
+
+	std::vector<std::unique_ptr<Asset> > _assets;
+	StagingRing _ring;
+	Budget _budget;
+	Stats _stats;
+
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::deque<int> _requests;
+	std::vector<Result> _results;
+	std::vector<std::thread> _threads;
+	bool _running;
+
+	std::vector<Result> _incoming;
+	std::priority_queue<Piece> _pieces;
+
+	void work()
+	{
+		for (;;)
+		{
+			int index;
+			std::string path;
+			Type type;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				while (_running && _requests.empty())
+				{
+					_wake.wait(lock);
+				}
+				if (!_running)
+				{
+					return;
+				}
+				index = _requests.front();
+				_requests.pop_front();
+				path = _assets[index]->path;
+				type = _assets[index]->type;
+			}
+			Result r;
+			r.asset = index;
+			MappedFile file(path);
+			r.ok = file.valid();
+			if (r.ok && type == TEXTURE)
+			{
+				r.ok = decodePPM(file, r.decoded);
+				if (r.ok)
+				{
+					generateMipmaps(r.decoded);
+				}
+			}
+			else if (r.ok)
+			{
+				r.ok = decodeMesh(file, r.decoded);
+			}
+			std::lock_guard<std::mutex> lock(_mutex);
+			_results.push_back(r);
+		}
+	}
+	// Create the GL objects for a decoded asset and queue its pieces.
+	void accept(Result& r)
+	{
+		Asset& a = *_assets[r.asset];
+		if (!r.ok)
+		{
+			std::cerr << a.path << ": could not be loaded" << std::endl;
+			a.failed = true;
+			return;
+		}
+		if (a.type == TEXTURE)
+		{
+			a.width = r.decoded.width;
+			a.height = r.decoded.height;
+			a.levels = r.decoded.levels.size();
+			a.resident = a.levels;
+			glGenTextures(1, &a.texture);
+			glBindTexture(GL_TEXTURE_2D, a.texture);
+			glTexStorage2D(GL_TEXTURE_2D, a.levels, GL_RGBA8, a.width, a.height);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, a.levels - 1);
+			for (int level = 0; level < a.levels; level++)
+			{
+				Piece p = {r.asset, level, r.decoded.levels[level], 0};
+				_pieces.push(p);
+			}
+		}
+		else
+		{
+			GLuint buffers[2];
+			glGenBuffers(2, buffers);
+			a.vertexBuffer = buffers[0];
+			a.indexBuffer = buffers[1];
+			a.indexCount = r.decoded.indices->size() / sizeof(uint32_t);
+			a.parts = 0;
+			glBindBuffer(GL_COPY_WRITE_BUFFER, a.vertexBuffer);
+			glBufferStorage(GL_COPY_WRITE_BUFFER, std::max<std::size_t>(r.decoded.vertices->size(), 1), NULL, 0);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, a.indexBuffer);
+			glBufferStorage(GL_COPY_WRITE_BUFFER, std::max<std::size_t>(r.decoded.indices->size(), 1), NULL, 0);
+			Piece v = {r.asset, 0, r.decoded.vertices, 0};
+			Piece i = {r.asset, 1, r.decoded.indices, 0};
+			_pieces.push(v);
+			_pieces.push(i);
+		}
+	}
+	// Bytes of a texture level's row, 0 for meshes.
+	std::size_t row(const Piece& p) const
+	{
+		const Asset& a = *_assets[p.asset];
+		return a.type == TEXTURE ? std::size_t(std::max(a.width >> p.part, 1)) * 4 : 0;
+	}
+	// Upload size bytes of p from p.begin on.
+	void upload(const Piece& p, std::size_t offset, std::size_t size)
+	{
+		Asset& a = *_assets[p.asset];
+		bool complete = p.begin + size == p.data->size();
+		if (size > 0)
+		{
+			memcpy(_ring.memory(offset), p.data->data() + p.begin, size);
+		}
+		if (a.type == TEXTURE)
+		{
+			int w = std::max(a.width >> p.part, 1);
+			int y = p.begin / row(p);
+			int h = size / row(p);
+			glBindTexture(GL_TEXTURE_2D, a.texture);
+			glTexSubImage2D(GL_TEXTURE_2D, p.part, 0, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, (char*)0 + offset);
+			if (complete)
+			{
+				// Pieces come smallest first, so every coarser level is in place.
+				a.resident = p.part;
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, a.resident);
+			}
+		}
+		else
+		{
+			if (size > 0)
+			{
+				glBindBuffer(GL_COPY_WRITE_BUFFER, p.part == 0 ? a.vertexBuffer : a.indexBuffer);
+				glCopyBufferSubData(GL_PIXEL_UNPACK_BUFFER, GL_COPY_WRITE_BUFFER, offset, p.begin, size);
+			}
+			if (complete)
+			{
+				a.parts++;
+			}
+		}
+	}
+public:
+	AssetStreamer(unsigned threads, std::size_t ring, Budget budget) : _ring(ring), _budget(budget), _running(true)
+	{
+		Stats s = {0, 0, 0};
+		_stats = s;
+		for (unsigned i = 0; i < threads; i++)
+		{
+			_threads.push_back(std::thread(&AssetStreamer::work, this));
+		}
+	}
+	~AssetStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_running = false;
+		}
+		_wake.notify_all();
+		for (std::size_t i = 0; i < _threads.size(); i++)
+		{
+			_threads[i].join();
+		}
+		for (std::size_t i = 0; i < _assets.size(); i++)
+		{
+			Asset& a = *_assets[i];
+			glDeleteTextures(1, &a.texture);
+			glDeleteBuffers(1, &a.vertexBuffer);
+			glDeleteBuffers(1, &a.indexBuffer);
+		}
+	}
+	int load(Type type, const std::string& path)
+	{
+		std::unique_ptr<Asset> a(new Asset());
+		a->type = type;
+		a->path = path;
+		a->failed = false;
+		a->texture = 0;
+		a->width = a->height = a->levels = a->resident = 0;
+		a->vertexBuffer = a->indexBuffer = 0;
+		a->indexCount = 0;
+		a->parts = 0;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_assets.push_back(std::move(a));
+			_requests.push_back(_assets.size() - 1);
+		}
+		_wake.notify_one();
+		return _assets.size() - 1;
+	}
+	// Only valid on the GL thread.
+	const Asset& asset(int index) const
+	{
+		return *_assets[index];
+	}
+	std::size_t size() const
+	{
+		return _assets.size();
+	}
+	bool idle() const
+	{
+		return _pieces.empty();
+	}
+	const Stats& stats() const
+	{
+		return _stats;
+	}
+	// Upload as much as the budget allows. Call once per frame on the GL
+	// thread; never waits for the I/O threads or the GPU.
+	void update()
+	{
+		typedef std::chrono::steady_clock Clock;
+		Clock::time_point start = Clock::now();
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_incoming.swap(_results);
+		}
+		for (std::size_t i = 0; i < _incoming.size(); i++)
+		{
+			accept(_incoming[i]);
+		}
+		_incoming.clear();
+
+		_ring.reclaim();
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _ring.buffer());
+		std::size_t bytes = 0;
+		while (!_pieces.empty())
+		{
+			Piece p = _pieces.top();
+			std::size_t size = std::min(p.data->size() - p.begin, _ring.size() / 4);
+			std::size_t line = row(p);
+			if (line > _ring.size())
+			{
+				// So are the rows of every finer level: draw this texture
+				// from the levels already resident.
+				Asset& a = *_assets[p.asset];
+				if (p.part == a.resident - 1)
+				{
+					std::cerr << a.path << ": level " << p.part << " rows larger than the staging ring, staying at level "
+						<< a.resident << std::endl;
+				}
+				_pieces.pop();
+				continue;
+			}
+			if (line > 0)
+			{
+				size = std::max(size / line, std::size_t(1)) * line;
+			}
+			// Always let one part through, so one larger than the budget
+			// still makes progress.
+			if (bytes > 0 && bytes + size > _budget.bytes)
+			{
+				break;
+			}
+			double spent = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+			if (bytes > 0 && spent > _budget.microseconds)
+			{
+				break;
+			}
+			std::size_t offset;
+			if (!_ring.allocate(size, offset))
+			{
+				break;
+			}
+			upload(p, offset, size);
+			bytes += size;
+			_stats.uploads++;
+			_pieces.pop();
+			p.begin += size;
+			if (p.begin < p.data->size())
+			{
+				_pieces.push(p);
+			}
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		_ring.fence();
+		_stats.bytes += bytes;
+		_stats.microseconds += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	}
+};
+
+
+
+static void error_callback(int error, const char* description)
+{
+	fputs(description, stderr);
+}
+
+static bool endsWith(const std::string& s, const std::string& suffix)
+{
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static ShaderProgram program(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	VertexShader vertexShader;
+	FragmentShader fragmentShader;
+	vertexShader.source(vertexSource);
+	fragmentShader.source(fragmentSource);
+	vertexShader.compile();
+	fragmentShader.compile();
+	ShaderProgram program;
+	program.attach(vertexShader);
+	program.attach(fragmentShader);
+	program.link();
+	program.detach(vertexShader);
+	program.detach(fragmentShader);
+	vertexShader.destroy();
+	fragmentShader.destroy();
+	if (!program.status())
+	{
+		std::string errorMsg;
+		program.info(errorMsg);
+		std::cerr << errorMsg;
+		program.destroy();
+	}
+	return program;
+}
+
+
+// Usage: AssetStreaming [file.ppm | file.mesh]...
+// --pacing and --rate as in FrameScheduler.h may come first.
+int main(int argc, char** argv) {
+
+	Window::init();
+	Window window(640, 480, "Title");
+	glfwSetErrorCallback(error_callback);
+	window.current();
+	FrameScheduler scheduler(argc, argv, window);
+
+	ShaderProgram textured = program(GLSL
+	(
+		layout(location = 0) in vec2 vposition;
+		layout(location = 0) uniform vec4 rect;
+		out vec2 ftexcoord;
+		void main()
+		{
+			ftexcoord = vec2(vposition.x, 1.0 - vposition.y);
+			gl_Position = vec4(rect.xy + vposition * rect.zw, 0.0, 1.0);
+		}
+	), GLSL
+	(
+		in vec2 ftexcoord;
+		layout(binding = 0) uniform sampler2D image;
+		layout(location = 0) out vec4 FragColor;
+		void main()
+		{
+			FragColor = texture(image, ftexcoord);
+		}
+	));
+	ShaderProgram colored = program(GLSL
+	(
+		layout(location = 0) in vec4 vposition;
+		layout(location = 1) in vec4 vcolor;
+		out vec4 fcolor;
+		void main()
+		{
+			fcolor = vcolor;
+			gl_Position = vposition;
+		}
+	), GLSL
+	(
+		in vec4 fcolor;
+		layout(location = 0) out vec4 FragColor;
+		void main()
+		{
+			FragColor = fcolor;
+		}
+	));
+	if (textured.id() == 0 || colored.id() == 0)
+	{
+		textured.destroy();
+		colored.destroy();
+		scheduler.destroy();
+		window.destroy();
+		Window::terminate();
+		return 1;
+	}
+
+	VertexArray quad;
+	quad.bind();
+	ArrayBuffer quadBuffer;
+	quadBuffer.bind();
+	GLfloat quadData[] =
+	{
+		0.0f, 0.0f,
+		1.0f, 0.0f,
+		0.0f, 1.0f,
+		1.0f, 1.0f,
+	};
+	ArrayBuffer::staticData(sizeof(quadData), quadData);
+	VertexAttribute<0>::enable();
+	VertexAttribute<0>::set(2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (char*)0);
+
+	VertexArray meshes;
+
+	int result = 0;
+	{
+		AssetStreamer::Budget budget = {4 << 20, 2000.0};
+		AssetStreamer streamer(2, 64 << 20, budget);
+		for (int i = 1; i < argc; i++)
+		{
+			std::string path = argv[i];
+			if (path == "--pacing" || path == "--rate")
+			{
+				i++;
+				continue;
+			}
+			streamer.load(endsWith(path, ".mesh") ? AssetStreamer::MESH : AssetStreamer::TEXTURE, path);
+		}
+		int columns = 1;
+		while (columns * columns < int(streamer.size()))
+		{
+			columns++;
+		}
+
+		double worst = 0;
+		unsigned long frames = 0;
+		while (scheduler.wait())
+		{
+			double before = streamer.stats().microseconds;
+			streamer.update();
+			worst = std::max(worst, streamer.stats().microseconds - before);
+
+			glClear(GL_COLOR_BUFFER_BIT);
+			for (std::size_t i = 0; i < streamer.size(); i++)
+			{
+				const AssetStreamer::Asset& a = streamer.asset(i);
+				if (a.failed)
+				{
+					continue;
+				}
+				if (a.type == AssetStreamer::TEXTURE && a.resident < a.levels)
+				{
+					float size = 2.0f / columns;
+					textured.use();
+					glUniform4f(0, -1.0f + size * (i % columns), 1.0f - size * (i / columns + 1), size, size);
+					glActiveTexture(GL_TEXTURE0);
+					glBindTexture(GL_TEXTURE_2D, a.texture);
+					quad.bind();
+					glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+				}
+				else if (a.type == AssetStreamer::MESH && a.parts == 2)
+				{
+					colored.use();
+					meshes.bind();
+					glBindBuffer(GL_ARRAY_BUFFER, a.vertexBuffer);
+					VertexAttribute<0>::enable();
+					VertexAttribute<0>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0);
+					VertexAttribute<1>::enable();
+					VertexAttribute<1>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0 + 3 * sizeof(GLfloat));
+					glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, a.indexBuffer);
+					VertexArray::drawElements(GL_TRIANGLES, a.indexCount, GL_UNSIGNED_INT, 0);
+				}
+			}
+
+			GLenum error = glGetError();
+			if (error != GL_NO_ERROR)
+			{
+				std::cerr << error << std::endl;
+				result = 1;
+				break;
+			}
+			scheduler.present();
+			frames++;
+		}
+
+		const AssetStreamer::Stats& stats = streamer.stats();
+		std::cout << "frames:             " << frames << std::endl;
+		std::cout << "uploaded:           " << stats.bytes << " bytes in " << stats.uploads << " uploads" << std::endl;
+		std::cout << "worst frame upload: " << worst << " us" << std::endl;
+	}
+
+	quad.destroy();
+	meshes.destroy();
+	quadBuffer.destroy();
+	textured.destroy();
+	colored.destroy();
+	scheduler.destroy();
+	window.destroy();
+	Window::terminate();
+	return result;
+}
@@ -0,0 +1,504 @@
+#include "common/Window.h"
+#include "common/Shader.h"
+#include "common/Buffer.h"
+#include "common/Matrix4f.h"
+#include "common/Uniform.h"
+#include "common/SimdTrig.h"
+#include "common/LightClusters.h"
+#include "common/Random.h"
+#include "common/FrameScheduler.h"
+#include "common/GpuTimer.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+
+#define GLSL(src) "#version 430\n" #src
+
+
+
+// Clustered forward shading: a field of cubes lit by thousands of moving
+// point lights. Every frame the lights are assigned to the clusters of
+// LightClusters, either on the CPU or by a compute shader, and each pixel
+// only shades the lights of its own cluster.
+//
+//   --lights N    number of lights, 2048 by default
+//   --assign M    cpu (default), gpu, or all for every light at every pixel
+//   --heat        show the number of lights per pixel instead of shading
+//   --pacing, --rate as in FrameScheduler.h
+
+static constexpr float NEAR = 0.5f;
+static constexpr float FAR = 100.0f;
+static constexpr float RIGHT = 0.4f;
+static constexpr float TOP = 0.3f;
+
+// Per cluster slots of the compute path, which writes cluster * CAPACITY
+// onwards instead of packing the list. Lights beyond it are dropped.
+static const GLuint CAPACITY = 128;
+
+static const int COLUMNS = 24;
+static constexpr float SPACING = 4.0f;
+
+static constexpr Matrix4f projection = []
+{
+	Matrix4f m;
+	m.perspective(NEAR, FAR, RIGHT, TOP);
+	return m;
+}();
+
+
+enum Assign
+{
+	ASSIGN_CPU,
+	ASSIGN_GPU,
+	ASSIGN_ALL
+};
+
+struct Vertex
+{
+	GLfloat position[3];
+	GLfloat normal[3];
+};
+
+// A unit cube standing on y = 0 followed by the floor, four vertices per face.
+static void geometry(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+	static const float faces[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+	for (int f = 0; f < 7; f++)
+	{
+		const float * n = f < 6 ? faces[f] : faces[2];
+		// Two axes spanning the face.
+		float u[3] = {n[0] != 0 ? 0.0f : 1.0f, 0, n[0] != 0 ? 1.0f : 0.0f};
+		float v[3] = {n[1] * u[2] - n[2] * u[1], n[2] * u[0] - n[0] * u[2], n[0] * u[1] - n[1] * u[0]};
+		GLuint base = vertices.size();
+		for (int c = 0; c < 4; c++)
+		{
+			float su = c & 1 ? 0.5f : -0.5f;
+			float sv = c & 2 ? 0.5f : -0.5f;
+			Vertex vertex;
+			for (int a = 0; a < 3; a++)
+			{
+				if (f < 6)
+				{
+					vertex.position[a] = 0.5f * n[a] + su * u[a] + sv * v[a] + (a == 1 ? 0.5f : 0.0f);
+				}
+				else
+				{
+					vertex.position[a] = (su * u[a] + sv * v[a]) * COLUMNS * SPACING * 2 + (a == 2 ? -FAR * 0.5f : 0.0f);
+				}
+				vertex.normal[a] = n[a];
+			}
+			vertices.push_back(vertex);
+		}
+		GLuint quad[6] = {base, base + 1, base + 3, base, base + 3, base + 2};
+		indices.insert(indices.end(), quad, quad + 6);
+	}
+}
+
+static void error_callback(int error, const char* description)
+{
+	fputs(description, stderr);
+}
+
+template <GLenum TYPE>
+static void compile(Shader<TYPE>& shader, const std::string& source)
+{
+	shader.source(source);
+	shader.compile();
+	if (!shader.status())
+	{
+		std::string errorMsg;
+		shader.info(errorMsg);
+		std::cerr << errorMsg;
+	}
+}
+
+// Leaves the program without a name if it does not link.
+static void link(ShaderProgram& program)
+{
+	program.link();
+	if (!program.status())
+	{
+		std::string errorMsg;
+		program.info(errorMsg);
+		std::cerr << errorMsg;
+		program.destroy();
+	}
+}
+
+static ShaderProgram program(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	VertexShader vertexShader;
+	FragmentShader fragmentShader;
+	compile(vertexShader, vertexSource);
+	compile(fragmentShader, fragmentSource);
+	ShaderProgram p;
+	p.attach(vertexShader);
+	p.attach(fragmentShader);
+	link(p);
+	vertexShader.destroy();
+	fragmentShader.destroy();
+	return p;
+}
+
+static ShaderProgram program(const std::string& computeSource)
+{
+	ComputeShader computeShader;
+	compile(computeShader, computeSource);
+	ShaderProgram p;
+	p.attach(computeShader);
+	link(p);
+	computeShader.destroy();
+	return p;
+}
+
+
+int main(int argc, char** argv) {
+
+	std::size_t count = 2048;
+	Assign assign = ASSIGN_CPU;
+	bool heat = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--lights" && i + 1 < argc)
+		{
+			count = std::max(1, atoi(argv[++i]));
+		}
+		else if (arg == "--assign" && i + 1 < argc)
+		{
+			std::string mode = argv[++i];
+			assign = mode == "gpu" ? ASSIGN_GPU : mode == "all" ? ASSIGN_ALL : ASSIGN_CPU;
+		}
+		else if (arg == "--heat")
+		{
+			heat = true;
+		}
+	}
+
+	Window::init();
+	Window window(640, 480, "Title");
+	glfwSetErrorCallback(error_callback);
+	window.current();
+	FrameScheduler scheduler(argc, argv, window);
+
+	ShaderProgram shade = program(GLSL
+	(
+		layout(location = 0) in vec3 vposition;
+		layout(location = 1) in vec3 vnormal;
+		layout(location = 0) uniform mat4 projection;
+		layout(location = 1) uniform mat4 view;
+		layout(location = 2) uniform vec4 instances;
+		out vec3 fposition;
+		out vec3 fnormal;
+		void main()
+		{
+			vec3 p = vposition;
+			if (instances.w > 0.0)
+			{
+				float i = float(gl_InstanceID);
+				p += vec3(instances.x + mod(i, instances.w) * instances.z, 0.0, instances.y - floor(i / instances.w) * instances.z);
+			}
+			vec4 v = view * vec4(p, 1.0);
+			fposition = v.xyz;
+			fnormal = mat3(view) * vnormal;
+			gl_Position = projection * v;
+		}
+	), GLSL
+	(
+		struct Light
+		{
+			vec4 position;
+			vec4 color;
+		};
+		layout(std430, binding = 0) readonly buffer Lights { Light lights[]; };
+		layout(std430, binding = 1) readonly buffer Grid { uvec2 grid[]; };
+		layout(std430, binding = 2) readonly buffer Indices { uint indices[]; };
+		layout(location = 3) uniform vec4 clusters;
+		layout(location = 4) uniform int heat;
+		in vec3 fposition;
+		in vec3 fnormal;
+		layout(location = 0) out vec4 FragColor;
+		const uvec3 SIZE = uvec3(16, 9, 24);
+		void main()
+		{
+			// clusters: near, slice scale, tile width and height in pixels.
+			float slice = max(log(-fposition.z / clusters.x) * clusters.y, 0.0);
+			uvec3 c = min(uvec3(uvec2(gl_FragCoord.xy / clusters.zw), uint(slice)), SIZE - 1u);
+			uvec2 range = grid[(c.z * SIZE.y + c.y) * SIZE.x + c.x];
+			vec3 n = normalize(fnormal);
+			vec3 color = vec3(0.02);
+			for (uint i = range.x; i < range.x + range.y; i++)
+			{
+				Light light = lights[indices[i]];
+				vec3 l = light.position.xyz - fposition;
+				float d = length(l);
+				float falloff = clamp(1.0 - d / light.position.w, 0.0, 1.0);
+				color += light.color.rgb * light.color.a * max(dot(n, l / d), 0.0) * falloff * falloff;
+			}
+			if (heat != 0)
+			{
+				color = mix(vec3(0.0, 0.0, 0.2), vec3(1.0, 0.2, 0.0), min(float(range.y) / 64.0, 1.0));
+			}
+			FragColor = vec4(color, 1.0);
+		}
+	));
+	// One invocation per cluster. The lights pass through shared memory in
+	// batches of 64, every invocation tests the whole batch against its
+	// cluster's bounds.
+	ShaderProgram cull = program(GLSL
+	(
+		layout(local_size_x = 64) in;
+		struct Light
+		{
+			vec4 position;
+			vec4 color;
+		};
+		layout(std430, binding = 0) readonly buffer Lights { Light lights[]; };
+		layout(std430, binding = 1) writeonly buffer Grid { uvec2 grid[]; };
+		layout(std430, binding = 2) writeonly buffer Indices { uint indices[]; };
+		layout(std430, binding = 3) readonly buffer Bounds { vec4 bounds[]; };
+		layout(location = 0) uniform uint lightCount;
+		layout(location = 1) uniform uint clusterCount;
+		layout(location = 2) uniform uint capacity;
+		shared vec4 batch[64];
+		void main()
+		{
+			uint cluster = gl_GlobalInvocationID.x;
+			bool inside = cluster < clusterCount;
+			vec3 lo = vec3(0.0);
+			vec3 hi = vec3(0.0);
+			if (inside)
+			{
+				lo = bounds[2u * cluster].xyz;
+				hi = bounds[2u * cluster + 1u].xyz;
+			}
+			uint found = 0u;
+			for (uint base = 0u; base < lightCount; base += 64u)
+			{
+				uint i = base + gl_LocalInvocationIndex;
+				batch[gl_LocalInvocationIndex] = i < lightCount ? lights[i].position : vec4(0.0);
+				barrier();
+				uint size = min(64u, lightCount - base);
+				for (uint k = 0u; k < size; k++)
+				{
+					vec4 s = batch[k];
+					vec3 d = max(max(lo - s.xyz, s.xyz - hi), vec3(0.0));
+					if (inside && found < capacity && dot(d, d) <= s.w * s.w)
+					{
+						indices[cluster * capacity + found] = base + k;
+						found++;
+					}
+				}
+				barrier();
+			}
+			if (inside)
+			{
+				grid[cluster] = uvec2(cluster * capacity, found);
+			}
+		}
+	));
+	if (shade.id() == 0 || cull.id() == 0)
+	{
+		shade.destroy();
+		cull.destroy();
+		scheduler.destroy();
+		window.destroy();
+		Window::terminate();
+		return 1;
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<GLuint> indices;
+	geometry(vertices, indices);
+	VertexArray va;
+	va.bind();
+	ArrayBuffer vb;
+	vb.bind();
+	ArrayBuffer::staticData(vertices.size() * sizeof(Vertex), vertices.data());
+	VertexAttribute<0>::enable();
+	VertexAttribute<0>::set(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (char*)0);
+	VertexAttribute<1>::enable();
+	VertexAttribute<1>::set(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (char*)0 + 3 * sizeof(GLfloat));
+	ElementArrayBuffer ib;
+	ib.bind();
+	ElementArrayBuffer::staticData(indices.size() * sizeof(GLuint), indices.data());
+
+	// Lights circle around random points above the floor.
+	Random random(7);
+	std::vector<float> centers(3 * count), speeds(count), angles(count), sines(count), cosines(count);
+	std::vector<PointLight> lights(count);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		centers[3 * i] = (random.uniform() - 0.5f) * COLUMNS * SPACING;
+		centers[3 * i + 1] = 0.3f + 2.0f * random.uniform();
+		centers[3 * i + 2] = -2.0f - random.uniform() * COLUMNS * SPACING;
+		speeds[i] = 0.5f + random.uniform();
+		angles[i] = 6.2831853f * random.uniform();
+		lights[i].radius = 2.0f + 3.0f * random.uniform();
+		lights[i].r = random.uniform();
+		lights[i].g = random.uniform();
+		lights[i].b = random.uniform();
+		lights[i].intensity = 0.8f;
+	}
+
+	Matrix4f view;
+	view.identity();
+	view.translate(0, -3.0f, 0);
+
+	LightClusters clusters(NEAR, FAR, RIGHT, TOP);
+	std::vector<float> bounds;
+	clusters.bounds(bounds);
+
+	ShaderStorageBuffer lightBuffer, gridBuffer, indexBuffer, boundsBuffer;
+	lightBuffer.bind();
+	ShaderStorageBuffer::data(count * sizeof(PointLight), NULL, GL_STREAM_DRAW);
+	lightBuffer.bindBase(0);
+	gridBuffer.bind();
+	ShaderStorageBuffer::data(LightClusters::COUNT * 2 * sizeof(GLuint), NULL, GL_STREAM_DRAW);
+	gridBuffer.bindBase(1);
+	indexBuffer.bind();
+	indexBuffer.bindBase(2);
+	boundsBuffer.bind();
+	ShaderStorageBuffer::staticData(bounds.size() * sizeof(float), bounds.data());
+	boundsBuffer.bindBase(3);
+	// With every light at every pixel the grid and list never change.
+	if (assign == ASSIGN_ALL)
+	{
+		std::vector<GLuint> grid(LightClusters::COUNT * 2), all(count);
+		for (int c = 0; c < LightClusters::COUNT; c++)
+		{
+			grid[2 * c + 1] = count;
+		}
+		for (std::size_t i = 0; i < count; i++)
+		{
+			all[i] = i;
+		}
+		gridBuffer.bind();
+		ShaderStorageBuffer::data(grid.size() * sizeof(GLuint), grid.data(), GL_STATIC_DRAW);
+		indexBuffer.bind();
+		ShaderStorageBuffer::staticData(all.size() * sizeof(GLuint), all.data());
+	}
+	else if (assign == ASSIGN_GPU)
+	{
+		indexBuffer.bind();
+		ShaderStorageBuffer::data(LightClusters::COUNT * CAPACITY * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	}
+
+	GpuTimer timer;
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+
+	int result = 0;
+	unsigned long frames = 0;
+	double cpuMs = 0;
+	std::size_t references = 0;
+	uint32_t densest = 0;
+	while (scheduler.wait())
+	{
+
+		// Move the lights and bring them to view space.
+		for (std::size_t i = 0; i < count; i++)
+		{
+			angles[i] += speeds[i] * 0.01f;
+		}
+		SimdTrig<TRIG_LOW>::sincos(angles.data(), sines.data(), cosines.data(), count);
+		for (std::size_t i = 0; i < count; i++)
+		{
+			float x = centers[3 * i] + 2.0f * cosines[i];
+			float y = centers[3 * i + 1];
+			float z = centers[3 * i + 2] + 2.0f * sines[i];
+			lights[i].x = view._data[0] * x + view._data[4] * y + view._data[8] * z + view._data[12];
+			lights[i].y = view._data[1] * x + view._data[5] * y + view._data[9] * z + view._data[13];
+			lights[i].z = view._data[2] * x + view._data[6] * y + view._data[10] * z + view._data[14];
+		}
+		lightBuffer.bind();
+		ShaderStorageBuffer::data(count * sizeof(PointLight), lights.data(), GL_STREAM_DRAW);
+
+		if (assign == ASSIGN_CPU)
+		{
+			auto t0 = std::chrono::high_resolution_clock::now();
+			clusters.assign(lights.data(), count);
+			auto t1 = std::chrono::high_resolution_clock::now();
+			cpuMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+			references += clusters.references();
+			densest = std::max(densest, clusters.densest());
+			gridBuffer.bind();
+			ShaderStorageBuffer::data(clusters.grid().size() * sizeof(GLuint), clusters.grid().data(), GL_STREAM_DRAW);
+			indexBuffer.bind();
+			ShaderStorageBuffer::data(clusters.indices().size() * sizeof(GLuint), clusters.indices().data(), GL_STREAM_DRAW);
+		}
+
+		timer.begin();
+		if (assign == ASSIGN_GPU)
+		{
+			cull.use();
+			glUniform1ui(0, count);
+			glUniform1ui(1, LightClusters::COUNT);
+			glUniform1ui(2, CAPACITY);
+			ShaderProgram::dispatch((LightClusters::COUNT + 63) / 64);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		}
+
+		int width, height;
+		glfwGetFramebufferSize(window.handle(), &width, &height);
+		glViewport(0, 0, width, height);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		shade.use();
+		Uniform<0>::matrix4f(projection);
+		Uniform<1>::matrix4f(view);
+		glUniform4f(3, NEAR, clusters.scale(), float(width) / LightClusters::X, float(height) / LightClusters::Y);
+		glUniform1i(4, heat);
+		va.bind();
+		glUniform4f(2, 0, 0, 0, 0);
+		VertexArray::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (char*)0 + 36 * sizeof(GLuint));
+		glUniform4f(2, -(COLUMNS - 1) * SPACING * 0.5f, -SPACING, SPACING, COLUMNS);
+		glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0, COLUMNS * COLUMNS);
+		timer.end();
+		timer.collect();
+
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR)
+		{
+			std::cerr << error << std::endl;
+			result = 1;
+			break;
+		}
+		scheduler.present();
+		frames++;
+		if (frames % 120 == 0)
+		{
+			std::cout << std::fixed << std::setprecision(3) << "lights " << count
+				<< "  gpu " << timer.mean() << " ms";
+			if (assign == ASSIGN_CPU)
+			{
+				std::cout << "  assign " << cpuMs / 120 << " ms  lights per cluster "
+					<< double(references) / 120 / LightClusters::COUNT << " avg " << densest << " max";
+			}
+			std::cout << std::endl;
+			cpuMs = 0;
+			references = 0;
+			densest = 0;
+		}
+	}
+
+	timer.destroy();
+	lightBuffer.destroy();
+	gridBuffer.destroy();
+	indexBuffer.destroy();
+	boundsBuffer.destroy();
+	va.destroy();
+	vb.destroy();
+	ib.destroy();
+	shade.destroy();
+	cull.destroy();
+	scheduler.destroy();
+	window.destroy();
+	Window::terminate();
+	return result;
+}
@@ -0,0 +1,249 @@
+#include "common/FrameArena.h"
+#include "common/JobSystem.h"
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+
+// Counts every allocation that goes through the global operator new, so a
+// render loop can assert that it does not touch the heap.
+class HeapCounter
+{
+private:
+	static std::atomic<uint64_t> _allocations;
+	static std::atomic<uint64_t> _bytes;
+public:
+	static void add(std::size_t size)
+	{
+		_allocations.fetch_add(1, std::memory_order_relaxed);
+		_bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+	static uint64_t allocations()
+	{
+		return _allocations.load(std::memory_order_relaxed);
+	}
+	static uint64_t bytes()
+	{
+		return _bytes.load(std::memory_order_relaxed);
+	}
+};
+
+std::atomic<uint64_t> HeapCounter::_allocations(0);
+std::atomic<uint64_t> HeapCounter::_bytes(0);
+
+void * operator new(std::size_t size)
+{
+	HeapCounter::add(size);
+	void * p = malloc(size == 0 ? 1 : size);
+	if (p == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void * operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+// Every delete below ends here. Out of line on purpose: once a delete is
+// inlined into its caller, GCC pairs whatever deallocation it sees in the
+// body with the operator new that made the pointer, and warns with
+// -Wmismatched-new-delete about free() as well as about one delete calling
+// another.
+__attribute__((noinline)) static void release(void * p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void * p) noexcept
+{
+	release(p);
+}
+
+void operator delete[](void * p) noexcept
+{
+	release(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+	release(p);
+}
+
+void operator delete[](void * p, std::size_t) noexcept
+{
+	release(p);
+}
+
+// Over-aligned types come here instead. aligned_alloc wants the size to be
+// a multiple of the alignment; its memory goes back with free() as well.
+void * operator new(std::size_t size, std::align_val_t alignment)
+{
+	HeapCounter::add(size);
+	std::size_t a = static_cast<std::size_t>(alignment);
+	void * p = aligned_alloc(a, size == 0 ? a : (size + a - 1) & ~(a - 1));
+	if (p == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void * operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void operator delete(void * p, std::align_val_t) noexcept
+{
+	release(p);
+}
+
+void operator delete[](void * p, std::align_val_t) noexcept
+{
+	release(p);
+}
+
+void operator delete(void * p, std::size_t, std::align_val_t) noexcept
+{
+	release(p);
+}
+
+void operator delete[](void * p, std::size_t, std::align_val_t) noexcept
+{
+	release(p);
+}
+
+
+
+struct Pixel
+{
+	float r;
+	float g;
+	float b;
+};
+
+struct DrawCommand
+{
+	uint32_t mesh;
+	float mvp[16];
+};
+
+const int width = 640;
+const int height = 480;
+const int objects = 4096;
+const int workers = 4;
+
+struct Cull
+{
+	JobSystem * jobs;
+	FrameArena * arena;
+	const float * distances;
+	float range;
+	std::atomic<uint64_t> drawn;
+};
+
+// Culls objects [begin, end) into the sub-arena of whichever worker runs it
+// and records draw commands for the survivors.
+static void cull(std::size_t begin, std::size_t end, void * context)
+{
+	Cull& c = *static_cast<Cull *>(context);
+	LinearArena& local = c.arena->thread(c.jobs->index());
+	std::vector<uint32_t, ArenaAllocator<uint32_t> > visible((ArenaAllocator<uint32_t>(local)));
+	visible.reserve(end - begin);
+	for (std::size_t i = begin; i < end; i++)
+	{
+		if (c.distances[i] < c.range)
+		{
+			visible.push_back(i);
+		}
+	}
+	DrawCommand * commands = local.allocate<DrawCommand>(visible.size());
+	for (std::size_t i = 0; i < visible.size(); i++)
+	{
+		commands[i].mesh = visible[i];
+		memset(commands[i].mvp, 0, sizeof(commands[i].mvp));
+	}
+	c.drawn.fetch_add(visible.size(), std::memory_order_relaxed);
+}
+
+
+int main(int argc, char** argv)
+{
+	JobSystem jobs(workers);
+	FrameArena arena(16 << 20, 1 << 20, jobs.size());
+	std::vector<float> distances(objects);
+	for (int i = 0; i < objects; i++)
+	{
+		distances[i] = float(i % 200);
+	}
+	Cull culling = {&jobs, &arena, &distances[0], 0, {0}};
+
+	const int warmup = 2;
+	const int frames = 100;
+	uint64_t heap = 0;
+	uint64_t expected = 0;
+	std::vector<bool> used(jobs.size());
+	for (int frame = 0; frame < warmup + frames; frame++)
+	{
+		if (frame == warmup)
+		{
+			heap = HeapCounter::allocations();
+			culling.drawn.store(0);
+			expected = 0;
+		}
+
+		// Staging data for the noise upload, instead of a leaked new Pixel[].
+		Pixel * pixels = arena.shared().allocate<Pixel>(width * height);
+		for (int i = 0; i < width * height; i++)
+		{
+			pixels[i].r = 1.0f;
+			pixels[i].g = drand48();
+			pixels[i].b = 1.0f;
+		}
+
+		culling.range = 100.0f + frame % 50;
+		jobs.parallel_for(objects, cull, &culling, objects / (workers * 8));
+		for (int i = 0; i < objects; i++)
+		{
+			expected += distances[i] < culling.range;
+		}
+		for (unsigned t = 0; t < jobs.size(); t++)
+		{
+			used[t] = used[t] || arena.thread(t).allocations() > 0;
+		}
+
+		if (frame == warmup + frames - 1)
+		{
+			std::cout << "arena used:     " << arena.used() << " bytes in " << arena.allocations() << " allocations" << std::endl;
+		}
+		arena.reset();
+	}
+	heap = HeapCounter::allocations() - heap;
+
+	std::cout << "frames:         " << frames << std::endl;
+	std::cout << "draws:          " << culling.drawn.load() << std::endl;
+	std::cout << "sub-arenas:     " << std::count(used.begin(), used.end(), true) << " of " << used.size() << " used" << std::endl;
+	std::cout << "shared peak:    " << arena.shared().peak() << " bytes" << std::endl;
+	std::cout << "heap allocs:    " << heap << std::endl;
+	if (culling.drawn.load() != expected)
+	{
+		std::cerr << "culled " << culling.drawn.load() << " draws, expected " << expected << std::endl;
+		return 1;
+	}
+	if (heap != 0)
+	{
+		std::cerr << "steady state frame loop allocated from the heap" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,151 @@
+#include "common/Window.h"
+#include "common/Shader.h"
+#include "common/Buffer.h"
+#include "common/NamePool.h"
+#include "common/FrameScheduler.h"
+
+#include <iostream>
+#include <string>
+
+#define GLSL(src) "#version 330\n" #src
+
+
+static void error_callback(int error, const char* description)
+{
+	fputs(description, stderr);
+}
+
+
+static int run(FrameScheduler& scheduler)
+{
+	NamePool<BufferObjects> buffers;
+	NamePool<VertexArrayObjects> vertexArrays;
+	NamePool<ProgramObjects> programs;
+
+	std::string vertexSource = GLSL
+	(
+		layout(location = 0) in vec4 vposition;
+		layout(location = 1) in vec4 vcolor;
+		out vec4 fcolor;
+		void main()
+		{
+			fcolor = vcolor;
+			gl_Position = vposition;
+		}
+	);
+
+	std::string fragmentSource = GLSL
+	(
+		in vec4 fcolor;
+		layout(location = 0) out vec4 FragColor;
+		void main()
+		{
+			FragColor = fcolor;
+		}
+	);
+
+	ShaderProgram program;
+	{
+		VertexShader vertexShader;
+		FragmentShader fragmentShader;
+		vertexShader.source(vertexSource);
+		fragmentShader.source(fragmentSource);
+		vertexShader.compile();
+		fragmentShader.compile();
+		program.attach(vertexShader);
+		program.attach(fragmentShader);
+		program.link();
+		program.detach(vertexShader);
+		program.detach(fragmentShader);
+	}
+	if (!program.status())
+	{
+		std::string errorMsg;
+		program.info(errorMsg);
+		std::cerr << errorMsg;
+		return 1;
+	}
+
+	VertexArray va;
+	va.bind();
+
+	ElementArrayBuffer ib;
+	ib.bind();
+	GLuint indexData[] = {
+		0, 1, 2,
+		2, 1, 3,
+	};
+	ElementArrayBuffer::staticData(sizeof(indexData), indexData);
+
+	// Every frame draws a handful of quads from transient vertex buffers.
+	// Their names go back to the pool at the end of each iteration and are
+	// reused once the GPU has finished the frame, instead of paying for a
+	// glGenBuffers/glDeleteBuffers pair per buffer.
+	const int quads = 64;
+	unsigned long frames = 0;
+	while (scheduler.wait())
+	{
+		glClear(GL_COLOR_BUFFER_BIT);
+		program.use();
+		va.bind();
+		for (int i = 0; i < quads; i++)
+		{
+			float x = -1.0f + 2.0f * (i % 8) / 8.0f;
+			float y = -1.0f + 2.0f * (i / 8) / 8.0f;
+			float s = 2.0f / 8.0f;
+			float c = float(frames % 256) / 255.0f;
+			GLfloat vertexData[] =
+			{
+				x + s, y + s, 0.0f, c, 0.0f, 0.0f,
+				x, y + s, 0.0f, 0.0f, c, 0.0f,
+				x + s, y, 0.0f, 0.0f, 0.0f, c,
+				x, y, 0.0f, c, 0.0f, 0.0f,
+			};
+			ArrayBuffer vb;
+			vb.bind();
+			ArrayBuffer::streamData(sizeof(vertexData), vertexData);
+			VertexAttribute<0>::enable();
+			VertexAttribute<0>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0);
+			VertexAttribute<1>::enable();
+			VertexAttribute<1>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0 + 3 * sizeof(GLfloat));
+			VertexArray::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		}
+		buffers.frame();
+		vertexArrays.frame();
+		programs.frame();
+
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR)
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		scheduler.present();
+		frames++;
+	}
+
+	std::cout << "frames:            " << frames << std::endl;
+	std::cout << "buffers created:   " << frames * quads + 1 << std::endl;
+	std::cout << "names generated:   " << buffers.generated() << " in " << buffers.calls() << " calls" << std::endl;
+	std::cout << "names recycled:    " << buffers.recycled() << std::endl;
+	return 0;
+}
+
+
+int main(int argc, char** argv) {
+
+	Window::init();
+	Window window(640, 480, "Title");
+	glfwSetErrorCallback(error_callback);
+	window.current();
+	FrameScheduler scheduler(argc, argv, window);
+
+	// All GL objects, and their pools, are gone when run() returns, before
+	// the context is destroyed.
+	int result = run(scheduler);
+
+	scheduler.destroy();
+	window.destroy();
+	Window::terminate();
+	return result;
+}
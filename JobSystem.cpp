@@ -0,0 +1,111 @@
+#include "common/JobSystem.h"
+#include "common/Random.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+
+
+struct Pixel
+{
+	float r;
+	float g;
+	float b;
+};
+
+const int width = 640;
+const int height = 480;
+
+struct NoiseFill
+{
+	Pixel * pixels;
+	uint32_t frame;
+};
+
+static void fill(std::size_t begin, std::size_t end, void * context)
+{
+	NoiseFill * n = static_cast<NoiseFill *>(context);
+	for (std::size_t i = begin; i < end; i++)
+	{
+		Pixel * pixel = &n->pixels[i];
+		pixel->r = 1.0;
+		// Counter based, so every chunk can be filled independently.
+		pixel->g = Random::uniform(i, n->frame);
+		pixel->b = 1.0;
+	}
+}
+
+static void nothing(Job *, const void *)
+{}
+
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double elapsed(Clock::time_point t0)
+{
+	return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+}
+
+// Schedule batches of empty jobs under one parent and report the cost of
+// create + run + execute + finish per job.
+static double overhead(JobSystem& jobs, int batches, int batch)
+{
+	Clock::time_point t0 = Clock::now();
+	for (int b = 0; b < batches; b++)
+	{
+		Job * root = jobs.group();
+		for (int i = 0; i < batch; i++)
+		{
+			jobs.run(jobs.create(nothing, root));
+		}
+		jobs.run(root);
+		jobs.wait(root);
+	}
+	return elapsed(t0) / (double(batches) * batch);
+}
+
+static double noiseFill(JobSystem& jobs, Pixel * pixels, int frames)
+{
+	Clock::time_point t0 = Clock::now();
+	for (int f = 0; f < frames; f++)
+	{
+		NoiseFill n = {pixels, uint32_t(f)};
+		jobs.parallel_for(width * height, fill, &n);
+	}
+	return elapsed(t0) / frames / 1000.0;
+}
+
+
+int main(int argc, char** argv)
+{
+	unsigned cores = std::thread::hardware_concurrency();
+	if (cores == 0)
+	{
+		cores = 1;
+	}
+	std::vector<Pixel> pixels(width * height);
+
+	std::cout << "threads\tns/job\tnoise fill (us)\tspeedup" << std::endl;
+	double single = 0;
+	for (unsigned threads = 1; threads <= cores; threads *= 2)
+	{
+		JobSystem jobs(threads);
+		overhead(jobs, 10, 4096);
+		double ns = overhead(jobs, 200, 4096);
+		noiseFill(jobs, &pixels[0], 10);
+		double us = noiseFill(jobs, &pixels[0], 100);
+		if (threads == 1)
+		{
+			single = us;
+		}
+		std::cout << threads << "\t" << std::setprecision(3) << ns << "\t" << us << "\t\t" << single / us << std::endl;
+		if (threads < cores && threads * 2 > cores)
+		{
+			threads = cores / 2;
+		}
+	}
+	return 0;
+}
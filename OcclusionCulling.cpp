@@ -0,0 +1,395 @@
+#include "common/Window.h"
+#include "common/Shader.h"
+#include "common/Buffer.h"
+#include "common/Matrix4f.h"
+#include "common/Uniform.h"
+#include "common/SoftRaster.h"
+#include "common/DepthPyramid.h"
+#include "common/PixelReadback.h"
+#include "common/FrameScheduler.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#define GLSL(src) "#version 430\n" #src
+
+
+// A walk through a grid of walled rooms holding thousands of Cube1 cubes,
+// each its own draw call. Before submitting, every cube's box is tested
+// against a DepthPyramid and the hidden ones are skipped.
+//
+//   --occluders cpu     rasterize the walls with SoftRaster at 256x192 and
+//                       build the pyramid from that, the default
+//   --occluders depth   read back the depth of an earlier frame instead
+//                       and test against that frame's camera; cheaper to
+//                       build, but cubes coming into view show a few
+//                       frames late
+//   --occluders off     frustum culling only
+//   --pacing, --rate as in FrameScheduler.h
+
+static constexpr Matrix4f projection = []
+{
+	Matrix4f m;
+	m.perspective(0.1f, 200.0f, 0.1f, 0.075f);
+	return m;
+}();
+
+static const int ROOMS = 8;
+static const float ROOM = 8.0f;
+static const int CUBES = 64;
+static const float CUBE = 0.25f;
+static const int OCCLUDER_WIDTH = 256;
+static const int OCCLUDER_HEIGHT = 192;
+// Window depth readbacks in flight with --occluders depth.
+static const int READBACKS = 3;
+
+
+static void error_callback(int error, const char* description)
+{
+	fputs(description, stderr);
+}
+
+// An axis aligned box as 24 vertices and 36 indices, with one gray per
+// side so the faces stay apart.
+static void box(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices,
+	float x0, float y0, float z0, float x1, float y1, float z1)
+{
+	const float corners[6][4][3] =
+	{
+		{{x1, y0, z0}, {x1, y1, z0}, {x1, y0, z1}, {x1, y1, z1}},
+		{{x0, y0, z0}, {x0, y0, z1}, {x0, y1, z0}, {x0, y1, z1}},
+		{{x0, y1, z0}, {x0, y1, z1}, {x1, y1, z0}, {x1, y1, z1}},
+		{{x0, y0, z0}, {x1, y0, z0}, {x0, y0, z1}, {x1, y0, z1}},
+		{{x0, y0, z1}, {x1, y0, z1}, {x0, y1, z1}, {x1, y1, z1}},
+		{{x0, y0, z0}, {x0, y1, z0}, {x1, y0, z0}, {x1, y1, z0}},
+	};
+	const float shades[6] = {0.55f, 0.55f, 0.7f, 0.3f, 0.45f, 0.45f};
+	for (int f = 0; f < 6; f++)
+	{
+		GLuint base = GLuint(vertices.size() / 6);
+		for (int v = 0; v < 4; v++)
+		{
+			vertices.insert(vertices.end(), corners[f][v], corners[f][v] + 3);
+			vertices.insert(vertices.end(), 3, shades[f]);
+		}
+		const GLuint quad[] = {0, 1, 2, 2, 1, 3};
+		for (int i = 0; i < 6; i++)
+		{
+			indices.push_back(base + quad[i]);
+		}
+	}
+}
+
+
+int main(int argc, char** argv) {
+
+	std::string occluders = "cpu";
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) == "--occluders")
+		{
+			occluders = argv[++i];
+		}
+	}
+	if (occluders != "cpu" && occluders != "depth" && occluders != "off")
+	{
+		std::cerr << "--occluders takes cpu, depth or off" << std::endl;
+		return 1;
+	}
+
+	Window::init();
+	Window window(640, 480, "Title");
+	glfwSetErrorCallback(error_callback);
+	window.current();
+	FrameScheduler scheduler(argc, argv, window);
+
+	std::string vertexSource = GLSL
+	(
+		layout(location = 0) in vec4 vposition;
+		layout(location = 1) in vec4 vcolor;
+		layout(location = 2) uniform mat4 mvp;
+		out vec4 fcolor;
+		void main()
+		{
+			fcolor = vcolor;
+			gl_Position = mvp * vposition;
+		}
+	);
+	std::string fragmentSource = GLSL
+	(
+		in vec4 fcolor;
+		layout(location = 0) out vec4 FragColor;
+		void main()
+		{
+			FragColor = fcolor;
+		}
+	);
+
+	VertexShader vertexShader;
+	FragmentShader fragmentShader;
+	vertexShader.source(vertexSource);
+	fragmentShader.source(fragmentSource);
+	vertexShader.compile();
+	fragmentShader.compile();
+	ShaderProgram program;
+	program.attach(vertexShader);
+	program.attach(fragmentShader);
+	program.link();
+	if (!program.status())
+	{
+		std::string errorMsg;
+		program.info(errorMsg);
+		std::cerr << errorMsg;
+		vertexShader.destroy();
+		fragmentShader.destroy();
+		program.destroy();
+		scheduler.destroy();
+		window.destroy();
+		Window::terminate();
+		return 1;
+	}
+
+	// Walls on every room boundary, each with a doorway in the middle, then
+	// the floor. Only the walls are occluders.
+	std::vector<GLfloat> levelVertices;
+	std::vector<GLuint> levelIndices;
+	const float size = ROOMS * ROOM;
+	const float half = 0.1f;
+	const float door = 1.0f;
+	for (int line = 0; line <= ROOMS; line++)
+	{
+		float p = line * ROOM;
+		for (int room = 0; room < ROOMS; room++)
+		{
+			float a = room * ROOM;
+			float b = a + ROOM;
+			float m = a + ROOM * 0.5f;
+			bool outer = line == 0 || line == ROOMS;
+			box(levelVertices, levelIndices, a, 0, p - half, outer ? b : m - door, 3.0f, p + half);
+			box(levelVertices, levelIndices, p - half, 0, a, p + half, 3.0f, outer ? b : m - door);
+			if (!outer)
+			{
+				box(levelVertices, levelIndices, m + door, 0, p - half, b, 3.0f, p + half);
+				box(levelVertices, levelIndices, p - half, 0, m + door, p + half, 3.0f, b);
+			}
+		}
+	}
+	const std::size_t wallIndices = levelIndices.size();
+	box(levelVertices, levelIndices, 0, -0.1f, 0, size, 0, size);
+
+	VertexArray level;
+	level.bind();
+	ArrayBuffer levelBuffer;
+	levelBuffer.bind();
+	ArrayBuffer::staticData(levelVertices.size() * sizeof(GLfloat), &levelVertices[0]);
+	VertexAttribute<0>::enable();
+	VertexAttribute<0>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0);
+	VertexAttribute<1>::enable();
+	VertexAttribute<1>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0 + 3 * sizeof(GLfloat));
+	ElementArrayBuffer levelIndexBuffer;
+	levelIndexBuffer.bind();
+	ElementArrayBuffer::staticData(levelIndices.size() * sizeof(GLuint), &levelIndices[0]);
+
+	VertexArray cube;
+	cube.bind();
+	ArrayBuffer cubeBuffer;
+	cubeBuffer.bind();
+	GLfloat vertexData[] =
+	{
+		//  X     Y     Z           R     G     B
+		1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+		-1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+		1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+		-1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+
+		1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+		1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+		1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+		1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+
+		1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+		1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+		-1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+		-1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+
+		1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+		1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+		-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+		-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+
+		-1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+		-1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+		-1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+		-1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+
+		1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+		-1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+		1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 1.0f,
+		-1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 1.0f,
+	};
+	ArrayBuffer::staticData(sizeof(vertexData), vertexData);
+	VertexAttribute<0>::enable();
+	VertexAttribute<0>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0);
+	VertexAttribute<1>::enable();
+	VertexAttribute<1>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0 + 3 * sizeof(GLfloat));
+	ElementArrayBuffer cubeIndexBuffer;
+	cubeIndexBuffer.bind();
+	GLuint indexData[] =
+	{
+		0, 1, 2, 2, 1, 3,
+		4, 5, 6, 6, 5, 7,
+		8, 9, 10, 10, 9, 11,
+		12, 13, 14, 14, 13, 15,
+		16, 17, 18, 18, 17, 19,
+		20, 21, 22, 22, 21, 23,
+	};
+	ElementArrayBuffer::staticData(sizeof(indexData), indexData);
+
+	// Cube centers, half a unit off the walls.
+	std::vector<float> centers;
+	for (int j = 0; j < CUBES; j++)
+	{
+		for (int i = 0; i < CUBES; i++)
+		{
+			centers.push_back((i + 0.5f) * size / CUBES);
+			centers.push_back(CUBE);
+			centers.push_back((j + 0.5f) * size / CUBES);
+		}
+	}
+	const std::size_t cubeCount = centers.size() / 3;
+
+	JobSystem jobs(std::max(1u, std::thread::hardware_concurrency()));
+	SoftRaster raster(jobs, OCCLUDER_WIDTH, OCCLUDER_HEIGHT);
+	DepthPyramid pyramid;
+	PixelReadback<READBACKS> readback(GL_DEPTH_COMPONENT, GL_FLOAT, sizeof(float));
+	Matrix4f cameras[READBACKS];
+	Matrix4f previous;
+	bool havePrevious = false;
+
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
+
+	int result = 0;
+	unsigned long frames = 0;
+	std::size_t drawn = 0;
+	double cullMs = 0;
+	float t = 0;
+	while (scheduler.wait())
+	{
+
+		// Down the middle row of rooms and back, looking around.
+		float x = ROOM * 0.5f + (size - ROOM) * (0.5f - 0.5f * SimdTrig<TRIG_LOW>::cos(t * 0.05f));
+		float yaw = 1.5707963f + 0.8f * SimdTrig<TRIG_LOW>::sin(t * 0.3f);
+		Matrix4f viewProjection = projection;
+		viewProjection.rotateY<TRIG_LOW>(yaw);
+		viewProjection.translate(-x, -1.2f, -(ROOMS / 2 + 0.5f) * ROOM);
+
+		auto t0 = std::chrono::steady_clock::now();
+		if (occluders == "cpu")
+		{
+			raster.clear();
+			raster.draw(SoftRaster::TRIANGLES, &levelVertices[0], levelVertices.size() / 6, 6,
+				&levelIndices[0], wallIndices, viewProjection);
+			pyramid.build(raster.depth(), OCCLUDER_WIDTH, OCCLUDER_HEIGHT);
+		}
+		else if (occluders == "depth")
+		{
+			// The pyramid and camera of an earlier readback hold until a
+			// newer one has finished.
+			readback.latest([&](const void * depth, int frame)
+			{
+				if (depth != NULL)
+				{
+					pyramid.build(static_cast<const float *>(depth), readback.width(), readback.height());
+					previous = cameras[frame % READBACKS];
+					havePrevious = true;
+				}
+			});
+		}
+
+		int width, height;
+		glfwGetFramebufferSize(window.handle(), &width, &height);
+		glViewport(0, 0, width, height);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		program.use();
+		Uniform<2>::matrix4f(viewProjection);
+		level.bind();
+		VertexArray::drawElements(GL_TRIANGLES, levelIndices.size(), GL_UNSIGNED_INT, 0);
+
+		cube.bind();
+		for (std::size_t c = 0; c < cubeCount; c++)
+		{
+			const float * p = &centers[c * 3];
+			float minimum[3] = {p[0] - CUBE, p[1] - CUBE, p[2] - CUBE};
+			float maximum[3] = {p[0] + CUBE, p[1] + CUBE, p[2] + CUBE};
+			bool visible = DepthPyramid::inFrustum(minimum, maximum, viewProjection);
+			if (visible && occluders == "cpu")
+			{
+				visible = pyramid.visible(minimum, maximum, viewProjection);
+			}
+			else if (visible && occluders == "depth" && havePrevious)
+			{
+				visible = pyramid.visible(minimum, maximum, previous);
+			}
+			if (!visible)
+			{
+				continue;
+			}
+			Matrix4f mvp = viewProjection;
+			mvp.translate(p[0], p[1], p[2]);
+			mvp.scale(CUBE);
+			Uniform<2>::matrix4f(mvp);
+			VertexArray::drawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+			drawn++;
+		}
+		cullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+		if (occluders == "depth")
+		{
+			cameras[readback.submitted() % READBACKS] = viewProjection;
+			readback.submit(width, height);
+		}
+
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR)
+		{
+			std::cerr << error << std::endl;
+			result = 1;
+			break;
+		}
+		scheduler.present();
+		t += 1.0f / 60.0f;
+		frames++;
+		if (frames % 120 == 0)
+		{
+			std::cout << std::fixed << std::setprecision(3) << "cubes drawn " << drawn / 120 << " of " << cubeCount
+				<< "  cull and submit " << cullMs / 120 << " ms" << std::endl;
+			drawn = 0;
+			cullMs = 0;
+		}
+	}
+
+	readback.destroy();
+	level.destroy();
+	levelBuffer.destroy();
+	levelIndexBuffer.destroy();
+	cube.destroy();
+	cubeBuffer.destroy();
+	cubeIndexBuffer.destroy();
+	program.detach(vertexShader);
+	program.detach(fragmentShader);
+	vertexShader.destroy();
+	fragmentShader.destroy();
+	program.destroy();
+	scheduler.destroy();
+	window.destroy();
+	Window::terminate();
+	return result;
+}
@@ -0,0 +1,148 @@
+#include "common/Window.h"
+#include "common/Matrix4f.h"
+#include "common/SimdTrig.h"
+#include "common/ParticleSystem.h"
+#include "common/FrameScheduler.h"
+#include "common/GpuTimer.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+
+
+// Four fountains circling over a floor, a million particles by default. The
+// CPU queues one burst per fountain per frame, everything else happens in
+// ParticleSystem's buffers.
+//
+//   --particles N    capacity, 1048576 by default
+//   --life S         mean lifetime in seconds, 4 by default
+//   --pacing, --rate as in FrameScheduler.h
+
+static constexpr Matrix4f projection = []
+{
+	Matrix4f m;
+	m.perspective(0.5f, 200.0f, 0.4f, 0.3f);
+	return m;
+}();
+
+static const int FOUNTAINS = 4;
+
+
+static void error_callback(int error, const char* description)
+{
+	fputs(description, stderr);
+}
+
+
+int main(int argc, char** argv) {
+
+	GLuint capacity = 1 << 20;
+	float life = 4.0f;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--particles")
+		{
+			capacity = std::max(1, atoi(argv[++i]));
+		}
+		else if (arg == "--life")
+		{
+			life = std::max(0.1, atof(argv[++i]));
+		}
+	}
+
+	Window::init();
+	Window window(640, 480, "Title");
+	glfwSetErrorCallback(error_callback);
+	window.current();
+	FrameScheduler scheduler(argc, argv, window);
+
+	ParticleSystem particles(capacity);
+	if (!particles.status())
+	{
+		std::string errorMsg;
+		particles.info(errorMsg);
+		std::cerr << errorMsg;
+		particles.destroy();
+		scheduler.destroy();
+		window.destroy();
+		Window::terminate();
+		return 1;
+	}
+
+	Matrix4f view;
+	view.identity();
+	view.translate(0, -3.0f, -25.0f);
+
+	// Emitting capacity / life per second keeps the ring about full.
+	const float dt = 1.0f / 60.0f;
+	const GLuint burst = std::max(1.0f, capacity / life * dt / FOUNTAINS);
+
+	GpuTimer timer;
+
+	int result = 0;
+	unsigned long frames = 0;
+	float t = 0;
+	while (scheduler.wait())
+	{
+
+		for (int f = 0; f < FOUNTAINS; f++)
+		{
+			float s, c;
+			SimdTrig<TRIG_LOW>::sincos(t * 0.5f + f * 1.5707963f, s, c);
+			Emission e = {};
+			e.position[0] = 8.0f * c;
+			e.position[1] = 0.2f;
+			e.position[2] = 8.0f * s;
+			e.spread = 0.2f;
+			e.velocity[0] = -2.0f * c;
+			e.velocity[1] = 12.0f;
+			e.velocity[2] = -2.0f * s;
+			e.jitter = 1.5f;
+			e.color[0] = f & 1 ? 1.0f : 0.2f;
+			e.color[1] = 0.4f;
+			e.color[2] = f & 2 ? 1.0f : 0.2f;
+			e.life = life;
+			e.count = burst;
+			particles.emit(e);
+		}
+
+		int width, height;
+		glfwGetFramebufferSize(window.handle(), &width, &height);
+		glViewport(0, 0, width, height);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		timer.begin();
+		particles.update(dt);
+		particles.draw(view, projection, 0.03f);
+		timer.end();
+		timer.collect();
+
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR)
+		{
+			std::cerr << error << std::endl;
+			result = 1;
+			break;
+		}
+		scheduler.present();
+		t += dt;
+		frames++;
+		if (frames % 120 == 0)
+		{
+			std::cout << std::fixed << std::setprecision(3) << "particles " << particles.alive()
+				<< "  gpu " << timer.mean() << " ms" << std::endl;
+		}
+	}
+
+	timer.destroy();
+	particles.destroy();
+	scheduler.destroy();
+	window.destroy();
+	Window::terminate();
+	return result;
+}
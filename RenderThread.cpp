@@ -0,0 +1,566 @@
+#include "common/Window.h"
+#include "common/Shader.h"
+#include "common/Buffer.h"
+#include "common/Matrix4f.h"
+#include "common/Uniform.h"
+#include "common/FrameArena.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cmath>
+
+#define GLSL(src) "#version 430\n" #src
+
+
+
+// A lightweight, GL-free description of one state change or draw call.
+// Recorded by simulation threads, replayed by the thread that owns the
+// GL context.
+struct RenderCommand
+{
+	enum Type
+	{
+		USE_PROGRAM,
+		BIND_VERTEX_ARRAY,
+		UNIFORM_MATRIX4F,
+		DRAW_ELEMENTS
+	};
+	Type type;
+	union
+	{
+		GLuint id;
+		struct
+		{
+			GLint location;
+			GLfloat data[16];
+		} uniform;
+		struct
+		{
+			GLenum mode;
+			GLsizei count;
+			GLenum type;
+			GLsizeiptr offset;
+		} draw;
+	};
+};
+
+// Commands recorded by a single thread for a single frame, stored in that
+// thread's sub-arena of the frame's FrameArena. Growing copies into a block
+// twice the size and leaves the old one to the next reset, so recording does
+// not touch the heap.
+class CommandBuffer
+{
+private:
+	LinearArena * _arena;
+	RenderCommand * _commands;
+	std::size_t _size;
+	std::size_t _capacity;
+
+	void push(const RenderCommand& c)
+	{
+		if (_size == _capacity)
+		{
+			std::size_t capacity = _capacity == 0 ? 64 : _capacity * 2;
+			RenderCommand * commands = _arena->allocate<RenderCommand>(capacity);
+			if (_size > 0)
+			{
+				memcpy(commands, _commands, _size * sizeof(RenderCommand));
+			}
+			_commands = commands;
+			_capacity = capacity;
+		}
+		_commands[_size++] = c;
+	}
+public:
+	CommandBuffer() : _arena(NULL), _commands(NULL), _size(0), _capacity(0)
+	{}
+	// Start recording into arena, which must have been reset since the
+	// last frame that used this buffer was drawn.
+	void begin(LinearArena& arena)
+	{
+		_arena = &arena;
+		_commands = NULL;
+		_size = 0;
+		_capacity = 0;
+	}
+	std::size_t size() const
+	{
+		return _size;
+	}
+	void useProgram(GLuint id)
+	{
+		RenderCommand c;
+		c.type = RenderCommand::USE_PROGRAM;
+		c.id = id;
+		push(c);
+	}
+	void bindVertexArray(GLuint id)
+	{
+		RenderCommand c;
+		c.type = RenderCommand::BIND_VERTEX_ARRAY;
+		c.id = id;
+		push(c);
+	}
+	void uniformMatrix4f(GLint location, const Matrix4f& m)
+	{
+		RenderCommand c;
+		c.type = RenderCommand::UNIFORM_MATRIX4F;
+		c.uniform.location = location;
+		memcpy(c.uniform.data, m._data, sizeof(c.uniform.data));
+		push(c);
+	}
+	void drawElements(GLenum mode, GLsizei count, GLenum type, GLsizeiptr offset)
+	{
+		RenderCommand c;
+		c.type = RenderCommand::DRAW_ELEMENTS;
+		c.draw.mode = mode;
+		c.draw.count = count;
+		c.draw.type = type;
+		c.draw.offset = offset;
+		push(c);
+	}
+	// Must be called on the thread that owns the GL context.
+	void execute() const
+	{
+		for (std::size_t i = 0; i < _size; i++)
+		{
+			const RenderCommand& c = _commands[i];
+			switch (c.type)
+			{
+			case RenderCommand::USE_PROGRAM:
+				glUseProgram(c.id);
+				break;
+			case RenderCommand::BIND_VERTEX_ARRAY:
+				glBindVertexArray(c.id);
+				break;
+			case RenderCommand::UNIFORM_MATRIX4F:
+				glUniformMatrix4fv(c.uniform.location, 1, GL_FALSE, c.uniform.data);
+				break;
+			case RenderCommand::DRAW_ELEMENTS:
+				glDrawElements(c.draw.mode, c.draw.count, c.draw.type, (char*)0 + c.draw.offset);
+				break;
+			}
+		}
+	}
+};
+
+// Everything the render thread needs to draw one frame: one command buffer
+// per recording thread, replayed in order, and the arena holding them. The
+// game thread resets the arena when it gets the frame back.
+struct Frame
+{
+	FrameArena arena;
+	std::vector<CommandBuffer> buffers;
+	unsigned long number;
+
+	Frame(unsigned threads) : arena(0, 256 << 10, threads), buffers(threads), number(0)
+	{}
+};
+
+// Lets a thread sleep until a condition that other threads change without
+// a lock turns true. wait() polls the condition and only registers as a
+// waiter and parks on the condition variable after it failed; notify(),
+// called after making a condition true, only takes the mutex when someone
+// is registered. With nobody waiting both sides stay lock-free.
+class EventCount
+{
+private:
+	std::atomic<unsigned> _epoch;
+	std::atomic<unsigned> _waiters;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+public:
+	EventCount() : _epoch(0), _waiters(0)
+	{}
+	template <typename CONDITION>
+	void wait(CONDITION ready)
+	{
+		while (!ready())
+		{
+			// Register, then check again: a notify() after the check sees
+			// the waiter, one before it is seen by the check.
+			_waiters.fetch_add(1, std::memory_order_seq_cst);
+			unsigned epoch = _epoch.load(std::memory_order_seq_cst);
+			if (!ready())
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wake.wait(lock, [this, epoch] { return _epoch.load(std::memory_order_acquire) != epoch; });
+			}
+			_waiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+	void notify()
+	{
+		_epoch.fetch_add(1, std::memory_order_seq_cst);
+		if (_waiters.load(std::memory_order_seq_cst) > 0)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_wake.notify_all();
+		}
+	}
+};
+
+// Two frames handed back and forth between the game thread and the render
+// thread. Each slot is owned by exactly one side at a time; ownership moves
+// with a release store and is picked up with an acquire load, so while
+// frames flow neither side takes a lock. A side that finds no slot for it
+// parks on an EventCount until the other side hands one over or stop() is
+// called.
+class FrameQueue
+{
+public:
+	enum State
+	{
+		FREE,
+		READY
+	};
+private:
+	Frame _frames[2];
+	std::atomic<int> _state[2];
+	int _write;
+	int _read;
+	std::atomic<bool> _stopped;
+	EventCount _freed;
+	EventCount _published;
+public:
+	FrameQueue(unsigned threads) : _frames{{threads}, {threads}}, _write(0), _read(0), _stopped(false)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			_state[i].store(FREE);
+		}
+	}
+	// Game side. Waits while the render thread holds both frames, NULL once
+	// stopped.
+	Frame * acquire()
+	{
+		_freed.wait([this] { return _stopped.load(std::memory_order_acquire) || _state[_write].load(std::memory_order_acquire) == FREE; });
+		return _stopped.load(std::memory_order_acquire) ? NULL : &_frames[_write];
+	}
+	void publish()
+	{
+		_state[_write].store(READY, std::memory_order_release);
+		_write ^= 1;
+		_published.notify();
+	}
+	// Render side. Waits until a frame has been published, NULL once
+	// stopped.
+	Frame * consume()
+	{
+		_published.wait([this] { return _stopped.load(std::memory_order_acquire) || _state[_read].load(std::memory_order_acquire) == READY; });
+		return _stopped.load(std::memory_order_acquire) ? NULL : &_frames[_read];
+	}
+	void release()
+	{
+		_state[_read].store(FREE, std::memory_order_release);
+		_read ^= 1;
+		_freed.notify();
+	}
+	void stop()
+	{
+		_stopped.store(true, std::memory_order_release);
+		_freed.notify();
+		_published.notify();
+	}
+};
+
+// GL objects created by the render thread and referenced by id in commands.
+struct Scene
+{
+	GLuint program;
+	GLuint vertexArray;
+};
+
+static const int recorders = 4;
+static const int cubesPerRecorder = 16;
+
+// The main thread starts the recorders on a frame by publishing its number
+// and counts them back in with recordDone; it also waits for the render
+// thread to load the scene. Each side parks on its EventCount only when the
+// atomic it waits on has not changed yet.
+static EventCount toRecorders;
+static EventCount toMain;
+static std::atomic<bool> running(true);
+static std::atomic<bool> loaded(false);
+static std::atomic<unsigned long> recordFrame(0);
+static std::atomic<int> recordDone(0);
+static Frame * recordTarget = NULL;
+static float recordTime = 0;
+static Scene scene;
+
+// Shared by every cube, built at compile time.
+static constexpr Matrix4f projection = []
+{
+	Matrix4f m;
+	m.frustum(1.0f, 200.0f, 1.0f, 1.2f);
+	return m;
+}();
+
+
+static void error_callback(int error, const char* description)
+{
+	fputs(description, stderr);
+}
+
+
+// Ends every thread's loop and wakes whoever is waiting.
+static void stop(FrameQueue& queue)
+{
+	running.store(false, std::memory_order_release);
+	toRecorders.notify();
+	toMain.notify();
+	queue.stop();
+}
+
+static void record(int index)
+{
+	unsigned long frame = 0;
+	for (;;)
+	{
+		toRecorders.wait([frame]
+		{
+			return !running.load(std::memory_order_acquire) || recordFrame.load(std::memory_order_acquire) != frame;
+		});
+		if (!running.load(std::memory_order_acquire))
+		{
+			return;
+		}
+		frame = recordFrame.load(std::memory_order_acquire);
+		CommandBuffer& buffer = recordTarget->buffers[index];
+		buffer.begin(recordTarget->arena.thread(index));
+		buffer.useProgram(scene.program);
+		buffer.bindVertexArray(scene.vertexArray);
+		for (int i = 0; i < cubesPerRecorder; i++)
+		{
+			float a = recordTime + 0.1f * i;
+			float x = -6.0f + 4.0f * index;
+			float y = -6.0f + 0.8f * i;
+			Matrix4f mvp = projection;
+			mvp.translate(x, y, -20.0f);
+			mvp.scale(0.3f);
+			mvp.rotateY<TRIG_MEDIUM>(a);
+			mvp.rotateZ<TRIG_MEDIUM>(a * 0.5f);
+			buffer.uniformMatrix4f(2, mvp);
+			buffer.drawElements(GL_LINES, 36, GL_UNSIGNED_INT, 0);
+		}
+		if (recordDone.fetch_add(1, std::memory_order_acq_rel) + 1 == recorders)
+		{
+			toMain.notify();
+		}
+	}
+}
+
+
+static void render(Window * window, FrameQueue * queue)
+{
+	window->current();
+
+	std::string vertexSource = GLSL
+	(
+		layout(location = 0) in vec4 vposition;
+		layout(location = 1) in vec4 vcolor;
+		layout(location = 2) uniform mat4 mvp;
+		out vec4 fcolor;
+		void main()
+		{
+			fcolor = vcolor;
+			gl_Position = mvp * vposition;
+		}
+	);
+
+	std::string fragmentSource = GLSL
+	(
+		in vec4 fcolor;
+		layout(location = 0) out vec4 FragColor;
+		void main()
+		{
+			FragColor = fcolor;
+		}
+	);
+
+	VertexShader vertexShader;
+	FragmentShader fragmentShader;
+	vertexShader.source(vertexSource);
+	fragmentShader.source(fragmentSource);
+	vertexShader.compile();
+	fragmentShader.compile();
+	ShaderProgram program;
+	program.attach(vertexShader);
+	program.attach(fragmentShader);
+	program.link();
+	if (!program.status())
+	{
+		std::string errorMsg;
+		program.info(errorMsg);
+		std::cerr << errorMsg;
+		stop(*queue);
+		return;
+	}
+
+	VertexArray va;
+	va.bind();
+
+	ArrayBuffer vb;
+	vb.bind();
+	GLfloat vertexData[] =
+	{
+		//  X     Y     Z           R     G     B
+		1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+		-1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+		1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+		-1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+
+		1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+		1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+		1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+		1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+
+		1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+		1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+		-1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+		-1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+
+		1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+		1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+		-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+		-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+
+		-1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+		-1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+		-1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+		-1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+
+		1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+		-1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+		1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 1.0f,
+		-1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 1.0f,
+	};
+	ArrayBuffer::staticData(sizeof(vertexData), vertexData);
+	VertexAttribute<0>::enable();
+	VertexAttribute<0>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0);
+	VertexAttribute<1>::enable();
+	VertexAttribute<1>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0 + 3 * sizeof(GLfloat));
+
+	ElementArrayBuffer ib;
+	ib.bind();
+	GLuint indexData[] = {
+		0, 1, 2, 2, 1, 3,
+		4, 5, 6, 6, 5, 7,
+		8, 9, 10, 10, 9, 11,
+		12, 13, 14, 14, 13, 15,
+		16, 17, 18, 18, 17, 19,
+		20, 21, 22, 22, 21, 23,
+	};
+	ElementArrayBuffer::staticData(sizeof(indexData), indexData);
+
+	glEnable(GL_DEPTH_TEST);
+
+	scene.program = program.id();
+	scene.vertexArray = va.id();
+	loaded.store(true, std::memory_order_release);
+	toMain.notify();
+
+	for (;;)
+	{
+		Frame * frame = queue->consume();
+		if (frame == NULL)
+		{
+			break;
+		}
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		for (std::size_t i = 0; i < frame->buffers.size(); i++)
+		{
+			frame->buffers[i].execute();
+		}
+		queue->release();
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR)
+		{
+			std::cerr << error << std::endl;
+			stop(*queue);
+			break;
+		}
+		window->swap();
+	}
+
+	va.destroy();
+	vb.destroy();
+	ib.destroy();
+	program.detach(vertexShader);
+	program.detach(fragmentShader);
+	vertexShader.destroy();
+	fragmentShader.destroy();
+	program.destroy();
+}
+
+
+// The main thread polls window events and runs the simulation. Recording
+// threads fill frame N+1 while the render thread, which owns the GL context,
+// replays frame N and blocks in the driver. The swap on the render thread
+// and the two frame queue pace the frames: FrameScheduler polls and swaps
+// on one thread, which does not fit here.
+int main() {
+
+	Window::init();
+	glfwSetErrorCallback(error_callback);
+	Window window(640, 480, "Title");
+
+	FrameQueue queue(recorders);
+	std::thread renderer(render, &window, &queue);
+	toMain.wait([]
+	{
+		return loaded.load(std::memory_order_acquire) || !running.load(std::memory_order_acquire);
+	});
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < recorders; i++)
+	{
+		threads.push_back(std::thread(record, i));
+	}
+
+	unsigned long number = 0;
+	while (!window.closing())
+	{
+		Window::events();
+		Frame * frame = queue.acquire();
+		if (frame == NULL)
+		{
+			break;
+		}
+		recordTime += 0.005f;
+		frame->number = ++number;
+		frame->arena.reset();
+		recordTarget = frame;
+		recordDone.store(0, std::memory_order_relaxed);
+		recordFrame.store(number, std::memory_order_release);
+		toRecorders.notify();
+		toMain.wait([]
+		{
+			return recordDone.load(std::memory_order_acquire) == recorders || !running.load(std::memory_order_acquire);
+		});
+		if (!running.load(std::memory_order_acquire))
+		{
+			break;
+		}
+		queue.publish();
+	}
+
+	stop(queue);
+	for (std::size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+	renderer.join();
+	window.destroy();
+	Window::terminate();
+	return 0;
+}
@@ -0,0 +1,416 @@
+#include "common/Matrix4f.h"
+#include "common/Quaternion.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+
+
+// Transform hierarchy with incremental world matrix updates.
+//
+// Local transforms (rotation quaternion, translation, uniform scale) live in
+// flat SoA arrays. Slots are kept in breadth-first order: sorted by depth, and
+// within a level by parent. A parent therefore always precedes its children,
+// the children of a node are contiguous, and so is every level of a subtree.
+// update() expands each changed node level by level over those ranges and only
+// touches the nodes that actually need a new world matrix.
+class SceneGraph
+{
+public:
+	typedef uint32_t Node;
+	static const Node none = 0xFFFFFFFF;
+private:
+	// Indexed by slot.
+	std::vector<uint32_t> _parent;
+	std::vector<uint32_t> _depth;
+	std::vector<uint32_t> _childBegin, _childEnd;
+	std::vector<float> _qw, _qx, _qy, _qz;
+	std::vector<float> _tx, _ty, _tz;
+	std::vector<float> _s;
+	std::vector<Matrix4f> _local;
+	std::vector<Matrix4f> _world;
+	std::vector<uint8_t> _dirty;
+	std::vector<uint8_t> _queued;
+	std::vector<Node> _node;
+	// Indexed by node.
+	std::vector<uint32_t> _slot;
+	// Nodes whose local transform changed since the last update.
+	std::vector<Node> _changed;
+	// Scratch, reused between updates.
+	std::vector<uint32_t> _batch;
+	bool _sorted;
+	uint32_t _updated;
+
+	void touch(uint32_t i)
+	{
+		if (!_dirty[i])
+		{
+			_dirty[i] = 1;
+			_changed.push_back(_node[i]);
+		}
+	}
+	void queue(uint32_t i)
+	{
+		if (!_queued[i])
+		{
+			_queued[i] = 1;
+			_batch.push_back(i);
+		}
+	}
+	void local4(const uint32_t * slots, int n)
+	{
+		float qw[4], qx[4], qy[4], qz[4], s[4];
+		for (int i = 0; i < 4; i++)
+		{
+			uint32_t j = slots[i < n ? i : 0];
+			qw[i] = _qw[j]; qx[i] = _qx[j]; qy[i] = _qy[j]; qz[i] = _qz[j];
+			s[i] = _s[j];
+		}
+		__m128 w = _mm_loadu_ps(qw);
+		__m128 x = _mm_loadu_ps(qx);
+		__m128 y = _mm_loadu_ps(qy);
+		__m128 z = _mm_loadu_ps(qz);
+		__m128 sc = _mm_loadu_ps(s);
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 two = _mm_set1_ps(2.0f);
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+		float m[9][4];
+		_mm_storeu_ps(m[0], _mm_mul_ps(sc, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)))));
+		_mm_storeu_ps(m[1], _mm_mul_ps(sc, _mm_mul_ps(two, _mm_add_ps(xy, wz))));
+		_mm_storeu_ps(m[2], _mm_mul_ps(sc, _mm_mul_ps(two, _mm_sub_ps(xz, wy))));
+		_mm_storeu_ps(m[3], _mm_mul_ps(sc, _mm_mul_ps(two, _mm_sub_ps(xy, wz))));
+		_mm_storeu_ps(m[4], _mm_mul_ps(sc, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)))));
+		_mm_storeu_ps(m[5], _mm_mul_ps(sc, _mm_mul_ps(two, _mm_add_ps(yz, wx))));
+		_mm_storeu_ps(m[6], _mm_mul_ps(sc, _mm_mul_ps(two, _mm_add_ps(xz, wy))));
+		_mm_storeu_ps(m[7], _mm_mul_ps(sc, _mm_mul_ps(two, _mm_sub_ps(yz, wx))));
+		_mm_storeu_ps(m[8], _mm_mul_ps(sc, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)))));
+		for (int i = 0; i < n; i++)
+		{
+			uint32_t j = slots[i];
+			Matrix4f& l = _local[j];
+			l.e11 = m[0][i]; l.e21 = m[1][i]; l.e31 = m[2][i]; l.e41 = 0;
+			l.e12 = m[3][i]; l.e22 = m[4][i]; l.e32 = m[5][i]; l.e42 = 0;
+			l.e13 = m[6][i]; l.e23 = m[7][i]; l.e33 = m[8][i]; l.e43 = 0;
+			l.e14 = _tx[j]; l.e24 = _ty[j]; l.e34 = _tz[j]; l.e44 = 1;
+		}
+	}
+	// Recompute the local and world matrices of the slots in _batch, which
+	// must be in ascending slot order.
+	void compute()
+	{
+		std::size_t count = _batch.size();
+		for (std::size_t i = 0; i < count; i += 4)
+		{
+			local4(&_batch[i], std::min<std::size_t>(4, count - i));
+		}
+		for (std::size_t i = 0; i < count; i++)
+		{
+			uint32_t j = _batch[i];
+			uint32_t p = _parent[j];
+			if (p == none)
+			{
+				_world[j] = _local[j];
+			}
+			else
+			{
+				Matrix4f::multiply(_world[p], _local[j], _world[j]);
+			}
+		}
+		_updated = count;
+	}
+public:
+	SceneGraph() : _sorted(true), _updated(0)
+	{}
+	void reserve(std::size_t n)
+	{
+		_parent.reserve(n); _depth.reserve(n);
+		_childBegin.reserve(n); _childEnd.reserve(n);
+		_qw.reserve(n); _qx.reserve(n); _qy.reserve(n); _qz.reserve(n);
+		_tx.reserve(n); _ty.reserve(n); _tz.reserve(n); _s.reserve(n);
+		_local.reserve(n); _world.reserve(n);
+		_dirty.reserve(n); _queued.reserve(n);
+		_node.reserve(n); _slot.reserve(n);
+		_changed.reserve(n); _batch.reserve(n);
+	}
+	std::size_t size() const
+	{
+		return _slot.size();
+	}
+	// Number of world matrices recomputed by the last update().
+	uint32_t updated() const
+	{
+		return _updated;
+	}
+	Node create(Node parent)
+	{
+		if (parent != none && parent >= _slot.size())
+		{
+			throw 0;
+		}
+		Node node = _slot.size();
+		uint32_t slot = _parent.size();
+		uint32_t up = none;
+		uint32_t depth = 0;
+		if (parent != none)
+		{
+			up = _slot[parent];
+			depth = _depth[up] + 1;
+		}
+		_parent.push_back(up);
+		_depth.push_back(depth);
+		_childBegin.push_back(0);
+		_childEnd.push_back(0);
+		_qw.push_back(1); _qx.push_back(0); _qy.push_back(0); _qz.push_back(0);
+		_tx.push_back(0); _ty.push_back(0); _tz.push_back(0);
+		_s.push_back(1);
+		_local.push_back(Matrix4f());
+		_world.push_back(Matrix4f());
+		_dirty.push_back(0);
+		_queued.push_back(0);
+		_node.push_back(node);
+		_slot.push_back(slot);
+		_sorted = false;
+		touch(slot);
+		return node;
+	}
+	void rotation(Node node, const Quaternion& q)
+	{
+		uint32_t i = _slot[node];
+		_qw[i] = q[0]; _qx[i] = q[1]; _qy[i] = q[2]; _qz[i] = q[3];
+		touch(i);
+	}
+	void translation(Node node, float x, float y, float z)
+	{
+		uint32_t i = _slot[node];
+		_tx[i] = x; _ty[i] = y; _tz[i] = z;
+		touch(i);
+	}
+	void scale(Node node, float s)
+	{
+		uint32_t i = _slot[node];
+		_s[i] = s;
+		touch(i);
+	}
+	const Matrix4f& world(Node node) const
+	{
+		return _world[_slot[node]];
+	}
+	// Reorder all slots breadth-first and rebuild the child ranges.
+	void sort()
+	{
+		if (_sorted)
+		{
+			return;
+		}
+		std::size_t n = _parent.size();
+		// Children of every slot, in slot order (counting sort by parent).
+		std::vector<uint32_t> start(n + 2, 0);
+		for (std::size_t i = 0; i < n; i++)
+		{
+			start[(_parent[i] == none ? 0 : _parent[i] + 1) + 1]++;
+		}
+		for (std::size_t i = 0; i <= n; i++)
+		{
+			start[i + 1] += start[i];
+		}
+		std::vector<uint32_t> children(n);
+		for (std::size_t i = 0; i < n; i++)
+		{
+			children[start[_parent[i] == none ? 0 : _parent[i] + 1]++] = i;
+		}
+		// start[k] is now the end of bucket k; bucket 0 holds the roots.
+		std::vector<uint32_t> order;
+		order.reserve(n);
+		order.insert(order.end(), children.begin(), children.begin() + start[0]);
+		for (std::size_t i = 0; i < order.size(); i++)
+		{
+			uint32_t p = order[i];
+			order.insert(order.end(), children.begin() + start[p], children.begin() + start[p + 1]);
+		}
+		std::vector<uint32_t> to(n);
+		for (std::size_t i = 0; i < n; i++)
+		{
+			to[order[i]] = i;
+		}
+		permute(to);
+		uint32_t cursor = 0;
+		while (cursor < n && _parent[cursor] == none)
+		{
+			cursor++;
+		}
+		for (std::size_t i = 0; i < n; i++)
+		{
+			_childBegin[i] = cursor;
+			while (cursor < n && _parent[cursor] == i)
+			{
+				cursor++;
+			}
+			_childEnd[i] = cursor;
+		}
+		_sorted = true;
+	}
+	// Recompute the world matrix of every changed node and its descendants.
+	void update()
+	{
+		sort();
+		_batch.clear();
+		for (std::size_t c = 0; c < _changed.size(); c++)
+		{
+			uint32_t lo = _slot[_changed[c]];
+			uint32_t hi = lo + 1;
+			_dirty[lo] = 0;
+			if (_queued[lo])
+			{
+				// Already reached through a changed ancestor.
+				continue;
+			}
+			while (lo < hi)
+			{
+				for (uint32_t i = lo; i < hi; i++)
+				{
+					queue(i);
+				}
+				uint32_t next = _childBegin[lo];
+				hi = _childEnd[hi - 1];
+				lo = next;
+			}
+		}
+		_changed.clear();
+		std::sort(_batch.begin(), _batch.end());
+		compute();
+		for (std::size_t i = 0; i < _batch.size(); i++)
+		{
+			_queued[_batch[i]] = 0;
+		}
+	}
+	// Recompute everything, ignoring the change list.
+	void rebuild()
+	{
+		sort();
+		for (std::size_t c = 0; c < _changed.size(); c++)
+		{
+			_dirty[_slot[_changed[c]]] = 0;
+		}
+		_changed.clear();
+		_batch.resize(_parent.size());
+		for (std::size_t i = 0; i < _batch.size(); i++)
+		{
+			_batch[i] = i;
+		}
+		compute();
+	}
+private:
+	template <typename T>
+	static void move(std::vector<T>& v, const std::vector<uint32_t>& to)
+	{
+		std::vector<T> r(v.size());
+		for (std::size_t i = 0; i < v.size(); i++)
+		{
+			r[to[i]] = v[i];
+		}
+		v.swap(r);
+	}
+	void permute(const std::vector<uint32_t>& to)
+	{
+		for (std::size_t i = 0; i < _parent.size(); i++)
+		{
+			if (_parent[i] != none)
+			{
+				_parent[i] = to[_parent[i]];
+			}
+		}
+		move(_parent, to); move(_depth, to);
+		move(_qw, to); move(_qx, to); move(_qy, to); move(_qz, to);
+		move(_tx, to); move(_ty, to); move(_tz, to); move(_s, to);
+		move(_local, to); move(_world, to);
+		move(_dirty, to); move(_queued, to);
+		move(_node, to);
+		for (std::size_t i = 0; i < _node.size(); i++)
+		{
+			_slot[_node[i]] = i;
+		}
+	}
+};
+
+
+
+template <typename F>
+static double measure(int runs, F f)
+{
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < runs; i++)
+	{
+		f();
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::micro>(t1 - t0).count() / runs;
+}
+
+
+int main(int argc, char** argv)
+{
+	const int count = 100000;
+	const int fanout = 8;
+	const int changes = count / 100;
+	const int runs = 50;
+
+	SceneGraph graph;
+	graph.reserve(count);
+	std::vector<SceneGraph::Node> nodes;
+	nodes.reserve(count);
+	srand48(1);
+	std::vector<float> angles(count);
+	for (int i = 0; i < count; i++)
+	{
+		angles[i] = drand48();
+	}
+	std::vector<Quaternion> rotations(count, Quaternion(1, 0, 0, 0));
+	Quaternion::axisAngle<TRIG_HIGH>(0, 1, 0, &angles[0], &rotations[0], count);
+	for (int i = 0; i < count; i++)
+	{
+		SceneGraph::Node parent = (i == 0) ? SceneGraph::none : nodes[(i - 1) / fanout];
+		SceneGraph::Node node = graph.create(parent);
+		graph.translation(node, drand48(), drand48(), drand48());
+		graph.rotation(node, rotations[i]);
+		graph.scale(node, 1.0f);
+		nodes.push_back(node);
+	}
+	graph.update();
+
+	double full = measure(runs, [&]() { graph.rebuild(); });
+
+	const int leaves = (count - 1) / fanout + 1;
+	uint32_t updated = 0;
+	float a = 0;
+	double partial = 0;
+	for (int r = 0; r < runs; r++)
+	{
+		a += 0.005f;
+		Quaternion spin = Quaternion::axisAngle<TRIG_HIGH>(0, 1, 0, a);
+		for (int i = 0; i < changes; i++)
+		{
+			// Animated props hang off the leaves of the hierarchy.
+			SceneGraph::Node node = nodes[leaves + lrand48() % (count - leaves)];
+			graph.rotation(node, spin);
+		}
+		partial += measure(1, [&]() { graph.update(); }) / runs;
+		updated += graph.updated();
+	}
+
+	std::cout << "nodes:          " << count << std::endl;
+	std::cout << "full rebuild:   " << full << " us" << std::endl;
+	std::cout << "1% changed:     " << partial << " us (" << updated / runs << " nodes recomputed)" << std::endl;
+	std::cout << "ratio:          " << 100.0 * partial / full << " %" << std::endl;
+	graph.world(nodes[count - 1]).print();
+	return 0;
+}
@@ -0,0 +1,471 @@
+#include "common/Window.h"
+#include "common/Shader.h"
+#include "common/Buffer.h"
+#include "common/Matrix4f.h"
+#include "common/Uniform.h"
+#include "common/FrameScheduler.h"
+
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+
+
+
+// Watches a set of files for changes with inotify. The directories are
+// watched rather than the files themselves, because most editors save by
+// writing a new file and renaming it over the old one.
+class FileWatcher
+{
+private:
+	int _fd;
+	std::vector<int> _watches;
+	std::vector<std::string> _directories;
+	std::vector<std::string> _files;
+
+	static void split(const std::string& path, std::string& directory, std::string& name)
+	{
+		std::size_t slash = path.rfind('/');
+		if (slash == std::string::npos)
+		{
+			directory = ".";
+			name = path;
+		}
+		else
+		{
+			directory = path.substr(0, slash);
+			name = path.substr(slash + 1);
+		}
+	}
+public:
+	FileWatcher()
+	{
+		_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (_fd < 0)
+		{
+			throw 0;
+		}
+	}
+	~FileWatcher()
+	{
+		close(_fd);
+	}
+	// Returns the index reported by poll() when path changes.
+	int add(const std::string& path)
+	{
+		std::string directory, name;
+		split(path, directory, name);
+		int wd = inotify_add_watch(_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (wd < 0)
+		{
+			throw 0;
+		}
+		_watches.push_back(wd);
+		_directories.push_back(directory);
+		_files.push_back(name);
+		return _files.size() - 1;
+	}
+	// Wait up to timeout milliseconds and set changed[i] for every file that
+	// was written since the last call. Returns true if any file changed.
+	bool poll(int timeout, std::vector<bool>& changed)
+	{
+		changed.assign(_files.size(), false);
+		struct pollfd p = {_fd, POLLIN, 0};
+		if (::poll(&p, 1, timeout) <= 0)
+		{
+			return false;
+		}
+		bool any = false;
+		alignas(struct inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = read(_fd, buffer, sizeof(buffer))) > 0)
+		{
+			for (char * i = buffer; i < buffer + length; )
+			{
+				const struct inotify_event * e = reinterpret_cast<const struct inotify_event *>(i);
+				for (std::size_t f = 0; f < _files.size(); f++)
+				{
+					if (e->wd == _watches[f] && e->len > 0 && _files[f] == e->name)
+					{
+						changed[f] = true;
+						any = true;
+					}
+				}
+				i += sizeof(struct inotify_event) + e->len;
+			}
+		}
+		return any;
+	}
+};
+
+
+static GLuint build(const std::string& vertexPath, const std::string& fragmentPath, std::string& log)
+{
+	VertexShader vertexShader;
+	FragmentShader fragmentShader;
+	vertexShader.source(std::ifstream(vertexPath.c_str()));
+	fragmentShader.source(std::ifstream(fragmentPath.c_str()));
+	vertexShader.compile();
+	fragmentShader.compile();
+	if (!vertexShader.status() || !fragmentShader.status())
+	{
+		std::string error;
+		vertexShader.info(error);
+		log = error;
+		fragmentShader.info(error);
+		log += error;
+		vertexShader.destroy();
+		fragmentShader.destroy();
+		return 0;
+	}
+	ShaderProgram program;
+	program.attach(vertexShader);
+	program.attach(fragmentShader);
+	program.link();
+	program.detach(vertexShader);
+	program.detach(fragmentShader);
+	vertexShader.destroy();
+	fragmentShader.destroy();
+	if (!program.status())
+	{
+		program.info(log);
+		program.destroy();
+		return 0;
+	}
+	// The registry passes the name between threads and deletes it itself.
+	return program.disown();
+}
+
+
+// Shader programs that are rebuilt in the background whenever one of their
+// source files changes.
+//
+// A worker thread owns a hidden window whose context shares objects with the
+// main one. It waits for inotify events, recompiles the affected programs and
+// hands each new program over through an atomic slot. The render thread
+// picks it up in update() at a frame boundary, so it never waits on the
+// compiler. A program that fails to build is dropped and the last good one
+// stays in use.
+class ShaderRegistry
+{
+private:
+	struct Entry
+	{
+		std::string vertexPath;
+		std::string fragmentPath;
+		GLuint current;
+		std::atomic<GLuint> pending;
+		unsigned generation;
+	};
+	std::vector<Entry *> _entries;
+	Window * _shared;
+	std::thread _worker;
+	std::atomic<bool> _running;
+
+	void work()
+	{
+		_shared->current();
+		FileWatcher watcher;
+		std::vector<std::size_t> owner;
+		for (std::size_t i = 0; i < _entries.size(); i++)
+		{
+			watcher.add(_entries[i]->vertexPath);
+			owner.push_back(i);
+			watcher.add(_entries[i]->fragmentPath);
+			owner.push_back(i);
+		}
+		std::vector<bool> changed;
+		std::vector<bool> dirty(_entries.size());
+		while (_running.load())
+		{
+			if (!watcher.poll(100, changed))
+			{
+				continue;
+			}
+			// Editors often write a file in several steps, let them finish.
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			std::vector<bool> more;
+			watcher.poll(0, more);
+			dirty.assign(_entries.size(), false);
+			for (std::size_t f = 0; f < changed.size(); f++)
+			{
+				if (changed[f] || more[f])
+				{
+					dirty[owner[f]] = true;
+				}
+			}
+			for (std::size_t i = 0; i < _entries.size(); i++)
+			{
+				if (!dirty[i])
+				{
+					continue;
+				}
+				Entry& e = *_entries[i];
+				std::string log;
+				GLuint program = build(e.vertexPath, e.fragmentPath, log);
+				if (program == 0)
+				{
+					std::cerr << e.vertexPath << " + " << e.fragmentPath << ": keeping last good program" << std::endl << log;
+					continue;
+				}
+				// The render context may only use the program once the
+				// compile and link have completed in this one.
+				glFinish();
+				GLuint stale = e.pending.exchange(program, std::memory_order_acq_rel);
+				if (stale != 0)
+				{
+					glDeleteProgram(stale);
+				}
+			}
+		}
+		glFinish();
+	}
+public:
+	ShaderRegistry() : _shared(NULL), _running(false)
+	{}
+	~ShaderRegistry()
+	{
+		stop();
+		for (std::size_t i = 0; i < _entries.size(); i++)
+		{
+			delete _entries[i];
+		}
+	}
+	// Build a program now, on the calling thread. Returns its index, or -1 if
+	// the initial build failed.
+	int load(const std::string& vertexPath, const std::string& fragmentPath)
+	{
+		if (_running.load())
+		{
+			throw 0;
+		}
+		std::string log;
+		GLuint program = build(vertexPath, fragmentPath, log);
+		if (program == 0)
+		{
+			std::cerr << log;
+			return -1;
+		}
+		Entry * e = new Entry();
+		e->vertexPath = vertexPath;
+		e->fragmentPath = fragmentPath;
+		e->current = program;
+		e->pending.store(0);
+		e->generation = 0;
+		_entries.push_back(e);
+		return _entries.size() - 1;
+	}
+	// Start watching. shared must be a hidden window whose context shares
+	// objects with the render context; it becomes current on the worker.
+	void start(Window& shared)
+	{
+		_shared = &shared;
+		_running.store(true);
+		_worker = std::thread(&ShaderRegistry::work, this);
+	}
+	void stop()
+	{
+		if (_running.exchange(false))
+		{
+			_worker.join();
+		}
+		for (std::size_t i = 0; i < _entries.size(); i++)
+		{
+			GLuint stale = _entries[i]->pending.exchange(0);
+			if (stale != 0)
+			{
+				glDeleteProgram(stale);
+			}
+		}
+	}
+	// Swap in every program that finished building since the last call.
+	// Call on the render thread between frames.
+	void update()
+	{
+		for (std::size_t i = 0; i < _entries.size(); i++)
+		{
+			Entry& e = *_entries[i];
+			GLuint program = e.pending.exchange(0, std::memory_order_acq_rel);
+			if (program != 0)
+			{
+				glDeleteProgram(e.current);
+				e.current = program;
+				e.generation++;
+			}
+		}
+	}
+	void use(int index) const
+	{
+		glUseProgram(_entries[index]->current);
+	}
+	unsigned generation(int index) const
+	{
+		return _entries[index]->generation;
+	}
+	void destroy()
+	{
+		stop();
+		for (std::size_t i = 0; i < _entries.size(); i++)
+		{
+			glDeleteProgram(_entries[i]->current);
+			_entries[i]->current = 0;
+		}
+	}
+};
+
+
+
+static constexpr Matrix4f projection = []
+{
+	Matrix4f m;
+	m.frustum(1.0f, 200.0f, 1.0f, 1.2f);
+	return m;
+}();
+
+
+static void error_callback(int error, const char* description)
+{
+	fputs(description, stderr);
+}
+
+
+int main(int argc, char** argv) {
+
+	Window::init();
+	glfwSetErrorCallback(error_callback);
+	Window window(640, 480, "Title");
+	window.current();
+	FrameScheduler scheduler(argc, argv, window);
+
+	// Shares objects with window, never shown.
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	Window compiler(1, 1, "Shader compiler", window);
+	glfwDefaultWindowHints();
+
+	ShaderRegistry shaders;
+	int cube = shaders.load("vs.glsl", "fs.glsl");
+	if (cube < 0)
+	{
+		compiler.destroy();
+		scheduler.destroy();
+		window.destroy();
+		Window::terminate();
+		return 1;
+	}
+	shaders.start(compiler);
+
+
+	VertexArray va;
+	va.bind();
+
+	ArrayBuffer vb1;
+	vb1.bind();
+	GLfloat vertexData[] =
+	{
+		//  X     Y     Z           R     G     B
+		1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+		-1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+		1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+		-1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+
+		1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+		1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+		1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+		1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+
+		1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+		1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+		-1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+		-1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+
+		1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+		1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+		-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+		-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+
+		-1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+		-1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+		-1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+		-1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+
+		1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+		-1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+		1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 1.0f,
+		-1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 1.0f,
+	};
+	ArrayBuffer::staticData(sizeof(vertexData), vertexData);
+	VertexAttribute<0>::enable();
+	VertexAttribute<0>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0);
+	VertexAttribute<1>::enable();
+	VertexAttribute<1>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0 + 3 * sizeof(GLfloat));
+
+	ElementArrayBuffer ib;
+	ib.bind();
+	GLuint indexData[] = {
+		0, 1, 2, 2, 1, 3,
+		4, 5, 6, 6, 5, 7,
+		8, 9, 10, 10, 9, 11,
+		12, 13, 14, 14, 13, 15,
+		16, 17, 18, 18, 17, 19,
+		20, 21, 22, 22, 21, 23,
+	};
+	ElementArrayBuffer::staticData(sizeof(indexData), indexData);
+
+	glEnable(GL_DEPTH_TEST);
+
+	Matrix4f mvp;
+
+	float a = 0;
+	unsigned generation = 0;
+	while (scheduler.wait())
+	{
+		shaders.update();
+		if (shaders.generation(cube) != generation)
+		{
+			generation = shaders.generation(cube);
+			std::cout << "reloaded vs.glsl + fs.glsl (" << generation << ")" << std::endl;
+		}
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		shaders.use(cube);
+
+		a += 0.005f;
+		float t = SimdTrig<TRIG_HIGH>::tan(a);
+		mvp = projection;
+		mvp.translate(0, 0, -3 + t);
+		mvp.rotateY<TRIG_HIGH>(a);
+		mvp.rotateZ<TRIG_HIGH>(t);
+		Uniform<2>::matrix4f(mvp);
+
+		va.bind();
+		VertexArray::drawElements(GL_LINES, 36, GL_UNSIGNED_INT, (char*)0);
+
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR)
+		{
+			std::cerr << error << std::endl;
+			break;
+		}
+		scheduler.present();
+	}
+
+	shaders.destroy();
+	va.destroy();
+	vb1.destroy();
+	ib.destroy();
+	compiler.destroy();
+	scheduler.destroy();
+	window.destroy();
+	Window::terminate();
+	return 0;
+}
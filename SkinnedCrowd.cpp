@@ -0,0 +1,403 @@
+#include "common/Window.h"
+#include "common/Shader.h"
+#include "common/Buffer.h"
+#include "common/Matrix4f.h"
+#include "common/Uniform.h"
+#include "common/DualQuaternion.h"
+#include "common/Skinning.h"
+#include "common/JobSystem.h"
+#include "common/FrameScheduler.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <type_traits>
+
+#define GLSL(src) "#version 430\n" #src
+
+
+// A field of swaying, twisting tubes, each a mesh with its own chain of
+// bones, all skinned with dual quaternions every frame.
+//
+//   --meshes N     tubes, 256 by default, BONES bones each
+//   --skin cpu     Skinning on the JobSystem, positions and normals
+//                  uploaded every frame, the default
+//   --skin gpu     bones in a shader storage buffer, blended in the vertex
+//                  shader from static rest pose and weight streams
+//   --pacing, --rate as in FrameScheduler.h
+
+static constexpr Matrix4f projection = []
+{
+	Matrix4f m;
+	m.perspective(0.5f, 200.0f, 0.4f, 0.3f);
+	return m;
+}();
+
+static const int RINGS = 32;
+static const int SIDES = 16;
+static const int BONES = 16;
+static const float LENGTH = 4.0f;
+static const float RADIUS = 0.15f;
+static const float SPACING = 1.5f;
+
+// --skin gpu uploads the palette as is: the shader reads each bone as two
+// vec4, real part then dual part, each scalar first as in Quaternion.
+static_assert(sizeof(DualQuaternion) == 8 * sizeof(float) && std::is_standard_layout_v<DualQuaternion>,
+	"DualQuaternion must be eight packed floats to upload");
+
+
+static void error_callback(int error, const char* description)
+{
+	fputs(description, stderr);
+}
+
+template <GLenum TYPE>
+static bool compile(Shader<TYPE>& shader, const std::string& source)
+{
+	shader.source(source);
+	shader.compile();
+	if (!shader.status())
+	{
+		std::string error;
+		shader.info(error);
+		std::cerr << error;
+		return false;
+	}
+	return true;
+}
+
+static bool link(ShaderProgram& program, VertexShader& vertex, FragmentShader& fragment)
+{
+	program.attach(vertex);
+	program.attach(fragment);
+	program.link();
+	program.detach(vertex);
+	program.detach(fragment);
+	if (!program.status())
+	{
+		std::string error;
+		program.info(error);
+		std::cerr << error;
+		return false;
+	}
+	return true;
+}
+
+
+int main(int argc, char** argv) {
+
+	int meshes = 256;
+	bool gpu = false;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--meshes")
+		{
+			meshes = std::max(1, atoi(argv[++i]));
+		}
+		else if (arg == "--skin")
+		{
+			gpu = std::string(argv[++i]) == "gpu";
+		}
+	}
+
+	Window::init();
+	Window window(640, 480, "Title");
+	glfwSetErrorCallback(error_callback);
+	window.current();
+	FrameScheduler scheduler(argc, argv, window);
+
+	std::string skinnedSource = GLSL
+	(
+		layout(location = 0) in vec3 vposition;
+		layout(location = 1) in vec3 vnormal;
+		layout(location = 2) in uvec4 vbones;
+		layout(location = 3) in vec4 vweights;
+		layout(location = 0) uniform mat4 viewProjection;
+		struct Bone
+		{
+			vec4 real;
+			vec4 dual;
+		};
+		layout(std430, binding = 0) readonly buffer Bones { Bone bones[]; };
+		out vec3 fnormal;
+		vec3 rotate(vec4 q, vec3 v)
+		{
+			return v + 2.0 * cross(q.yzw, cross(q.yzw, v) + q.x * v);
+		}
+		void main()
+		{
+			Bone pivot = bones[vbones.x];
+			vec4 real = vec4(0.0);
+			vec4 dual = vec4(0.0);
+			for (int k = 0; k < 4; k++)
+			{
+				Bone b = bones[vbones[k]];
+				float w = dot(b.real, pivot.real) < 0.0 ? -vweights[k] : vweights[k];
+				real += w * b.real;
+				dual += w * b.dual;
+			}
+			float inverse = 1.0 / length(real);
+			real *= inverse;
+			dual *= inverse;
+			vec3 translation = 2.0 * (real.x * dual.yzw - dual.x * real.yzw + cross(real.yzw, dual.yzw));
+			fnormal = rotate(real, vnormal);
+			gl_Position = viewProjection * vec4(rotate(real, vposition) + translation, 1.0);
+		}
+	);
+	std::string plainSource = GLSL
+	(
+		layout(location = 0) in vec3 vposition;
+		layout(location = 1) in vec3 vnormal;
+		layout(location = 0) uniform mat4 viewProjection;
+		out vec3 fnormal;
+		void main()
+		{
+			fnormal = vnormal;
+			gl_Position = viewProjection * vec4(vposition, 1.0);
+		}
+	);
+	std::string fragmentSource = GLSL
+	(
+		in vec3 fnormal;
+		layout(location = 0) out vec4 FragColor;
+		void main()
+		{
+			vec3 n = normalize(fnormal);
+			float light = 0.3 + 0.7 * max(dot(n, normalize(vec3(0.3, 0.8, 0.5))), 0.0);
+			FragColor = vec4((0.5 + 0.5 * n) * light, 1.0);
+		}
+	);
+
+	VertexShader vertexShader;
+	FragmentShader fragmentShader;
+	ShaderProgram program;
+	bool ok = compile(vertexShader, gpu ? skinnedSource : plainSource) && compile(fragmentShader, fragmentSource)
+		&& link(program, vertexShader, fragmentShader);
+	vertexShader.destroy();
+	fragmentShader.destroy();
+	if (!ok)
+	{
+		program.destroy();
+		scheduler.destroy();
+		window.destroy();
+		Window::terminate();
+		return 1;
+	}
+
+	// Rest pose: tube m stands at its grid position, rings blended between
+	// the two nearest bones.
+	int columns = 1;
+	while (columns * columns < meshes)
+	{
+		columns++;
+	}
+	const int ringVertices = SIDES + 1;
+	const std::size_t meshVertices = std::size_t(RINGS) * ringVertices;
+	const std::size_t vertexCount = meshVertices * meshes;
+	const std::size_t boneCount = std::size_t(BONES) * meshes;
+	const float bone = LENGTH / BONES;
+	std::vector<GLfloat> rest(vertexCount * 6);
+	std::vector<GLuint> influences(vertexCount * 4);
+	std::vector<GLfloat> weights(vertexCount * 4);
+	std::vector<GLuint> indices;
+	std::vector<float> bases(meshes * 3);
+	Skinning skinning(vertexCount, boneCount);
+	for (int m = 0; m < meshes; m++)
+	{
+		float * base = &bases[m * 3];
+		base[0] = ((m % columns) - 0.5f * (columns - 1)) * SPACING;
+		base[1] = 0;
+		base[2] = ((m / columns) - 0.5f * (columns - 1)) * SPACING;
+		for (int r = 0; r < RINGS; r++)
+		{
+			float y = LENGTH * r / (RINGS - 1);
+			float t = std::min(std::max(y / bone - 0.5f, 0.0f), BONES - 1.0f);
+			int b0 = std::min(int(t), BONES - 2);
+			float w1 = t - b0;
+			for (int s = 0; s < ringVertices; s++)
+			{
+				std::size_t v = m * meshVertices + r * ringVertices + s;
+				float sinus, cosin;
+				SimdTrig<TRIG_MEDIUM>::sincos(6.2831853f * s / SIDES, sinus, cosin);
+				float * p = &rest[v * 6];
+				p[0] = base[0] + RADIUS * cosin;
+				p[1] = base[1] + y;
+				p[2] = base[2] + RADIUS * sinus;
+				p[3] = cosin;
+				p[4] = 0;
+				p[5] = sinus;
+				GLuint * i = &influences[v * 4];
+				GLfloat * w = &weights[v * 4];
+				i[0] = GLuint(m * BONES + b0);
+				i[1] = i[0] + 1;
+				i[2] = i[0];
+				i[3] = i[0];
+				w[0] = 1.0f - w1;
+				w[1] = w1;
+				w[2] = 0;
+				w[3] = 0;
+				skinning.vertex(v, p, p + 3, i, w);
+			}
+		}
+		for (int r = 0; r + 1 < RINGS; r++)
+		{
+			for (int s = 0; s < SIDES; s++)
+			{
+				GLuint a = GLuint(m * meshVertices + r * ringVertices + s);
+				GLuint b = a + ringVertices;
+				const GLuint quad[] = {a, b, a + 1, a + 1, b, b + 1};
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	VertexArray va;
+	va.bind();
+	ArrayBuffer vertexBuffer;
+	vertexBuffer.bind();
+	if (gpu)
+	{
+		ArrayBuffer::staticData(rest.size() * sizeof(GLfloat), &rest[0]);
+	}
+	else
+	{
+		ArrayBuffer::data(rest.size() * sizeof(GLfloat), NULL, GL_STREAM_DRAW);
+	}
+	VertexAttribute<0>::enable();
+	VertexAttribute<0>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0);
+	VertexAttribute<1>::enable();
+	VertexAttribute<1>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0 + 3 * sizeof(GLfloat));
+	ArrayBuffer influenceBuffer;
+	ArrayBuffer weightBuffer;
+	ShaderStorageBuffer boneBuffer;
+	if (gpu)
+	{
+		influenceBuffer.bind();
+		ArrayBuffer::staticData(influences.size() * sizeof(GLuint), &influences[0]);
+		VertexAttribute<2>::enable();
+		VertexAttribute<2>::setInteger(4, GL_UNSIGNED_INT, 4 * sizeof(GLuint), (char*)0);
+		weightBuffer.bind();
+		ArrayBuffer::staticData(weights.size() * sizeof(GLfloat), &weights[0]);
+		VertexAttribute<3>::enable();
+		VertexAttribute<3>::set(4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (char*)0);
+		boneBuffer.bind();
+		ShaderStorageBuffer::data(boneCount * sizeof(DualQuaternion), NULL, GL_STREAM_DRAW);
+	}
+	ElementArrayBuffer indexBuffer;
+	indexBuffer.bind();
+	ElementArrayBuffer::staticData(indices.size() * sizeof(GLuint), &indices[0]);
+
+	JobSystem jobs(std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<DualQuaternion> palette(boneCount, DualQuaternion::identity());
+
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
+
+	int result = 0;
+	unsigned long frames = 0;
+	double poseMs = 0;
+	double skinMs = 0;
+	float time = 0;
+	while (scheduler.wait())
+	{
+
+		auto t0 = std::chrono::steady_clock::now();
+		// Every bone bends about z and twists about y relative to its parent.
+		// Its skinning transform is the posed chain times the inverse of its
+		// rest transform, a translation up the tube.
+		for (int m = 0; m < meshes; m++)
+		{
+			const float * base = &bases[m * 3];
+			float phase = base[0] * 0.4f + base[2] * 0.3f;
+			DualQuaternion chain = DualQuaternion::translation(base[0], base[1], base[2]);
+			for (int b = 0; b < BONES; b++)
+			{
+				Quaternion rotation = Quaternion::axisAngle<TRIG_LOW>(0, 0, 1, 0.12f * SimdTrig<TRIG_LOW>::sin(time * 2.0f + phase + b * 0.3f));
+				rotation.apply(Quaternion::axisAngle<TRIG_LOW>(0, 1, 0, 0.2f * SimdTrig<TRIG_LOW>::sin(time + phase)));
+				chain.apply(DualQuaternion::rigid(rotation, 0, b == 0 ? 0 : bone, 0));
+				DualQuaternion skin = chain;
+				skin.apply(DualQuaternion::translation(-base[0], -base[1] - b * bone, -base[2]));
+				palette[m * BONES + b] = skin;
+			}
+		}
+		if (gpu)
+		{
+			boneBuffer.bind();
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, palette.size() * sizeof(DualQuaternion), &palette[0]);
+			boneBuffer.bindBase(0);
+		}
+		else
+		{
+			for (std::size_t b = 0; b < boneCount; b++)
+			{
+				skinning.bone(b, palette[b]);
+			}
+			auto s0 = std::chrono::steady_clock::now();
+			skinning.skin(jobs);
+			skinMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s0).count();
+			vertexBuffer.bind();
+			ArrayBuffer::data(rest.size() * sizeof(GLfloat), NULL, GL_STREAM_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, rest.size() * sizeof(GLfloat), skinning.output());
+		}
+		poseMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+		int width, height;
+		glfwGetFramebufferSize(window.handle(), &width, &height);
+		glViewport(0, 0, width, height);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		Matrix4f viewProjection = projection;
+		viewProjection.translate(0, -LENGTH, -1.2f * columns * SPACING);
+		viewProjection.rotateY<TRIG_LOW>(time * 0.1f);
+		program.use();
+		Uniform<0>::matrix4f(viewProjection);
+		va.bind();
+		VertexArray::drawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR)
+		{
+			std::cerr << error << std::endl;
+			result = 1;
+			break;
+		}
+		scheduler.present();
+		time += 1.0f / 60.0f;
+		frames++;
+		if (frames % 120 == 0)
+		{
+			std::cout << std::fixed << std::setprecision(3) << meshes << " meshes, " << boneCount << " bones, "
+				<< vertexCount << " vertices  ";
+			if (gpu)
+			{
+				std::cout << "pose and upload " << poseMs / 120 << " ms" << std::endl;
+			}
+			else
+			{
+				std::cout << "pose, skin and upload " << poseMs / 120 << " ms  skin " << skinMs / 120 << " ms  "
+					<< vertexCount * 120 / skinMs * 1e-3 << " Mvertices/s skinned" << std::endl;
+			}
+			poseMs = 0;
+			skinMs = 0;
+		}
+	}
+
+	va.destroy();
+	vertexBuffer.destroy();
+	influenceBuffer.destroy();
+	weightBuffer.destroy();
+	boneBuffer.destroy();
+	indexBuffer.destroy();
+	program.destroy();
+	scheduler.destroy();
+	window.destroy();
+	Window::terminate();
+	return result;
+}
@@ -0,0 +1,198 @@
+#include "common/SoftRaster.h"
+#include "common/JobSystem.h"
+#include "common/Matrix4f.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+
+// Cube1 and IndexBuffer without a GPU: the same vertex and index arrays and
+// the same MVP go through SoftRaster instead of glDrawElements.
+//
+//   --frames N       frames to render, 300 by default
+//   --threads N      workers, all cores by default
+//   --triangles      fill Cube1's cube instead of drawing it as GL_LINES
+//   --quad           IndexBuffer's quad instead of the cube
+//   --out file.ppm   write the last frame
+
+static constexpr Matrix4f projection = []
+{
+	Matrix4f m;
+	m.frustum(1.0f, 200.0f, 1.0f, 1.2f);
+	return m;
+}();
+
+static const int width = 640;
+static const int height = 480;
+
+static const float cubeVertices[] =
+{
+	//  X     Y     Z           R     G     B
+	// face 0:
+	1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, // vertex 0
+	-1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, // vertex 1
+	1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f, // vertex 2
+	-1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f, // vertex 3
+
+	// face 1:
+	1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, // vertex 0
+	1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 0.0f, // vertex 1
+	1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 0.0f, // vertex 2
+	1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 0.0f, // vertex 3
+
+	// face 2:
+	1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, // vertex 0
+	1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, // vertex 1
+	-1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, // vertex 2
+	-1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, // vertex 3
+
+	// face 3:
+	1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f, // vertex 0
+	1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f, // vertex 1
+	-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f, // vertex 2
+	-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f, // vertex 3
+
+	// face 4:
+	-1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f, // vertex 0
+	-1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 1.0f, // vertex 1
+	-1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f, // vertex 2
+	-1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 1.0f, // vertex 3
+
+	// face 5:
+	1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f, // vertex 0
+	-1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f, // vertex 1
+	1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 1.0f, // vertex 2
+	-1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 1.0f, // vertex 3
+};
+
+static const uint32_t cubeIndices[] =
+{
+	0, 1, 2, 2, 1, 3,
+	4, 5, 6, 6, 5, 7,
+	8, 9, 10, 10, 9, 11,
+	12, 13, 14, 14, 13, 15,
+	16, 17, 18, 18, 17, 19,
+	20, 21, 22, 22, 21, 23,
+};
+
+static const float quadVertices[] =
+{
+	1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+	-1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+	1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+	-1.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+};
+
+static const uint32_t quadIndices[] =
+{
+	0, 1, 2,
+	2, 1, 3,
+};
+
+
+// Binary PPM, top row first.
+static bool writePPM(const std::string& path, const SoftRaster& raster)
+{
+	std::ofstream file(path, std::ios::binary);
+	file << "P6\n" << raster.width() << " " << raster.height() << "\n255\n";
+	std::string row(raster.width() * 3, 0);
+	for (int y = raster.height() - 1; y >= 0; y--)
+	{
+		const uint32_t * pixels = raster.pixels() + std::size_t(y) * raster.width();
+		for (int x = 0; x < raster.width(); x++)
+		{
+			row[x * 3] = char(pixels[x] & 0xff);
+			row[x * 3 + 1] = char((pixels[x] >> 8) & 0xff);
+			row[x * 3 + 2] = char((pixels[x] >> 16) & 0xff);
+		}
+		file.write(&row[0], row.size());
+	}
+	return bool(file);
+}
+
+
+int main(int argc, char** argv) {
+
+	int frames = 300;
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	bool triangles = false;
+	bool quad = false;
+	std::string out;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--frames" && i + 1 < argc)
+		{
+			frames = std::max(1, atoi(argv[++i]));
+		}
+		else if (arg == "--threads" && i + 1 < argc)
+		{
+			threads = std::max(1, atoi(argv[++i]));
+		}
+		else if (arg == "--triangles")
+		{
+			triangles = true;
+		}
+		else if (arg == "--quad")
+		{
+			quad = true;
+		}
+		else if (arg == "--out" && i + 1 < argc)
+		{
+			out = argv[++i];
+		}
+	}
+
+	JobSystem jobs(threads);
+	SoftRaster raster(jobs, width, height);
+	SoftRaster::Mode mode = triangles || quad ? SoftRaster::TRIANGLES : SoftRaster::LINES;
+	const float * vertices = quad ? quadVertices : cubeVertices;
+	std::size_t vertexCount = quad ? 4 : 24;
+	const uint32_t * indices = quad ? quadIndices : cubeIndices;
+	std::size_t indexCount = quad ? 6 : 36;
+
+	Matrix4f mvp;
+	mvp.identity();
+	uint64_t primitives = 0;
+	uint64_t fragments = 0;
+	auto t0 = std::chrono::steady_clock::now();
+	// Cube1's animation, one fixed step per frame.
+	float a = 0;
+	for (int f = 0; f < frames; f++)
+	{
+		if (!quad)
+		{
+			a += 0.005f;
+			float t = SimdTrig<TRIG_HIGH>::tan(a);
+			mvp = projection;
+			mvp.translate(0, 0, -3 + t);
+			mvp.rotateY<TRIG_HIGH>(a);
+			mvp.rotateZ<TRIG_HIGH>(t);
+		}
+		raster.clear();
+		raster.draw(mode, vertices, vertexCount, 6, indices, indexCount, mvp);
+		primitives += indexCount / (mode == SoftRaster::TRIANGLES ? 3 : 2);
+		fragments += raster.fragments();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	std::cout << std::fixed << std::setprecision(3)
+		<< frames << " frames on " << jobs.size() << " threads: "
+		<< seconds * 1000.0 / frames << " ms/frame, "
+		<< primitives / seconds * 1e-6 << " M" << (mode == SoftRaster::TRIANGLES ? "triangles" : "lines") << "/s, "
+		<< fragments / seconds * 1e-6 << " Mpixels/s" << std::endl;
+
+	if (!out.empty() && !writePPM(out, raster))
+	{
+		std::cerr << "could not write " << out << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -1,9 +1,15 @@
-#include <GLFW/glfw3.h>
+#include "common/GL.h"
+#include "common/FrameCapture.h"
+#include "common/FrameRecorder.h"
+#include "common/FrameScheduler.h"
+
 #include <stdlib.h>
 
 
+const int width = 640;
+const int height = 480;
 
-int main(void)
+int main(int argc, char** argv)
 {
 
   GLFWwindow* window;
@@ -14,8 +20,15 @@ int main(void)
   }
 
 
+  /* Headless with --capture, see FrameCapture.h */
+  FrameCapture capture(argc, argv, "StaticNoise", width, height);
+  capture.hints();
+
+  /* --record out.y4m or --record dir, see FrameRecorder.h */
+  FrameRecorder recorder(argc, argv, "StaticNoise", width, height);
+
   /* Create a windowed mode window and its OpenGL context */
-  window = glfwCreateWindow(640, 480, "Hello World", NULL, NULL);
+  window = glfwCreateWindow(width, height, "Hello World", NULL, NULL);
   if (!window)
   {
     glfwTerminate();
@@ -24,34 +37,48 @@ int main(void)
 
   /* Make the window's context current */
   glfwMakeContextCurrent(window);
+#ifdef USE_GLEW
+  glewInit();
+#endif
 
+  /* --pacing and --rate, see FrameScheduler.h */
+  FrameScheduler scheduler(argc, argv, window);
 
 
-  const int size = 640*480*3;
+
+  const int size = width*height*3;
   float * pixels = new float[size];
 
 
 
+  /* Same noise on every run */
+  Random random(capture.seed());
+
   /* Loop until the user closes the window */
-  while (!glfwWindowShouldClose(window))
+  while (scheduler.wait() && !capture.done() && !recorder.done())
   {
 
     for(int i=0;i<size;i++)
     {
-      pixels[i] = drand48();
+      pixels[i] = random.uniform();
     }
 
 
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  glDrawPixels(650,480,GL_RGB,GL_FLOAT,pixels);
+  glDrawPixels(width,height,GL_RGB,GL_FLOAT,pixels);
 
 
-  /* Swap front and back buffers */
-  glfwSwapBuffers(window);
+  capture.frame();
+  recorder.frame();
 
-  /* Poll for and process events */
-  glfwPollEvents();
+  /* Swap front and back buffers, poll events in wait() */
+  scheduler.present();
   }
 
+  int result = capture.finish();
+  result |= recorder.finish();
+  delete [] pixels;
+  scheduler.destroy();
   glfwTerminate();
+  return result;
 }
@@ -1,4 +1,8 @@
-#include <GLFW/glfw3.h>
+#include "common/GL.h"
+#include "common/FrameCapture.h"
+#include "common/FrameRecorder.h"
+#include "common/FrameScheduler.h"
+
 #include <stdlib.h>
 
 
@@ -16,7 +20,7 @@ const int height = 480;
 
 
 
-int main(void)
+int main(int argc, char** argv)
 {
 
   GLFWwindow* window;
@@ -27,6 +31,13 @@ int main(void)
   }
 
 
+  /* Headless with --capture, see FrameCapture.h */
+  FrameCapture capture(argc, argv, "StaticNoise2", width, height);
+  capture.hints();
+
+  /* --record out.y4m or --record dir, see FrameRecorder.h */
+  FrameRecorder recorder(argc, argv, "StaticNoise2", width, height);
+
   /* Create a windowed mode window and its OpenGL context */
   window = glfwCreateWindow(width, height, "Hello World", NULL, NULL);
   if (!window)
@@ -37,6 +48,12 @@ int main(void)
 
   /* Make the window's context current */
   glfwMakeContextCurrent(window);
+#ifdef USE_GLEW
+  glewInit();
+#endif
+
+  /* --pacing and --rate, see FrameScheduler.h */
+  FrameScheduler scheduler(argc, argv, window);
 
 
 
@@ -45,15 +62,18 @@ int main(void)
 
 
 
+  /* Same noise on every run */
+  Random random(capture.seed());
+
   /* Loop until the user closes the window */
-  while (!glfwWindowShouldClose(window))
+  while (scheduler.wait() && !capture.done() && !recorder.done())
   {
     for(int y=0;y<height;y++)
     for(int x=0;x<width;x++)
     {
       Pixel * pixel = &pixels[y*width+x];
       pixel->r = 1.0;
-      pixel->g = drand48();
+      pixel->g = random.uniform();
       pixel->b = 1.0;
     }
 
@@ -62,12 +82,17 @@ int main(void)
   glDrawPixels(width,height,GL_RGB,GL_FLOAT,pixels);
 
 
-  /* Swap front and back buffers */
-  glfwSwapBuffers(window);
+  capture.frame();
+  recorder.frame();
 
-  /* Poll for and process events */
-  glfwPollEvents();
+  /* Swap front and back buffers, poll events in wait() */
+  scheduler.present();
   }
 
+  int result = capture.finish();
+  result |= recorder.finish();
+  delete [] pixels;
+  scheduler.destroy();
   glfwTerminate();
+  return result;
 }
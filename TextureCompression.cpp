@@ -0,0 +1,343 @@
+#include "common/Window.h"
+#include "common/Shader.h"
+#include "common/Buffer.h"
+#include "common/FrameScheduler.h"
+#include "common/BlockCompression.h"
+#include "common/JobSystem.h"
+#include "common/Random.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#define GLSL(src) "#version 430\n" #src
+
+
+
+// StaticNoise2's frame, white with noise in green, uploaded as a texture
+// every frame in one of several formats and drawn over the window. Every 60
+// frames it prints the time to fill, encode and upload a frame, the bytes
+// uploaded against the RGB float frame of StaticNoise2 and RGBA8, and the
+// PSNR of the texture against the RGBA8 frame.
+//
+// bc1 and bc4 encode every frame on the JobSystem. bc4 keeps only the green
+// channel, the texture swizzle puts back white in red and blue. bc7 is an
+// offline format: the first frame is converted once and uploaded again
+// every frame.
+//
+//   --format F     float, rgba8, bc1 (default), bc4 or bc7
+//   --content C    noise (default) or plasma, a smooth moving pattern
+//   --threads N    fill and encode threads, all cores by default
+//   --pacing, --rate as in FrameScheduler.h
+
+const int width = 640;
+const int height = 480;
+
+enum Format
+{
+	FLOAT,
+	RGBA8,
+	BC1,
+	BC4,
+	BC7
+};
+
+struct TextureFormat
+{
+	const char * name;
+	GLenum internalFormat;
+	BlockCompression::Format blocks;
+};
+
+static const TextureFormat FORMATS[] =
+{
+	{"float", GL_RGB32F, BlockCompression::BC1},
+	{"rgba8", GL_RGBA8, BlockCompression::BC1},
+	{"bc1", GL_COMPRESSED_RGB_S3TC_DXT1_EXT, BlockCompression::BC1},
+	{"bc4", GL_COMPRESSED_RED_RGTC1, BlockCompression::BC4},
+	{"bc7", GL_COMPRESSED_RGBA_BPTC_UNORM, BlockCompression::BC7},
+};
+
+struct Fill
+{
+	float * rgb;
+	uint8_t * rgba;
+	bool plasma;
+	uint32_t frame;
+};
+
+// Counter based noise like NoiseBench's, so chunks fill independently.
+static void fill(std::size_t begin, std::size_t end, void * context)
+{
+	const Fill& f = *static_cast<const Fill *>(context);
+	float t = f.frame * 0.05f;
+	for (std::size_t i = begin; i < end; i++)
+	{
+		float g;
+		if (f.plasma)
+		{
+			float x = float(i % width), y = float(i / width);
+			g = 0.5f + 0.25f * (std::sin(x * 0.031f + t) + std::sin((x + y) * 0.017f - t * 1.3f));
+		}
+		else
+		{
+			g = Random::uniform(uint32_t(i), f.frame);
+		}
+		if (f.rgb)
+		{
+			f.rgb[i * 3] = 1.0f;
+			f.rgb[i * 3 + 1] = g;
+			f.rgb[i * 3 + 2] = 1.0f;
+		}
+		else
+		{
+			f.rgba[i * 4] = 255;
+			f.rgba[i * 4 + 1] = uint8_t(g * 255.0f + 0.5f);
+			f.rgba[i * 4 + 2] = 255;
+			f.rgba[i * 4 + 3] = 255;
+		}
+	}
+}
+
+static double milliseconds(std::chrono::steady_clock::duration d)
+{
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+static void error_callback(int error, const char* description)
+{
+	fputs(description, stderr);
+}
+
+template <GLenum TYPE>
+static void compile(Shader<TYPE>& shader, const std::string& source)
+{
+	shader.source(source);
+	shader.compile();
+	if (!shader.status())
+	{
+		std::string errorMsg;
+		shader.info(errorMsg);
+		std::cerr << errorMsg;
+	}
+}
+
+static ShaderProgram program(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	VertexShader vertexShader;
+	FragmentShader fragmentShader;
+	compile(vertexShader, vertexSource);
+	compile(fragmentShader, fragmentSource);
+	ShaderProgram p;
+	p.attach(vertexShader);
+	p.attach(fragmentShader);
+	p.link();
+	vertexShader.destroy();
+	fragmentShader.destroy();
+	if (!p.status())
+	{
+		std::string errorMsg;
+		p.info(errorMsg);
+		std::cerr << errorMsg;
+		p.destroy();
+	}
+	return p;
+}
+
+
+int main(int argc, char** argv) {
+
+	Format format = BC1;
+	bool plasma = false;
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--format")
+		{
+			std::string name = argv[++i];
+			for (int f = FLOAT; f <= BC7; f++)
+			{
+				if (name == FORMATS[f].name)
+				{
+					format = Format(f);
+				}
+			}
+		}
+		else if (arg == "--content")
+		{
+			plasma = std::string(argv[++i]) == "plasma";
+		}
+		else if (arg == "--threads")
+		{
+			threads = std::max(1, atoi(argv[++i]));
+		}
+	}
+	const TextureFormat& texture = FORMATS[format];
+	bool compressed = format >= BC1;
+
+	Window::init();
+	Window window(width, height, "Title");
+	glfwSetErrorCallback(error_callback);
+	window.current();
+	FrameScheduler scheduler(argc, argv, window);
+
+	ShaderProgram draw = program(GLSL
+	(
+		out vec2 fuv;
+		void main()
+		{
+			// One triangle covering the window.
+			vec2 p = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+			fuv = p * 0.5 + 0.5;
+			gl_Position = vec4(p, 0.0, 1.0);
+		}
+	), GLSL
+	(
+		layout(binding = 0) uniform sampler2D image;
+		in vec2 fuv;
+		layout(location = 0) out vec4 FragColor;
+		void main()
+		{
+			FragColor = texture(image, fuv);
+		}
+	));
+	if (draw.id() == 0)
+	{
+		scheduler.destroy();
+		window.destroy();
+		Window::terminate();
+		return 1;
+	}
+	VertexArray va;
+
+	GLuint id;
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_2D, id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	if (format == BC4)
+	{
+		GLint swizzle[4] = {GL_ONE, GL_RED, GL_ONE, GL_ONE};
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	}
+
+	JobSystem jobs(threads);
+	std::vector<float> rgb(format == FLOAT ? width * height * 3 : 0);
+	std::vector<uint8_t> rgba(format == FLOAT ? 0 : width * height * 4);
+	std::vector<uint8_t> blocks(compressed ? BlockCompression::size(texture.blocks, width, height) : 0);
+	std::size_t bytes = format == FLOAT ? rgb.size() * sizeof(float) : compressed ? blocks.size() : rgba.size();
+
+	int result = 0;
+	uint32_t frame = 0;
+	int frames = 0;
+	double fillMs = 0, encodeMs = 0, uploadMs = 0;
+	while (scheduler.wait())
+	{
+		// The previous frame's draw must not count towards this upload.
+		glFinish();
+		auto t0 = std::chrono::steady_clock::now();
+		if (format != BC7 || frame == 0)
+		{
+			Fill f = {rgb.empty() ? NULL : &rgb[0], rgba.empty() ? NULL : &rgba[0], plasma, frame};
+			jobs.parallel_for(width * height, fill, &f);
+		}
+		auto t1 = std::chrono::steady_clock::now();
+		if (compressed && (format != BC7 || frame == 0))
+		{
+			BlockCompression::encode(jobs, texture.blocks, &rgba[0], width, height, &blocks[0], 1);
+		}
+		auto t2 = std::chrono::steady_clock::now();
+
+		// glFinish so the time includes the copy of the driver, not only
+		// queuing it.
+		if (frame == 0 && compressed)
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, 0, texture.internalFormat, width, height, 0, GLsizei(blocks.size()), &blocks[0]);
+		}
+		else if (compressed)
+		{
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, texture.internalFormat, GLsizei(blocks.size()), &blocks[0]);
+		}
+		else if (frame == 0)
+		{
+			glTexImage2D(GL_TEXTURE_2D, 0, texture.internalFormat, width, height, 0, format == FLOAT ? GL_RGB : GL_RGBA,
+				format == FLOAT ? GL_FLOAT : GL_UNSIGNED_BYTE, format == FLOAT ? (const void *)&rgb[0] : &rgba[0]);
+		}
+		else
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format == FLOAT ? GL_RGB : GL_RGBA,
+				format == FLOAT ? GL_FLOAT : GL_UNSIGNED_BYTE, format == FLOAT ? (const void *)&rgb[0] : &rgba[0]);
+		}
+		glFinish();
+		auto t3 = std::chrono::steady_clock::now();
+
+		glViewport(0, 0, width, height);
+		draw.use();
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, id);
+		va.bind();
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR)
+		{
+			std::cerr << error << std::endl;
+			result = 1;
+			break;
+		}
+		scheduler.present();
+
+		if (format != BC7 || frame == 0)
+		{
+			fillMs += milliseconds(t1 - t0);
+			encodeMs += milliseconds(t2 - t1);
+		}
+		uploadMs += milliseconds(t3 - t2);
+		frame++;
+		frames++;
+		if (frame % 60 == 0)
+		{
+			// bc7 encoded once, its times are of that frame.
+			int encoded = format == BC7 ? 1 : frames;
+			std::cout << std::fixed << std::setprecision(2) << texture.name
+				<< "  fill " << fillMs / encoded << " ms";
+			if (compressed)
+			{
+				std::cout << "  encode " << encodeMs / encoded << " ms ("
+					<< width * height / (encodeMs / encoded * 1000.0) << " Mtexels/s)";
+			}
+			std::cout << "  upload " << uploadMs / frames << " ms  " << bytes << " bytes, "
+				<< std::setprecision(1) << 100.0 * bytes / (width * height * 3 * sizeof(float)) << "% of float, "
+				<< 100.0 * bytes / (width * height * 4) << "% of rgba8";
+			if (compressed)
+			{
+				std::vector<uint8_t> decoded(rgba);
+				BlockCompression::decode(texture.blocks, &blocks[0], width, height, &decoded[0], 1);
+				std::cout << "  psnr " << std::setprecision(2) << BlockCompression::psnr(&rgba[0], &decoded[0], width * height) << " dB";
+			}
+			std::cout << std::endl;
+			if (format != BC7)
+			{
+				fillMs = encodeMs = 0;
+			}
+			uploadMs = 0;
+			frames = 0;
+		}
+	}
+
+	glDeleteTextures(1, &id);
+	va.destroy();
+	draw.destroy();
+	scheduler.destroy();
+	window.destroy();
+	Window::terminate();
+	return result;
+}
@@ -0,0 +1,135 @@
+#include "common/SimdTrig.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+
+
+// Checks the SimdTrig kernels against double precision libm for every float
+// with |a| <= 8192, both signs, at every precision, and fails if an error
+// exceeds the bound documented in SimdTrig.h. Takes minutes per core.
+//
+//   --step N    only every Nth float, for a quick run
+
+struct Error
+{
+	double sin;
+	double cos;
+	double tan;
+	float sinAt;
+	float cosAt;
+	float tanAt;
+};
+
+static const float RANGE = 8192.0f;
+
+static void worse(double e, float a, double& error, float& at)
+{
+	if (e > error)
+	{
+		error = e;
+		at = a;
+	}
+}
+
+template <TrigPrecision PRECISION>
+static void check(uint32_t begin, uint32_t end, uint32_t step, Error& error)
+{
+	error = Error();
+	alignas(16) float a[4];
+	alignas(16) float s[4], c[4], t[4];
+	for (uint32_t bits = begin; bits < end; bits += 4 * step)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			uint32_t b = std::min(bits + i * step, end - 1);
+			memcpy(&a[i], &b, 4);
+		}
+		for (int negative = 0; negative < 2; negative++)
+		{
+			__m128 v = _mm_load_ps(a);
+			if (negative)
+			{
+				v = _mm_xor_ps(v, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+			}
+			__m128 vs, vc;
+			SimdTrig<PRECISION>::sincos(v, vs, vc);
+			_mm_store_ps(s, vs);
+			_mm_store_ps(c, vc);
+			_mm_store_ps(t, SimdTrig<PRECISION>::tan(v));
+			for (int i = 0; i < 4; i++)
+			{
+				double x = negative ? -double(a[i]) : double(a[i]);
+				worse(std::fabs(s[i] - std::sin(x)), float(x), error.sin, error.sinAt);
+				worse(std::fabs(c[i] - std::cos(x)), float(x), error.cos, error.cosAt);
+				double tx = std::tan(x);
+				worse(std::fabs((t[i] - tx) / tx), float(x), error.tan, error.tanAt);
+			}
+		}
+	}
+}
+
+template <TrigPrecision PRECISION>
+static Error run(unsigned threads, uint32_t step)
+{
+	uint32_t end;
+	memcpy(&end, &RANGE, 4);
+	end++;
+	std::vector<Error> errors(threads);
+	std::vector<std::thread> workers;
+	uint64_t chunk = (uint64_t(end) / threads + 4 * step - 1) / (4 * step) * (4 * step);
+	for (unsigned i = 0; i < threads; i++)
+	{
+		uint32_t b = uint32_t(std::min<uint64_t>(i * chunk, end));
+		uint32_t e = uint32_t(std::min<uint64_t>((i + 1) * chunk, end));
+		workers.push_back(std::thread(check<PRECISION>, b, e, step, std::ref(errors[i])));
+	}
+	Error total = Error();
+	for (unsigned i = 0; i < threads; i++)
+	{
+		workers[i].join();
+		worse(errors[i].sin, errors[i].sinAt, total.sin, total.sinAt);
+		worse(errors[i].cos, errors[i].cosAt, total.cos, total.cosAt);
+		worse(errors[i].tan, errors[i].tanAt, total.tan, total.tanAt);
+	}
+	return total;
+}
+
+static bool report(const char * name, const Error& e, double sinCos, double tan)
+{
+	bool ok = e.sin <= sinCos && e.cos <= sinCos && e.tan <= tan;
+	std::cout << std::left << std::setw(12) << name << std::right << std::scientific << std::setprecision(2)
+		<< "sin " << e.sin << " at " << std::setw(9) << e.sinAt
+		<< "  cos " << e.cos << " at " << std::setw(9) << e.cosAt
+		<< "  tan " << e.tan << " at " << std::setw(9) << e.tanAt
+		<< (ok ? "  ok" : "  FAIL") << std::endl;
+	return ok;
+}
+
+
+int main(int argc, char** argv)
+{
+	uint32_t step = 1;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) == "--step")
+		{
+			step = std::max(1, atoi(argv[i + 1]));
+		}
+	}
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+	// The bounds of the table in SimdTrig.h.
+	bool ok = true;
+	ok = report("TRIG_LOW", run<TRIG_LOW>(threads, step), 3.5e-5, 4.8e-5) && ok;
+	ok = report("TRIG_MEDIUM", run<TRIG_MEDIUM>(threads, step), 1.4e-6, 2.2e-6) && ok;
+	ok = report("TRIG_HIGH", run<TRIG_HIGH>(threads, step), 8.0e-8, 2.4e-7) && ok;
+	return ok ? 0 : 1;
+}
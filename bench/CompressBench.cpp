@@ -0,0 +1,86 @@
+#include "common/BlockCompression.h"
+#include "common/Random.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+
+// Encoding one frame of TextureCompression. range(0) picks the content:
+// 0 is StaticNoise2's white and green noise, the worst case for block
+// compression, 1 a smooth color pattern with a little grain, closer to a
+// photograph. Items are texels, the psnr counter the quality of the result
+// against the RGBA8 frame, over RGB or over green for BC4.
+static const int WIDTH = 640;
+static const int HEIGHT = 480;
+
+static std::vector<uint8_t> frame(bool smooth)
+{
+	std::vector<uint8_t> rgba(WIDTH * HEIGHT * 4);
+	for (int y = 0; y < HEIGHT; y++)
+	{
+		for (int x = 0; x < WIDTH; x++)
+		{
+			uint32_t i = uint32_t(y * WIDTH + x);
+			uint8_t * p = &rgba[i * 4];
+			if (smooth)
+			{
+				float grain = Random::uniform(i, 7) * 8.0f - 4.0f;
+				p[0] = uint8_t(std::min(std::max(128.0f + 120.0f * std::sin(x * 0.021f + y * 0.013f) + grain, 0.0f), 255.0f));
+				p[1] = uint8_t(std::min(std::max(128.0f + 120.0f * std::sin(y * 0.027f - x * 0.008f) + grain, 0.0f), 255.0f));
+				p[2] = uint8_t(std::min(std::max(128.0f + 120.0f * std::cos((x + y) * 0.011f) + grain, 0.0f), 255.0f));
+			}
+			else
+			{
+				p[0] = 255;
+				p[1] = uint8_t(Random::uniform(i, 0) * 255.0f + 0.5f);
+				p[2] = 255;
+			}
+			p[3] = 255;
+		}
+	}
+	return rgba;
+}
+
+template <BlockCompression::Format FORMAT>
+static void encode(benchmark::State& state)
+{
+	std::vector<uint8_t> rgba = frame(state.range(0) != 0);
+	std::vector<uint8_t> blocks(BlockCompression::size(FORMAT, WIDTH, HEIGHT));
+	for (auto _ : state)
+	{
+		BlockCompression::encode(FORMAT, &rgba[0], WIDTH, HEIGHT, &blocks[0], 1);
+		benchmark::DoNotOptimize(&blocks[0]);
+	}
+	std::vector<uint8_t> decoded(rgba);
+	BlockCompression::decode(FORMAT, &blocks[0], WIDTH, HEIGHT, &decoded[0], 1);
+	state.counters["psnr"] = FORMAT == BlockCompression::BC4 ? BlockCompression::psnr(&rgba[0], &decoded[0], WIDTH * HEIGHT, 1, 1)
+		: BlockCompression::psnr(&rgba[0], &decoded[0], WIDTH * HEIGHT);
+	state.SetItemsProcessed(state.iterations() * WIDTH * HEIGHT);
+}
+BENCHMARK_TEMPLATE(encode, BlockCompression::BC1)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(encode, BlockCompression::BC4)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(encode, BlockCompression::BC7)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// The smooth frame on range(0) threads.
+template <BlockCompression::Format FORMAT>
+static void encodeJobs(benchmark::State& state)
+{
+	std::vector<uint8_t> rgba = frame(true);
+	std::vector<uint8_t> blocks(BlockCompression::size(FORMAT, WIDTH, HEIGHT));
+	JobSystem jobs(state.range(0));
+	for (auto _ : state)
+	{
+		BlockCompression::encode(jobs, FORMAT, &rgba[0], WIDTH, HEIGHT, &blocks[0], 1);
+		benchmark::DoNotOptimize(&blocks[0]);
+	}
+	state.SetItemsProcessed(state.iterations() * WIDTH * HEIGHT);
+}
+BENCHMARK_TEMPLATE(encodeJobs, BlockCompression::BC1)->RangeMultiplier(2)->Range(1, std::max(1u, std::thread::hardware_concurrency()))->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(encodeJobs, BlockCompression::BC4)->RangeMultiplier(2)->Range(1, std::max(1u, std::thread::hardware_concurrency()))->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
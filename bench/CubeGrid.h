@@ -0,0 +1,91 @@
+#pragma once
+
+#include "common/Matrix4f.h"
+
+#include <vector>
+#include <cstdint>
+
+
+// n * n copies of Cube1's cube in one vertex and index list, turned towards
+// the camera and filling about the same part of a 4:3 view whatever n is, so
+// a small n is bound by fill rate and a large one by triangle setup. Shared
+// by the software and the GL raster benchmarks so they draw the same thing.
+struct CubeGrid
+{
+	std::vector<float> vertices;
+	std::vector<uint32_t> indices;
+	Matrix4f mvp;
+
+	CubeGrid(int n)
+	{
+		static const float cube[] =
+		{
+			1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+			-1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+			1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+			-1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+
+			1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+			1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+			1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+			1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+
+			1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+			1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+			-1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+			-1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+
+			1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+			1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+			-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+			-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+
+			-1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+			-1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+			-1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+			-1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+
+			1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+			-1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+			1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 1.0f,
+			-1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 1.0f,
+		};
+		static const uint32_t faces[] =
+		{
+			0, 1, 2, 2, 1, 3,
+			4, 5, 6, 6, 5, 7,
+			8, 9, 10, 10, 9, 11,
+			12, 13, 14, 14, 13, 15,
+			16, 17, 18, 18, 17, 19,
+			20, 21, 22, 22, 21, 23,
+		};
+		for (int j = 0; j < n; j++)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				uint32_t base = uint32_t(vertices.size() / 6);
+				for (int v = 0; v < 24; v++)
+				{
+					vertices.push_back(cube[v * 6] + 3.0f * (i - 0.5f * (n - 1)));
+					vertices.push_back(cube[v * 6 + 1] + 3.0f * (j - 0.5f * (n - 1)));
+					for (int k = 2; k < 6; k++)
+					{
+						vertices.push_back(cube[v * 6 + k]);
+					}
+				}
+				for (int f = 0; f < 36; f++)
+				{
+					indices.push_back(base + faces[f]);
+				}
+			}
+		}
+		mvp.perspective(1.0f, 1000.0f, 0.4f, 0.3f);
+		mvp.translate(0, 0, -5.5f * n);
+		mvp.rotateY(0.5f);
+		mvp.rotateZ(0.3f);
+	}
+	std::size_t triangles() const
+	{
+		return indices.size() / 3;
+	}
+};
@@ -0,0 +1,367 @@
+#include "common/Window.h"
+#include "common/Shader.h"
+#include "common/Buffer.h"
+#include "common/FrameRecorder.h"
+#include "common/BlockCompression.h"
+#include "common/SoftRaster.h"
+#include "CubeGrid.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <iostream>
+#include <string>
+#include <filesystem>
+#include <thread>
+#include <cstdlib>
+#include <algorithm>
+
+#define GLSL(src) "#version 430\n" #src
+
+
+// Every benchmark ends with glFinish, so the time includes the driver and
+// GPU work, not just queuing the commands.
+
+static void bufferData(benchmark::State& state)
+{
+	std::vector<char> data(state.range(0), 1);
+	ArrayBuffer buffer;
+	buffer.bind();
+	for (auto _ : state)
+	{
+		ArrayBuffer::data(data.size(), &data[0], GL_STREAM_DRAW);
+		glFinish();
+	}
+	buffer.destroy();
+	state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(bufferData)->RangeMultiplier(8)->Range(4 << 10, 4 << 20)->UseRealTime();
+
+static void bufferSubData(benchmark::State& state)
+{
+	std::vector<char> data(state.range(0), 1);
+	ArrayBuffer buffer;
+	buffer.bind();
+	ArrayBuffer::data(data.size(), NULL, GL_DYNAMIC_DRAW);
+	for (auto _ : state)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, data.size(), &data[0]);
+		glFinish();
+	}
+	buffer.destroy();
+	state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(bufferSubData)->RangeMultiplier(8)->Range(4 << 10, 4 << 20)->UseRealTime();
+
+// glDrawPixels of one StaticNoise frame.
+static void drawPixels(benchmark::State& state)
+{
+	std::vector<float> pixels(640 * 480 * 3, 0.5f);
+	for (auto _ : state)
+	{
+		glDrawPixels(640, 480, GL_RGB, GL_FLOAT, &pixels[0]);
+		glFinish();
+	}
+	state.SetBytesProcessed(state.iterations() * pixels.size() * sizeof(float));
+}
+BENCHMARK(drawPixels)->UseRealTime();
+
+// The IndexBuffer quad, submitted range(0) times per frame.
+static void drawElements(benchmark::State& state)
+{
+	std::string vertexSource = GLSL
+	(
+		layout(location = 0) in vec4 vposition;
+		layout(location = 1) in vec4 vcolor;
+		out vec4 fcolor;
+		void main()
+		{
+			fcolor = vcolor;
+			gl_Position = vposition;
+		}
+	);
+	std::string fragmentSource = GLSL
+	(
+		in vec4 fcolor;
+		layout(location = 0) out vec4 FragColor;
+		void main()
+		{
+			FragColor = fcolor;
+		}
+	);
+	VertexShader vertexShader;
+	FragmentShader fragmentShader;
+	vertexShader.source(vertexSource);
+	fragmentShader.source(fragmentSource);
+	vertexShader.compile();
+	fragmentShader.compile();
+	ShaderProgram program;
+	program.attach(vertexShader);
+	program.attach(fragmentShader);
+	program.link();
+
+	VertexArray va;
+	va.bind();
+	ArrayBuffer vb;
+	vb.bind();
+	GLfloat vertexData[] =
+	{
+		1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+		-1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+		1.0f,-1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+		-1.0f,-1.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+	};
+	ArrayBuffer::staticData(sizeof(vertexData), vertexData);
+	VertexAttribute<0>::enable();
+	VertexAttribute<0>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0);
+	VertexAttribute<1>::enable();
+	VertexAttribute<1>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0 + 3 * sizeof(GLfloat));
+	ElementArrayBuffer ib;
+	ib.bind();
+	GLuint indexData[] = {
+		0, 1, 2,
+		2, 1, 3,
+	};
+	ElementArrayBuffer::staticData(sizeof(indexData), indexData);
+
+	program.use();
+	for (auto _ : state)
+	{
+		for (int64_t i = 0; i < state.range(0); i++)
+		{
+			VertexArray::drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		}
+		glFinish();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	va.destroy();
+	vb.destroy();
+	ib.destroy();
+	program.detach(vertexShader);
+	program.detach(fragmentShader);
+	vertexShader.destroy();
+	fragmentShader.destroy();
+	program.destroy();
+}
+BENCHMARK(drawElements)->RangeMultiplier(10)->Range(1, 10000)->UseRealTime();
+
+// RasterBench's CubeGrid through the driver at 640x480, counting the
+// fragments that pass the depth test with a query before timing. The frame
+// is also drawn with SoftRaster and compared: differ counts the pixels
+// where a channel is off by more than one, so the two benchmarks are known
+// to do the same work. With LIBGL_ALWAYS_SOFTWARE=1 this is llvmpipe.
+static void rasterCubes(benchmark::State& state)
+{
+	std::string vertexSource = GLSL
+	(
+		layout(location = 0) in vec4 vposition;
+		layout(location = 1) in vec4 vcolor;
+		layout(location = 0) uniform mat4 mvp;
+		out vec4 fcolor;
+		void main()
+		{
+			fcolor = vcolor;
+			gl_Position = mvp * vposition;
+		}
+	);
+	std::string fragmentSource = GLSL
+	(
+		in vec4 fcolor;
+		layout(location = 0) out vec4 FragColor;
+		void main()
+		{
+			FragColor = fcolor;
+		}
+	);
+	VertexShader vertexShader;
+	FragmentShader fragmentShader;
+	vertexShader.source(vertexSource);
+	fragmentShader.source(fragmentSource);
+	vertexShader.compile();
+	fragmentShader.compile();
+	ShaderProgram program;
+	program.attach(vertexShader);
+	program.attach(fragmentShader);
+	program.link();
+
+	CubeGrid grid(state.range(0));
+	VertexArray va;
+	va.bind();
+	ArrayBuffer vb;
+	vb.bind();
+	ArrayBuffer::staticData(grid.vertices.size() * sizeof(GLfloat), grid.vertices.data());
+	VertexAttribute<0>::enable();
+	VertexAttribute<0>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0);
+	VertexAttribute<1>::enable();
+	VertexAttribute<1>::set(3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (char*)0 + 3 * sizeof(GLfloat));
+	ElementArrayBuffer ib;
+	ib.bind();
+	ElementArrayBuffer::staticData(grid.indices.size() * sizeof(GLuint), grid.indices.data());
+
+	program.use();
+	glUniformMatrix4fv(0, 1, GL_FALSE, grid.mvp._data);
+	glEnable(GL_DEPTH_TEST);
+	GLuint query;
+	glGenQueries(1, &query);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glBeginQuery(GL_SAMPLES_PASSED, query);
+	VertexArray::drawElements(GL_TRIANGLES, grid.indices.size(), GL_UNSIGNED_INT, 0);
+	glEndQuery(GL_SAMPLES_PASSED);
+	GLuint fragments;
+	glGetQueryObjectuiv(query, GL_QUERY_RESULT, &fragments);
+	glDeleteQueries(1, &query);
+
+	std::vector<uint8_t> rgba(640 * 480 * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, 640, 480, GL_RGBA, GL_UNSIGNED_BYTE, &rgba[0]);
+	JobSystem jobs(std::max(1u, std::thread::hardware_concurrency()));
+	SoftRaster raster(jobs, 640, 480);
+	raster.clear();
+	raster.draw(SoftRaster::TRIANGLES, grid.vertices.data(), grid.vertices.size() / 6, 6,
+		grid.indices.data(), grid.indices.size(), grid.mvp);
+	const uint8_t * soft = reinterpret_cast<const uint8_t *>(raster.pixels());
+	std::size_t differ = 0;
+	for (std::size_t i = 0; i < rgba.size(); i += 4)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			if (std::abs(int(rgba[i + c]) - int(soft[i + c])) > 1)
+			{
+				differ++;
+				break;
+			}
+		}
+	}
+
+	for (auto _ : state)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		VertexArray::drawElements(GL_TRIANGLES, grid.indices.size(), GL_UNSIGNED_INT, 0);
+		glFinish();
+	}
+	state.SetItemsProcessed(state.iterations() * grid.triangles());
+	state.counters["pixels"] = benchmark::Counter(double(fragments) * state.iterations(), benchmark::Counter::kIsRate);
+	state.counters["differ"] = differ;
+	glDisable(GL_DEPTH_TEST);
+
+	va.destroy();
+	vb.destroy();
+	ib.destroy();
+	program.detach(vertexShader);
+	program.detach(fragmentShader);
+	vertexShader.destroy();
+	fragmentShader.destroy();
+	program.destroy();
+}
+BENCHMARK(rasterCubes)->Arg(2)->Arg(8)->Arg(32)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// Replacing one 640x480 texture as TextureCompression does every frame:
+// range(0) is 0 for StaticNoise2's RGB floats, 1 for RGBA8, 2 to 4 for BC1,
+// BC4 and BC7 blocks.
+static void uploadTexture(benchmark::State& state)
+{
+	static const GLenum COMPRESSED[3] = {GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RED_RGTC1, GL_COMPRESSED_RGBA_BPTC_UNORM};
+	int format = int(state.range(0));
+	std::vector<uint8_t> rgba(640 * 480 * 4, 128);
+	std::vector<float> rgb(format == 0 ? 640 * 480 * 3 : 0, 0.5f);
+	std::vector<uint8_t> blocks;
+	if (format >= 2)
+	{
+		BlockCompression::Format f = BlockCompression::Format(format - 2);
+		blocks.resize(BlockCompression::size(f, 640, 480));
+		BlockCompression::encode(f, &rgba[0], 640, 480, &blocks[0]);
+	}
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (format == 0)
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, 640, 480, 0, GL_RGB, GL_FLOAT, &rgb[0]);
+	}
+	else if (format == 1)
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 640, 480, 0, GL_RGBA, GL_UNSIGNED_BYTE, &rgba[0]);
+	}
+	else
+	{
+		glCompressedTexImage2D(GL_TEXTURE_2D, 0, COMPRESSED[format - 2], 640, 480, 0, GLsizei(blocks.size()), &blocks[0]);
+	}
+	for (auto _ : state)
+	{
+		if (format == 0)
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 640, 480, GL_RGB, GL_FLOAT, &rgb[0]);
+		}
+		else if (format == 1)
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 640, 480, GL_RGBA, GL_UNSIGNED_BYTE, &rgba[0]);
+		}
+		else
+		{
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 640, 480, COMPRESSED[format - 2], GLsizei(blocks.size()), &blocks[0]);
+		}
+		glFinish();
+	}
+	if (glGetError() != GL_NO_ERROR)
+	{
+		state.SkipWithError("format not supported");
+	}
+	glDeleteTextures(1, &texture);
+	std::size_t bytes = format == 0 ? rgb.size() * sizeof(float) : format == 1 ? rgba.size() : blocks.size();
+	state.SetBytesProcessed(state.iterations() * bytes);
+	state.counters["bytes"] = double(bytes);
+}
+BENCHMARK(uploadTexture)->DenseRange(0, 4)->UseRealTime();
+
+// Getting a frame out with a plain glReadPixels, which stalls until the GPU
+// has finished it, against the asynchronous FrameRecorder writing a Y4M.
+static void readPixelsSync(benchmark::State& state)
+{
+	std::vector<unsigned char> rgba(640 * 480 * 4);
+	for (auto _ : state)
+	{
+		glClear(GL_COLOR_BUFFER_BIT);
+		glReadPixels(0, 0, 640, 480, GL_RGBA, GL_UNSIGNED_BYTE, &rgba[0]);
+		glFinish();
+	}
+	state.SetBytesProcessed(state.iterations() * rgba.size());
+}
+BENCHMARK(readPixelsSync)->UseRealTime();
+
+static void readPixelsRecorder(benchmark::State& state)
+{
+	std::string path = (std::filesystem::temp_directory_path() / "GLBench.y4m").string();
+	const char * argv[] = {"GLBench", "--record", path.c_str()};
+	FrameRecorder recorder(3, const_cast<char **>(argv), "GLBench", 640, 480);
+	for (auto _ : state)
+	{
+		glClear(GL_COLOR_BUFFER_BIT);
+		recorder.frame();
+		glFinish();
+	}
+	state.PauseTiming();
+	recorder.finish();
+	std::filesystem::remove(path);
+	state.ResumeTiming();
+	state.SetBytesProcessed(state.iterations() * 640 * 480 * 4);
+}
+BENCHMARK(readPixelsRecorder)->UseRealTime();
+
+
+int main(int argc, char** argv)
+{
+	benchmark::Initialize(&argc, argv);
+	Window::init();
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	Window window(640, 480, "GLBench");
+	window.current();
+	glfwSwapInterval(0);
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	window.destroy();
+	Window::terminate();
+	return 0;
+}
@@ -0,0 +1,34 @@
+#include "common/LightClusters.h"
+#include "common/Random.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+
+// CPU light assignment of ClusteredLighting for state.range(0) lights
+// scattered through its frustum.
+static void assignLights(benchmark::State& state)
+{
+	LightClusters clusters(0.5f, 100.0f, 0.4f, 0.3f);
+	Random random(7);
+	std::vector<PointLight> lights(state.range(0));
+	for (std::size_t i = 0; i < lights.size(); i++)
+	{
+		float depth = 0.5f + 99.5f * random.uniform();
+		lights[i].x = (random.uniform() * 2 - 1) * 0.8f * depth;
+		lights[i].y = (random.uniform() * 2 - 1) * 0.6f * depth;
+		lights[i].z = -depth;
+		lights[i].radius = 2.0f + 3.0f * random.uniform();
+	}
+	for (auto _ : state)
+	{
+		clusters.assign(lights.data(), lights.size());
+		benchmark::DoNotOptimize(clusters.indices().data());
+	}
+	state.SetItemsProcessed(state.iterations() * lights.size());
+	state.counters["references"] = clusters.references();
+}
+BENCHMARK(assignLights)->Arg(1024)->Arg(4096)->Arg(16384)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
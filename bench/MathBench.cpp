@@ -0,0 +1,237 @@
+#include "common/Matrix4f.h"
+#include "common/Quaternion.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <cmath>
+
+
+static void frustum(benchmark::State& state)
+{
+	Matrix4f m;
+	for (auto _ : state)
+	{
+		m.frustum(1.0f, 200.0f, 1.0f, 1.2f);
+		benchmark::DoNotOptimize(m._data);
+	}
+}
+BENCHMARK(frustum);
+
+// The per-frame transform chain of Cube1 before the projection was baked.
+static void cubeTransformRuntime(benchmark::State& state)
+{
+	Matrix4f mvp;
+	float a = 0;
+	for (auto _ : state)
+	{
+		a += 0.005f;
+		mvp.frustum(1.0f, 200.0f, 1.0f, 1.2f);
+		mvp.translate(0, 0, -3 + tan(a));
+		mvp.rotateY(a);
+		mvp.rotateZ(tan(a));
+		benchmark::DoNotOptimize(mvp._data);
+	}
+}
+BENCHMARK(cubeTransformRuntime);
+
+static constexpr Matrix4f projection = []
+{
+	Matrix4f m;
+	m.frustum(1.0f, 200.0f, 1.0f, 1.2f);
+	return m;
+}();
+
+// Cube1 as it is now: only the animated part runs per frame.
+static void cubeTransform(benchmark::State& state)
+{
+	Matrix4f mvp;
+	float a = 0;
+	for (auto _ : state)
+	{
+		a += 0.005f;
+		mvp = projection;
+		mvp.translate(0, 0, -3 + tan(a));
+		mvp.rotateY(a);
+		mvp.rotateZ(tan(a));
+		benchmark::DoNotOptimize(mvp._data);
+	}
+}
+BENCHMARK(cubeTransform);
+
+static void multiply(benchmark::State& state)
+{
+	Matrix4f a, b;
+	a.identity();
+	b.identity();
+	b.rotateY(0.3f);
+	for (auto _ : state)
+	{
+		a.multiply(b);
+		benchmark::DoNotOptimize(a._data);
+	}
+}
+BENCHMARK(multiply);
+
+static void multiplySSE(benchmark::State& state)
+{
+	Matrix4f a, b, r;
+	a.identity();
+	b.identity();
+	b.rotateY(0.3f);
+	for (auto _ : state)
+	{
+		Matrix4f::multiply(a, b, r);
+		benchmark::DoNotOptimize(r._data);
+		benchmark::ClobberMemory();
+	}
+}
+BENCHMARK(multiplySSE);
+
+static void quaternionApply(benchmark::State& state)
+{
+	Quaternion q1(2, 3, 4, 5);
+	Quaternion q2 = Quaternion::axisAngle(0, 1, 0, 0.01f);
+	for (auto _ : state)
+	{
+		q1.apply(q2);
+		benchmark::DoNotOptimize(q1[0]);
+	}
+}
+BENCHMARK(quaternionApply);
+
+static void quaternionAxisAngle(benchmark::State& state)
+{
+	float a = 0;
+	for (auto _ : state)
+	{
+		a += 0.005f;
+		Quaternion q = Quaternion::axisAngle(0, 1, 0, a);
+		benchmark::DoNotOptimize(q[0]);
+	}
+}
+BENCHMARK(quaternionAxisAngle);
+
+static void sinLibm(benchmark::State& state)
+{
+	float a = 0;
+	for (auto _ : state)
+	{
+		a += 0.005f;
+		benchmark::DoNotOptimize(std::sin(a));
+	}
+}
+BENCHMARK(sinLibm);
+
+static void sinTrig(benchmark::State& state)
+{
+	float a = 0;
+	for (auto _ : state)
+	{
+		a += 0.005f;
+		benchmark::DoNotOptimize(Trig::sin(a));
+	}
+}
+BENCHMARK(sinTrig);
+
+static std::vector<float> angles(std::size_t count)
+{
+	std::vector<float> a(count);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		a[i] = -100.0f + 200.0f * i / count;
+	}
+	return a;
+}
+
+// sin and cos of a batch of instance angles.
+static void sincosLibm(benchmark::State& state)
+{
+	std::vector<float> a = angles(state.range(0)), s(a.size()), c(a.size());
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < a.size(); i++)
+		{
+			s[i] = std::sin(a[i]);
+			c[i] = std::cos(a[i]);
+		}
+		benchmark::DoNotOptimize(&s[0]);
+		benchmark::DoNotOptimize(&c[0]);
+	}
+	state.SetItemsProcessed(state.iterations() * a.size());
+}
+BENCHMARK(sincosLibm)->Arg(4096);
+
+template <TrigPrecision PRECISION>
+static void sincosSimd(benchmark::State& state)
+{
+	std::vector<float> a = angles(state.range(0)), s(a.size()), c(a.size());
+	for (auto _ : state)
+	{
+		SimdTrig<PRECISION>::sincos(&a[0], &s[0], &c[0], a.size());
+		benchmark::DoNotOptimize(&s[0]);
+		benchmark::DoNotOptimize(&c[0]);
+	}
+	state.SetItemsProcessed(state.iterations() * a.size());
+}
+BENCHMARK_TEMPLATE(sincosSimd, TRIG_LOW)->Arg(4096);
+BENCHMARK_TEMPLATE(sincosSimd, TRIG_MEDIUM)->Arg(4096);
+BENCHMARK_TEMPLATE(sincosSimd, TRIG_HIGH)->Arg(4096);
+
+static void tanLibm(benchmark::State& state)
+{
+	std::vector<float> a = angles(state.range(0)), t(a.size());
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < a.size(); i++)
+		{
+			t[i] = std::tan(a[i]);
+		}
+		benchmark::DoNotOptimize(&t[0]);
+	}
+	state.SetItemsProcessed(state.iterations() * a.size());
+}
+BENCHMARK(tanLibm)->Arg(4096);
+
+static void tanSimd(benchmark::State& state)
+{
+	std::vector<float> a = angles(state.range(0)), t(a.size());
+	for (auto _ : state)
+	{
+		SimdTrig<TRIG_HIGH>::tan(&a[0], &t[0], a.size());
+		benchmark::DoNotOptimize(&t[0]);
+	}
+	state.SetItemsProcessed(state.iterations() * a.size());
+}
+BENCHMARK(tanSimd)->Arg(4096);
+
+static void axisAngleScalar(benchmark::State& state)
+{
+	std::vector<float> a = angles(state.range(0));
+	std::vector<Quaternion> q(a.size(), Quaternion(1, 0, 0, 0));
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < a.size(); i++)
+		{
+			q[i] = Quaternion::axisAngle(0, 1, 0, a[i]);
+		}
+		benchmark::DoNotOptimize(&q[0]);
+	}
+	state.SetItemsProcessed(state.iterations() * a.size());
+}
+BENCHMARK(axisAngleScalar)->Arg(4096);
+
+static void axisAngleSimd(benchmark::State& state)
+{
+	std::vector<float> a = angles(state.range(0));
+	std::vector<Quaternion> q(a.size(), Quaternion(1, 0, 0, 0));
+	for (auto _ : state)
+	{
+		Quaternion::axisAngle<TRIG_HIGH>(0, 1, 0, &a[0], &q[0], a.size());
+		benchmark::DoNotOptimize(&q[0]);
+	}
+	state.SetItemsProcessed(state.iterations() * a.size());
+}
+BENCHMARK(axisAngleSimd)->Arg(4096);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+#include "common/JobSystem.h"
+#include "common/Random.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <thread>
+#include <cstdlib>
+#include <cstdint>
+
+
+struct Pixel
+{
+	float r;
+	float g;
+	float b;
+};
+
+const int width = 640;
+const int height = 480;
+
+static void report(benchmark::State& state)
+{
+	state.SetItemsProcessed(state.iterations() * width * height);
+	state.SetBytesProcessed(state.iterations() * width * height * sizeof(Pixel));
+}
+
+// StaticNoise2 as it was originally written.
+static void fillDrand48(benchmark::State& state)
+{
+	std::vector<Pixel> pixels(width * height);
+	for (auto _ : state)
+	{
+		for (int i = 0; i < width * height; i++)
+		{
+			pixels[i].r = 1.0;
+			pixels[i].g = drand48();
+			pixels[i].b = 1.0;
+		}
+		benchmark::DoNotOptimize(&pixels[0]);
+	}
+	report(state);
+}
+BENCHMARK(fillDrand48);
+
+// StaticNoise2 with the seeded generator used for frame capture.
+static void fillRandom(benchmark::State& state)
+{
+	std::vector<Pixel> pixels(width * height);
+	Random random(1);
+	for (auto _ : state)
+	{
+		for (int i = 0; i < width * height; i++)
+		{
+			pixels[i].r = 1.0;
+			pixels[i].g = random.uniform();
+			pixels[i].b = 1.0;
+		}
+		benchmark::DoNotOptimize(&pixels[0]);
+	}
+	report(state);
+}
+BENCHMARK(fillRandom);
+
+struct NoiseFill
+{
+	Pixel * pixels;
+	uint32_t frame;
+};
+
+// Counter based, so every chunk can be filled independently.
+static void fill(std::size_t begin, std::size_t end, void * context)
+{
+	NoiseFill * n = static_cast<NoiseFill *>(context);
+	for (std::size_t i = begin; i < end; i++)
+	{
+		n->pixels[i].r = 1.0;
+		n->pixels[i].g = Random::uniform(i, n->frame);
+		n->pixels[i].b = 1.0;
+	}
+}
+
+static void fillJobs(benchmark::State& state)
+{
+	std::vector<Pixel> pixels(width * height);
+	JobSystem jobs(state.range(0));
+	uint32_t frame = 0;
+	for (auto _ : state)
+	{
+		NoiseFill n = {&pixels[0], frame++};
+		jobs.parallel_for(width * height, fill, &n);
+		benchmark::DoNotOptimize(&pixels[0]);
+	}
+	report(state);
+}
+BENCHMARK(fillJobs)->RangeMultiplier(2)->Range(1, std::max(1u, std::thread::hardware_concurrency()))->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,64 @@
+#include "common/SoftRaster.h"
+#include "CubeGrid.h"
+
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <algorithm>
+
+
+// SoftRaster drawing a CubeGrid of range(0) * range(0) cubes at 640x480 on
+// range(1) threads. Items are triangles, pixels the fragments that passed
+// the depth test; GLBench's rasterCubes draws the same grid through the
+// driver, run it with LIBGL_ALWAYS_SOFTWARE=1 to compare against llvmpipe.
+// llvmpipe.md has the commands and one set of results.
+static void rasterCubes(benchmark::State& state)
+{
+	CubeGrid grid(state.range(0));
+	JobSystem jobs(state.range(1));
+	SoftRaster raster(jobs, 640, 480);
+	uint64_t fragments = 0;
+	for (auto _ : state)
+	{
+		raster.clear();
+		raster.draw(SoftRaster::TRIANGLES, grid.vertices.data(), grid.vertices.size() / 6, 6,
+			grid.indices.data(), grid.indices.size(), grid.mvp);
+		fragments += raster.fragments();
+		benchmark::DoNotOptimize(raster.pixels());
+	}
+	state.SetItemsProcessed(state.iterations() * grid.triangles());
+	state.counters["pixels"] = benchmark::Counter(fragments, benchmark::Counter::kIsRate);
+}
+BENCHMARK(rasterCubes)->Apply([](benchmark::internal::Benchmark * b)
+{
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	for (int n : {2, 8, 32})
+	{
+		for (unsigned threads = 1; threads <= cores; threads *= 2)
+		{
+			b->Args({n, int64_t(threads)});
+		}
+	}
+})->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// The same grid as Cube1 draws it, wireframe from its triangle index list.
+static void rasterLines(benchmark::State& state)
+{
+	CubeGrid grid(state.range(0));
+	JobSystem jobs(std::max(1u, std::thread::hardware_concurrency()));
+	SoftRaster raster(jobs, 640, 480);
+	uint64_t fragments = 0;
+	for (auto _ : state)
+	{
+		raster.clear();
+		raster.draw(SoftRaster::LINES, grid.vertices.data(), grid.vertices.size() / 6, 6,
+			grid.indices.data(), grid.indices.size(), grid.mvp);
+		fragments += raster.fragments();
+		benchmark::DoNotOptimize(raster.pixels());
+	}
+	state.SetItemsProcessed(state.iterations() * (grid.indices.size() / 2));
+	state.counters["pixels"] = benchmark::Counter(fragments, benchmark::Counter::kIsRate);
+}
+BENCHMARK(rasterLines)->Arg(2)->Arg(8)->Arg(32)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,119 @@
+#include "common/Skinning.h"
+#include "common/Random.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+
+// 64k vertices over a palette of 4096 bones, every vertex with four
+// influences spread over nearby bones, as a crowd of skinned meshes would
+// have them. Items are vertices skinned.
+static const std::size_t VERTICES = 1 << 16;
+static const std::size_t BONES = 4096;
+
+struct SkinScene
+{
+	std::vector<DualQuaternion> bones;
+	std::vector<float> rest;
+	std::vector<uint32_t> index;
+	std::vector<float> weight;
+
+	SkinScene() : bones(BONES, DualQuaternion::identity()), rest(VERTICES * 6), index(VERTICES * 4), weight(VERTICES * 4)
+	{
+		Random random(11);
+		for (std::size_t b = 0; b < BONES; b++)
+		{
+			Quaternion q = Quaternion::axisAngle(0, 0, 1, random.uniform() * 2 - 1);
+			q.apply(Quaternion::axisAngle(0, 1, 0, random.uniform() * 2 - 1));
+			bones[b] = DualQuaternion::rigid(q, random.uniform(), random.uniform(), random.uniform());
+		}
+		for (std::size_t v = 0; v < VERTICES; v++)
+		{
+			for (int c = 0; c < 6; c++)
+			{
+				rest[v * 6 + c] = random.uniform() * 2 - 1;
+			}
+			uint32_t first = uint32_t(v * BONES / VERTICES);
+			float sum = 0;
+			for (int k = 0; k < 4; k++)
+			{
+				index[v * 4 + k] = std::min<uint32_t>(first + k, BONES - 1);
+				weight[v * 4 + k] = random.uniform();
+				sum += weight[v * 4 + k];
+			}
+			for (int k = 0; k < 4; k++)
+			{
+				weight[v * 4 + k] /= sum;
+			}
+		}
+	}
+	void load(Skinning& skinning) const
+	{
+		for (std::size_t b = 0; b < BONES; b++)
+		{
+			skinning.bone(b, bones[b]);
+		}
+		for (std::size_t v = 0; v < VERTICES; v++)
+		{
+			skinning.vertex(v, &rest[v * 6], &rest[v * 6 + 3], &index[v * 4], &weight[v * 4]);
+		}
+	}
+};
+
+// One vertex at a time with DualQuaternion, array of structures.
+static void skinScalar(benchmark::State& state)
+{
+	SkinScene scene;
+	std::vector<float> out(VERTICES * 6);
+	for (auto _ : state)
+	{
+		for (std::size_t v = 0; v < VERTICES; v++)
+		{
+			DualQuaternion q(Quaternion(0, 0, 0, 0), Quaternion(0, 0, 0, 0));
+			for (int k = 0; k < 4; k++)
+			{
+				q.accumulate(scene.bones[scene.index[v * 4 + k]], scene.weight[v * 4 + k]);
+			}
+			q.normalize();
+			q.transform(&scene.rest[v * 6], &out[v * 6]);
+			q.transform(&scene.rest[v * 6 + 3], &out[v * 6 + 3], false);
+		}
+		benchmark::DoNotOptimize(&out[0]);
+	}
+	state.SetItemsProcessed(state.iterations() * VERTICES);
+}
+BENCHMARK(skinScalar)->Unit(benchmark::kMicrosecond);
+
+static void skinSoA(benchmark::State& state)
+{
+	SkinScene scene;
+	Skinning skinning(VERTICES, BONES);
+	scene.load(skinning);
+	for (auto _ : state)
+	{
+		skinning.skin();
+		benchmark::DoNotOptimize(skinning.output());
+	}
+	state.SetItemsProcessed(state.iterations() * VERTICES);
+}
+BENCHMARK(skinSoA)->Unit(benchmark::kMicrosecond);
+
+static void skinJobs(benchmark::State& state)
+{
+	SkinScene scene;
+	Skinning skinning(VERTICES, BONES);
+	scene.load(skinning);
+	JobSystem jobs(state.range(0));
+	for (auto _ : state)
+	{
+		skinning.skin(jobs);
+		benchmark::DoNotOptimize(skinning.output());
+	}
+	state.SetItemsProcessed(state.iterations() * VERTICES);
+}
+BENCHMARK(skinJobs)->RangeMultiplier(2)->Range(1, std::max(1u, std::thread::hardware_concurrency()))->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK_MAIN();
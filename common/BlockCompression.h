@@ -0,0 +1,962 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+
+// Block compressed textures, 4x4 texels per block, encoded from RGBA8 images
+// in the row order glTexImage2D takes them.
+//
+//   BC1  8 bytes, RGB 5:6:5 endpoints and 2 bit indices, alpha dropped
+//   BC4  8 bytes, one channel, 8 bit endpoints and 3 bit indices
+//   BC7  16 bytes, RGBA, here modes 6 and 1
+//
+// BC1 and BC4 are meant for data produced every frame: a block takes a few
+// hundred SSE2 instructions, the BC1 endpoints are the extent of the texels
+// along their principal axis refined by one least squares pass, the BC4 ones
+// the minimum and maximum. BC7 is for offline conversion: every block is fit
+// with mode 6, opaque ones also with mode 1 on the partitions that estimate
+// best, each fit refined several times.
+//
+// Images whose size is not a multiple of four repeat their last row and
+// column into the edge blocks. encode(jobs, ...) splits the block rows over
+// the JobSystem.
+class BlockCompression
+{
+public:
+	enum Format
+	{
+		BC1,
+		BC4,
+		BC7
+	};
+private:
+	// Subset of every texel in the 64 two subset partitions of BC7, one bit
+	// per texel, and the texel whose index drops its top bit in subset 1.
+	static constexpr uint16_t PARTITIONS[64] =
+	{
+		0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+		0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+		0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+		0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+		0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+		0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+		0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+		0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22
+	};
+	static constexpr uint8_t ANCHORS[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+		15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+		6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+	};
+	// Interpolation weights out of 64 of 3 and 4 bit BC7 indices.
+	static constexpr int WEIGHTS3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+	static constexpr int WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+	// BC4 index of ramp position 0 (minimum) to 7 (maximum).
+	static constexpr uint8_t BC4_CODES[8] = {1, 7, 6, 5, 4, 3, 2, 0};
+	// Mode 1 fits this many of the partitions that estimate best.
+	static const int CANDIDATES = 4;
+
+	// 128 bit little endian stream of a BC7 block.
+	struct Bits
+	{
+		uint64_t word[2];
+		int position;
+
+		Bits() : word(), position(0)
+		{}
+		explicit Bits(const uint8_t * block) : position(0)
+		{
+			memcpy(word, block, 16);
+		}
+		void write(uint32_t value, int count)
+		{
+			for (int i = 0; i < count; i++, position++)
+			{
+				word[position >> 6] |= uint64_t((value >> i) & 1) << (position & 63);
+			}
+		}
+		uint32_t read(int count)
+		{
+			uint32_t value = 0;
+			for (int i = 0; i < count; i++, position++)
+			{
+				value |= uint32_t((word[position >> 6] >> (position & 63)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	// One subset of a BC7 block: quantized endpoints, their p bits, and the
+	// index of every member texel.
+	struct Subset
+	{
+		int q[2][4];
+		int p[2];
+		uint8_t index[16];
+		float error;
+	};
+
+	static float sum(__m128 v)
+	{
+		v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+		return _mm_cvtss_f32(v);
+	}
+	static float clamp(float v)
+	{
+		return std::min(std::max(v, 0.0f), 255.0f);
+	}
+	// Texels of a block, channel c of row y in c[c][y], lane x.
+	static void load(const uint8_t * texels, __m128 c[4][4])
+	{
+		__m128i zero = _mm_setzero_si128();
+		for (int y = 0; y < 4; y++)
+		{
+			__m128i row = _mm_loadu_si128((const __m128i *)(texels + y * 16));
+			__m128i lo = _mm_unpacklo_epi8(row, zero);
+			__m128i hi = _mm_unpackhi_epi8(row, zero);
+			__m128 p0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+			__m128 p1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+			__m128 p2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+			__m128 p3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+			_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+			c[0][y] = p0;
+			c[1][y] = p1;
+			c[2][y] = p2;
+			c[3][y] = p3;
+		}
+	}
+	// Principal axis of a covariance matrix by power iteration, and its
+	// eigenvalue. The axis is zero for a flat set.
+	static float axis(const float (*covariance)[4], int channels, float * v)
+	{
+		int start = 0;
+		for (int i = 1; i < channels; i++)
+		{
+			if (covariance[i][i] > covariance[start][start])
+			{
+				start = i;
+			}
+		}
+		for (int i = 0; i < channels; i++)
+		{
+			v[i] = covariance[start][i];
+		}
+		float length = 0;
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float w[4];
+			length = 0;
+			for (int i = 0; i < channels; i++)
+			{
+				w[i] = 0;
+				for (int j = 0; j < channels; j++)
+				{
+					w[i] += covariance[i][j] * v[j];
+				}
+				length += w[i] * w[i];
+			}
+			length = std::sqrt(length);
+			if (length < 1e-6f)
+			{
+				for (int i = 0; i < channels; i++)
+				{
+					v[i] = 0;
+				}
+				return 0;
+			}
+			for (int i = 0; i < channels; i++)
+			{
+				v[i] = w[i] / length;
+			}
+		}
+		return length;
+	}
+	// Least squares endpoints of texels interpolated with weight[i] from e0
+	// to e1. False when the weights cannot separate two endpoints.
+	static bool fit(const float (*texels)[4], const float * weight, int count, int channels, float * e0, float * e1)
+	{
+		float a = 0, b = 0, c = 0;
+		float x0[4] = {}, x1[4] = {};
+		for (int i = 0; i < count; i++)
+		{
+			float w = weight[i];
+			a += (1 - w) * (1 - w);
+			b += (1 - w) * w;
+			c += w * w;
+			for (int k = 0; k < channels; k++)
+			{
+				x0[k] += (1 - w) * texels[i][k];
+				x1[k] += w * texels[i][k];
+			}
+		}
+		float determinant = a * c - b * b;
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+		for (int k = 0; k < channels; k++)
+		{
+			e0[k] = clamp((c * x0[k] - b * x1[k]) / determinant);
+			e1[k] = clamp((a * x1[k] - b * x0[k]) / determinant);
+		}
+		return true;
+	}
+
+	static uint16_t pack565(const float * c)
+	{
+		int r = int(clamp(c[0]) * (31.0f / 255.0f) + 0.5f);
+		int g = int(clamp(c[1]) * (63.0f / 255.0f) + 0.5f);
+		int b = int(clamp(c[2]) * (31.0f / 255.0f) + 0.5f);
+		return uint16_t(r << 11 | g << 5 | b);
+	}
+	static void unpack565(uint16_t c, int * rgb)
+	{
+		int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+		rgb[0] = r << 3 | r >> 2;
+		rgb[1] = g << 2 | g >> 4;
+		rgb[2] = b << 3 | b >> 2;
+	}
+	// The BC1 colors of endpoints c0 and c1 in four color mode.
+	static void paletteBC1(uint16_t c0, uint16_t c1, int (*palette)[3])
+	{
+		unpack565(c0, palette[0]);
+		unpack565(c1, palette[1]);
+		for (int k = 0; k < 3; k++)
+		{
+			palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+			palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+		}
+	}
+	// Nearest palette entry of every texel, two bits each, and the squared
+	// error of the block.
+	static float indicesBC1(const __m128 c[4][4], uint16_t c0, uint16_t c1, uint32_t& bits)
+	{
+		int palette[4][3];
+		paletteBC1(c0, c1, palette);
+		__m128 error = _mm_setzero_ps();
+		bits = 0;
+		for (int y = 0; y < 4; y++)
+		{
+			__m128 best = _mm_set1_ps(std::numeric_limits<float>::max());
+			__m128i index = _mm_setzero_si128();
+			for (int k = 0; k < 4; k++)
+			{
+				__m128 dr = _mm_sub_ps(c[0][y], _mm_set1_ps(float(palette[k][0])));
+				__m128 dg = _mm_sub_ps(c[1][y], _mm_set1_ps(float(palette[k][1])));
+				__m128 db = _mm_sub_ps(c[2][y], _mm_set1_ps(float(palette[k][2])));
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+				index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, index));
+				best = _mm_min_ps(d, best);
+			}
+			error = _mm_add_ps(error, best);
+			// Two bits per lane into the byte of the row.
+			alignas(16) int32_t lanes[4];
+			_mm_store_si128((__m128i *)lanes, index);
+			bits |= uint32_t(lanes[0] | lanes[1] << 2 | lanes[2] << 4 | lanes[3] << 6) << (y * 8);
+		}
+		return sum(error);
+	}
+
+	static int expand(int q, int p, int bits)
+	{
+		int v = q << 1 | p;
+		int n = bits + 1;
+		return (v << (8 - n)) | (v >> (2 * n - 8));
+	}
+	static int quantize(float x, int p, int bits)
+	{
+		int q = int(std::floor((x * ((1 << (bits + 1)) - 1) / 255.0f - p) * 0.5f + 0.5f));
+		return std::min(std::max(q, 0), (1 << bits) - 1);
+	}
+	// Quantizes the endpoints of a subset, choosing p bits per endpoint or,
+	// with shared, one for both.
+	static void quantize(const float * e0, const float * e1, int channels, int bits, bool shared, Subset& s)
+	{
+		const float * e[2] = {e0, e1};
+		float error[2][2] = {};
+		for (int p = 0; p < 2; p++)
+		{
+			for (int i = 0; i < 2; i++)
+			{
+				for (int k = 0; k < channels; k++)
+				{
+					float d = expand(quantize(e[i][k], p, bits), p, bits) - e[i][k];
+					error[i][p] += d * d;
+				}
+			}
+		}
+		for (int i = 0; i < 2; i++)
+		{
+			s.p[i] = shared ? error[0][1] + error[1][1] < error[0][0] + error[1][0] : error[i][1] < error[i][0];
+			for (int k = 0; k < channels; k++)
+			{
+				s.q[i][k] = quantize(e[i][k], s.p[i], bits);
+			}
+		}
+	}
+	// Nearest palette entry of every member of a subset, and the error.
+	static float indicesBC7(const float (*texels)[4], int count, int channels, int indexBits, int bits, Subset& s)
+	{
+		const int * weights = indexBits == 3 ? WEIGHTS3 : WEIGHTS4;
+		int entries = 1 << indexBits;
+		int palette[16][4];
+		for (int k = 0; k < channels; k++)
+		{
+			int a = expand(s.q[0][k], s.p[0], bits);
+			int b = expand(s.q[1][k], s.p[1], bits);
+			for (int j = 0; j < entries; j++)
+			{
+				palette[j][k] = ((64 - weights[j]) * a + weights[j] * b + 32) >> 6;
+			}
+		}
+		float error = 0;
+		for (int i = 0; i < count; i++)
+		{
+			float best = std::numeric_limits<float>::max();
+			for (int j = 0; j < entries; j++)
+			{
+				float d = 0;
+				for (int k = 0; k < channels; k++)
+				{
+					float t = texels[i][k] - palette[j][k];
+					d += t * t;
+				}
+				if (d < best)
+				{
+					best = d;
+					s.index[i] = uint8_t(j);
+				}
+			}
+			error += best;
+		}
+		return error;
+	}
+	// Mean and covariance of a set of texels.
+	static void moments(const float (*texels)[4], int count, int channels, float * mean, float (*covariance)[4])
+	{
+		for (int k = 0; k < channels; k++)
+		{
+			mean[k] = 0;
+			for (int i = 0; i < count; i++)
+			{
+				mean[k] += texels[i][k];
+			}
+			mean[k] /= count;
+		}
+		for (int j = 0; j < channels; j++)
+		{
+			for (int k = j; k < channels; k++)
+			{
+				float c = 0;
+				for (int i = 0; i < count; i++)
+				{
+					c += (texels[i][j] - mean[j]) * (texels[i][k] - mean[k]);
+				}
+				covariance[j][k] = c;
+				covariance[k][j] = c;
+			}
+		}
+	}
+	// Endpoints and indices of one subset: the extent along the principal
+	// axis, then least squares refits while they lower the error.
+	static void fitBC7(const float (*texels)[4], int count, int channels, int indexBits, int bits, bool shared, Subset& best)
+	{
+		const int * weights = indexBits == 3 ? WEIGHTS3 : WEIGHTS4;
+		float mean[4], covariance[4][4], v[4];
+		moments(texels, count, channels, mean, covariance);
+		axis(covariance, channels, v);
+		float lo = 0, hi = 0;
+		for (int i = 0; i < count; i++)
+		{
+			float t = 0;
+			for (int k = 0; k < channels; k++)
+			{
+				t += (texels[i][k] - mean[k]) * v[k];
+			}
+			lo = std::min(lo, t);
+			hi = std::max(hi, t);
+		}
+		float e0[4], e1[4];
+		for (int k = 0; k < channels; k++)
+		{
+			e0[k] = clamp(mean[k] + lo * v[k]);
+			e1[k] = clamp(mean[k] + hi * v[k]);
+		}
+		for (int iteration = 0; iteration < 4; iteration++)
+		{
+			Subset s = {};
+			quantize(e0, e1, channels, bits, shared, s);
+			s.error = indicesBC7(texels, count, channels, indexBits, bits, s);
+			// The first fit is kept whatever its error, so best is always set.
+			if (iteration > 0 && !(s.error < best.error))
+			{
+				break;
+			}
+			best = s;
+			float weight[16];
+			for (int i = 0; i < count; i++)
+			{
+				weight[i] = weights[s.index[i]] / 64.0f;
+			}
+			if (best.error == 0 || !fit(texels, weight, count, channels, e0, e1))
+			{
+				break;
+			}
+		}
+	}
+	// Swaps the endpoints of a subset so its anchor index has a clear top bit.
+	static void anchor(Subset& s, int member, int indexBits)
+	{
+		int top = 1 << (indexBits - 1);
+		if (s.index[member] & top)
+		{
+			for (int k = 0; k < 4; k++)
+			{
+				std::swap(s.q[0][k], s.q[1][k]);
+			}
+			std::swap(s.p[0], s.p[1]);
+			for (int i = 0; i < 16; i++)
+			{
+				s.index[i] = uint8_t((2 * top - 1) - s.index[i]);
+			}
+		}
+	}
+	// Spread of the texels off the principal axes of the two subsets of a
+	// partition, which mode 1 cannot represent.
+	static float residual(const float (*texels)[4], uint16_t partition)
+	{
+		float total = 0;
+		for (int subset = 0; subset < 2; subset++)
+		{
+			float members[16][4];
+			int count = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				if (((partition >> i) & 1) == subset)
+				{
+					memcpy(members[count++], texels[i], sizeof(members[0]));
+				}
+			}
+			float mean[4], covariance[4][4], v[4];
+			moments(members, count, 3, mean, covariance);
+			total += covariance[0][0] + covariance[1][1] + covariance[2][2] - axis(covariance, 3, v);
+		}
+		return total;
+	}
+
+	static void encodeBC7(const uint8_t * block, uint8_t * out)
+	{
+		float texels[16][4];
+		bool opaque = true;
+		for (int i = 0; i < 16; i++)
+		{
+			for (int k = 0; k < 4; k++)
+			{
+				texels[i][k] = block[i * 4 + k];
+			}
+			opaque = opaque && block[i * 4 + 3] == 255;
+		}
+
+		Subset mode6;
+		fitBC7(texels, 16, 4, 4, 7, false, mode6);
+		float error = mode6.error;
+
+		int partition = -1;
+		Subset mode1[2];
+		if (opaque && error > 0)
+		{
+			int order[64];
+			float estimate[64];
+			for (int i = 0; i < 64; i++)
+			{
+				order[i] = i;
+				estimate[i] = residual(texels, PARTITIONS[i]);
+			}
+			std::partial_sort(order, order + CANDIDATES, order + 64,
+				[&estimate](int a, int b) { return estimate[a] < estimate[b]; });
+			for (int c = 0; c < CANDIDATES; c++)
+			{
+				uint16_t mask = PARTITIONS[order[c]];
+				Subset s[2];
+				float total = 0;
+				for (int subset = 0; subset < 2; subset++)
+				{
+					float members[16][4];
+					int count = 0;
+					for (int i = 0; i < 16; i++)
+					{
+						if (((mask >> i) & 1) == subset)
+						{
+							memcpy(members[count++], texels[i], sizeof(members[0]));
+						}
+					}
+					fitBC7(members, count, 3, 3, 6, true, s[subset]);
+					total += s[subset].error;
+				}
+				if (total < error)
+				{
+					error = total;
+					partition = order[c];
+					mode1[0] = s[0];
+					mode1[1] = s[1];
+				}
+			}
+		}
+
+		Bits bits;
+		if (partition < 0)
+		{
+			anchor(mode6, 0, 4);
+			bits.write(1 << 6, 7);
+			for (int k = 0; k < 4; k++)
+			{
+				bits.write(mode6.q[0][k], 7);
+				bits.write(mode6.q[1][k], 7);
+			}
+			bits.write(mode6.p[0], 1);
+			bits.write(mode6.p[1], 1);
+			for (int i = 0; i < 16; i++)
+			{
+				bits.write(mode6.index[i], i == 0 ? 3 : 4);
+			}
+		}
+		else
+		{
+			// Back from member order to texel order.
+			uint16_t mask = PARTITIONS[partition];
+			uint8_t index[16];
+			int member[2] = {0, 0};
+			int anchors[2] = {0, ANCHORS[partition]};
+			for (int subset = 0; subset < 2; subset++)
+			{
+				int m = 0;
+				for (int i = 0; i < anchors[subset]; i++)
+				{
+					m += ((mask >> i) & 1) == subset;
+				}
+				anchor(mode1[subset], m, 3);
+			}
+			for (int i = 0; i < 16; i++)
+			{
+				int subset = (mask >> i) & 1;
+				index[i] = mode1[subset].index[member[subset]++];
+			}
+			bits.write(1 << 1, 2);
+			bits.write(partition, 6);
+			for (int k = 0; k < 3; k++)
+			{
+				for (int subset = 0; subset < 2; subset++)
+				{
+					bits.write(mode1[subset].q[0][k], 6);
+					bits.write(mode1[subset].q[1][k], 6);
+				}
+			}
+			bits.write(mode1[0].p[0], 1);
+			bits.write(mode1[1].p[0], 1);
+			for (int i = 0; i < 16; i++)
+			{
+				bits.write(index[i], i == anchors[0] || i == anchors[1] ? 2 : 3);
+			}
+		}
+		memcpy(out, bits.word, 16);
+	}
+
+	static void decodeBC1(const uint8_t * block, uint8_t * texels)
+	{
+		uint16_t c0 = uint16_t(block[0] | block[1] << 8);
+		uint16_t c1 = uint16_t(block[2] | block[3] << 8);
+		int palette[4][3];
+		paletteBC1(c0, c1, palette);
+		int alpha[4] = {255, 255, 255, 255};
+		if (c0 <= c1)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+				palette[3][k] = 0;
+			}
+			alpha[3] = 0;
+		}
+		uint32_t bits = uint32_t(block[4] | block[5] << 8 | block[6] << 16 | uint32_t(block[7]) << 24);
+		for (int i = 0; i < 16; i++)
+		{
+			int index = (bits >> (2 * i)) & 3;
+			for (int k = 0; k < 3; k++)
+			{
+				texels[i * 4 + k] = uint8_t(palette[index][k]);
+			}
+			texels[i * 4 + 3] = uint8_t(alpha[index]);
+		}
+	}
+	static void decodeBC4(const uint8_t * block, uint8_t * texels, int channel)
+	{
+		int r0 = block[0], r1 = block[1];
+		int palette[8] = {r0, r1};
+		for (int c = 2; c < 8; c++)
+		{
+			palette[c] = r0 > r1 ? ((8 - c) * r0 + (c - 1) * r1) / 7 : c < 6 ? ((6 - c) * r0 + (c - 1) * r1) / 5 : c == 6 ? 0 : 255;
+		}
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			bits |= uint64_t(block[2 + i]) << (8 * i);
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			texels[i * 4 + channel] = uint8_t(palette[(bits >> (3 * i)) & 7]);
+		}
+	}
+	// Modes 1 and 6, the ones encode writes.
+	static void decodeBC7(const uint8_t * block, uint8_t * texels)
+	{
+		Bits bits(block);
+		int mode = 0;
+		while (mode < 8 && bits.read(1) == 0)
+		{
+			mode++;
+		}
+		if (mode == 6)
+		{
+			int e[2][4];
+			for (int k = 0; k < 4; k++)
+			{
+				e[0][k] = bits.read(7);
+				e[1][k] = bits.read(7);
+			}
+			int p0 = bits.read(1), p1 = bits.read(1);
+			for (int k = 0; k < 4; k++)
+			{
+				e[0][k] = expand(e[0][k], p0, 7);
+				e[1][k] = expand(e[1][k], p1, 7);
+			}
+			for (int i = 0; i < 16; i++)
+			{
+				int w = WEIGHTS4[bits.read(i == 0 ? 3 : 4)];
+				for (int k = 0; k < 4; k++)
+				{
+					texels[i * 4 + k] = uint8_t(((64 - w) * e[0][k] + w * e[1][k] + 32) >> 6);
+				}
+			}
+		}
+		else if (mode == 1)
+		{
+			int partition = bits.read(6);
+			int e[4][3];
+			for (int k = 0; k < 3; k++)
+			{
+				for (int j = 0; j < 4; j++)
+				{
+					e[j][k] = bits.read(6);
+				}
+			}
+			int p[2] = {int(bits.read(1)), int(bits.read(1))};
+			for (int j = 0; j < 4; j++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					e[j][k] = expand(e[j][k], p[j / 2], 6);
+				}
+			}
+			for (int i = 0; i < 16; i++)
+			{
+				int subset = (PARTITIONS[partition] >> i) & 1;
+				int w = WEIGHTS3[bits.read(i == 0 || i == ANCHORS[partition] ? 2 : 3)];
+				for (int k = 0; k < 3; k++)
+				{
+					texels[i * 4 + k] = uint8_t(((64 - w) * e[2 * subset][k] + w * e[2 * subset + 1][k] + 32) >> 6);
+				}
+				texels[i * 4 + 3] = 255;
+			}
+		}
+		else
+		{
+			throw 0;
+		}
+	}
+
+	struct Image
+	{
+		Format format;
+		const uint8_t * rgba;
+		uint8_t * blocks;
+		int width;
+		int height;
+		int channel;
+	};
+	static void rows(std::size_t begin, std::size_t end, void * context)
+	{
+		const Image& image = *static_cast<const Image *>(context);
+		int columns = (image.width + 3) / 4;
+		int size = blockSize(image.format);
+		for (std::size_t by = begin; by < end; by++)
+		{
+			uint8_t * out = image.blocks + by * columns * size;
+			for (int bx = 0; bx < columns; bx++, out += size)
+			{
+				uint8_t texels[64];
+				gather(image.rgba, image.width, image.height, bx, int(by), texels);
+				encodeBlock(image.format, texels, out, image.channel);
+			}
+		}
+	}
+public:
+	static int blockSize(Format format)
+	{
+		return format == BC7 ? 16 : 8;
+	}
+	// Bytes of an image in format, for glCompressedTexImage2D.
+	static std::size_t size(Format format, int width, int height)
+	{
+		return std::size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+	}
+	// The 4x4 texels of block (bx, by), RGBA row by row.
+	static void gather(const uint8_t * rgba, int width, int height, int bx, int by, uint8_t * texels)
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			const uint8_t * row = rgba + std::size_t(std::min(by * 4 + y, height - 1)) * width * 4;
+			if (bx * 4 + 3 < width)
+			{
+				memcpy(texels + y * 16, row + bx * 16, 16);
+				continue;
+			}
+			for (int x = 0; x < 4; x++)
+			{
+				memcpy(texels + y * 16 + x * 4, row + std::min(bx * 4 + x, width - 1) * 4, 4);
+			}
+		}
+	}
+	static void encodeBC1(const uint8_t * texels, uint8_t * out)
+	{
+		__m128 c[4][4];
+		load(texels, c);
+		float mean[3], covariance[4][4];
+		for (int k = 0; k < 3; k++)
+		{
+			mean[k] = sum(_mm_add_ps(_mm_add_ps(c[k][0], c[k][1]), _mm_add_ps(c[k][2], c[k][3]))) / 16;
+		}
+		__m128 d[3][4];
+		for (int k = 0; k < 3; k++)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				d[k][y] = _mm_sub_ps(c[k][y], _mm_set1_ps(mean[k]));
+			}
+		}
+		for (int j = 0; j < 3; j++)
+		{
+			for (int k = j; k < 3; k++)
+			{
+				__m128 s = _mm_setzero_ps();
+				for (int y = 0; y < 4; y++)
+				{
+					s = _mm_add_ps(s, _mm_mul_ps(d[j][y], d[k][y]));
+				}
+				covariance[j][k] = covariance[k][j] = sum(s);
+			}
+		}
+		float v[4];
+		axis(covariance, 3, v);
+		__m128 lo = _mm_set1_ps(0), hi = _mm_set1_ps(0);
+		for (int y = 0; y < 4; y++)
+		{
+			__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d[0][y], _mm_set1_ps(v[0])), _mm_mul_ps(d[1][y], _mm_set1_ps(v[1]))),
+				_mm_mul_ps(d[2][y], _mm_set1_ps(v[2])));
+			lo = _mm_min_ps(lo, t);
+			hi = _mm_max_ps(hi, t);
+		}
+		lo = _mm_min_ps(lo, _mm_movehl_ps(lo, lo));
+		lo = _mm_min_ss(lo, _mm_shuffle_ps(lo, lo, 1));
+		hi = _mm_max_ps(hi, _mm_movehl_ps(hi, hi));
+		hi = _mm_max_ss(hi, _mm_shuffle_ps(hi, hi, 1));
+		float e0[3], e1[3];
+		for (int k = 0; k < 3; k++)
+		{
+			e0[k] = mean[k] + _mm_cvtss_f32(hi) * v[k];
+			e1[k] = mean[k] + _mm_cvtss_f32(lo) * v[k];
+		}
+		uint16_t c0 = pack565(e0), c1 = pack565(e1);
+		uint32_t bits;
+		float error = indicesBC1(c, c0, c1, bits);
+
+		if (error > 0 && c0 != c1)
+		{
+			static const float weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+			float rgb[16][4], weight[16];
+			for (int i = 0; i < 16; i++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					rgb[i][k] = texels[i * 4 + k];
+				}
+				weight[i] = weights[(bits >> (2 * i)) & 3];
+			}
+			if (fit(rgb, weight, 16, 3, e0, e1))
+			{
+				uint16_t r0 = pack565(e0), r1 = pack565(e1);
+				uint32_t refined;
+				if (indicesBC1(c, r0, r1, refined) < error)
+				{
+					c0 = r0;
+					c1 = r1;
+					bits = refined;
+				}
+			}
+		}
+		// Four color mode needs c0 > c1, swapping the endpoints swaps index
+		// 0 with 1 and 2 with 3.
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			bits ^= 0x55555555;
+		}
+		else if (c0 == c1)
+		{
+			bits = 0;
+		}
+		out[0] = uint8_t(c0);
+		out[1] = uint8_t(c0 >> 8);
+		out[2] = uint8_t(c1);
+		out[3] = uint8_t(c1 >> 8);
+		memcpy(out + 4, &bits, 4);
+	}
+	static void encodeBC4(const uint8_t * texels, uint8_t * out, int channel)
+	{
+		__m128i mask = _mm_set1_epi32(0xff);
+		__m128i v[4];
+		for (int y = 0; y < 4; y++)
+		{
+			__m128i row = _mm_loadu_si128((const __m128i *)(texels + y * 16));
+			v[y] = _mm_and_si128(_mm_srl_epi32(row, _mm_cvtsi32_si128(channel * 8)), mask);
+		}
+		__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+		__m128i lo = bytes, hi = bytes;
+		lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 8));
+		hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 8));
+		lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+		hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+		lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 2));
+		hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 2));
+		lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 1));
+		hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 1));
+		int minimum = _mm_cvtsi128_si32(lo) & 0xff;
+		int maximum = _mm_cvtsi128_si32(hi) & 0xff;
+		out[0] = uint8_t(maximum);
+		out[1] = uint8_t(minimum);
+		uint64_t bits = 0;
+		if (maximum > minimum)
+		{
+			__m128 scale = _mm_set1_ps(7.0f / (maximum - minimum));
+			__m128i base = _mm_set1_epi32(minimum);
+			for (int y = 0; y < 4; y++)
+			{
+				alignas(16) int32_t ramp[4];
+				_mm_store_si128((__m128i *)ramp, _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(v[y], base)), scale)));
+				for (int x = 0; x < 4; x++)
+				{
+					bits |= uint64_t(BC4_CODES[ramp[x]]) << (3 * (y * 4 + x));
+				}
+			}
+		}
+		for (int i = 0; i < 6; i++)
+		{
+			out[2 + i] = uint8_t(bits >> (8 * i));
+		}
+	}
+	// channel picks the channel of BC4, the others ignore it.
+	static void encodeBlock(Format format, const uint8_t * texels, uint8_t * out, int channel = 0)
+	{
+		switch (format)
+		{
+		case BC1:
+			encodeBC1(texels, out);
+			break;
+		case BC4:
+			encodeBC4(texels, out, channel);
+			break;
+		case BC7:
+			encodeBC7(texels, out);
+			break;
+		}
+	}
+	// Writes the texels of a block; BC4 only touches channel.
+	static void decodeBlock(Format format, const uint8_t * block, uint8_t * texels, int channel = 0)
+	{
+		switch (format)
+		{
+		case BC1:
+			decodeBC1(block, texels);
+			break;
+		case BC4:
+			decodeBC4(block, texels, channel);
+			break;
+		case BC7:
+			decodeBC7(block, texels);
+			break;
+		}
+	}
+
+	// rgba: width * height texels; blocks: size(format, width, height) bytes.
+	static void encode(Format format, const uint8_t * rgba, int width, int height, uint8_t * blocks, int channel = 0)
+	{
+		Image image = {format, rgba, blocks, width, height, channel};
+		rows(0, (height + 3) / 4, &image);
+	}
+	static void encode(JobSystem& jobs, Format format, const uint8_t * rgba, int width, int height, uint8_t * blocks, int channel = 0)
+	{
+		Image image = {format, rgba, blocks, width, height, channel};
+		jobs.parallel_for((height + 3) / 4, rows, &image);
+	}
+	static void decode(Format format, const uint8_t * blocks, int width, int height, uint8_t * rgba, int channel = 0)
+	{
+		int columns = (width + 3) / 4;
+		for (int by = 0; by < (height + 3) / 4; by++)
+		{
+			for (int bx = 0; bx < columns; bx++)
+			{
+				uint8_t texels[64];
+				gather(rgba, width, height, bx, by, texels);
+				decodeBlock(format, blocks + (std::size_t(by) * columns + bx) * blockSize(format), texels, channel);
+				for (int y = 0; y < 4 && by * 4 + y < height; y++)
+				{
+					for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+					{
+						memcpy(rgba + (std::size_t(by * 4 + y) * width + bx * 4 + x) * 4, texels + (y * 4 + x) * 4, 4);
+					}
+				}
+			}
+		}
+	}
+	// Peak signal to noise ratio in dB over channels [first, first + count)
+	// of two RGBA8 images, infinite when they are equal.
+	static double psnr(const uint8_t * a, const uint8_t * b, std::size_t texels, int first = 0, int count = 3)
+	{
+		double squared = 0;
+		for (std::size_t i = 0; i < texels; i++)
+		{
+			for (int k = first; k < first + count; k++)
+			{
+				double d = double(a[i * 4 + k]) - b[i * 4 + k];
+				squared += d * d;
+			}
+		}
+		if (squared == 0)
+		{
+			return std::numeric_limits<double>::infinity();
+		}
+		return 10.0 * std::log10(255.0 * 255.0 * texels * count / squared);
+	}
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "GL.h"
+#include "NamePool.h"
+
+
+template <GLuint ID>
+class VertexAttribute
+{
+public:
+	static void enable()
+	{
+		glEnableVertexAttribArray(ID);
+	}
+	static void disable()
+	{
+		glDisableVertexAttribArray(ID);
+	}
+	static void set(GLint size, GLenum type, GLboolean norm, GLsizei stride, const GLvoid * pointer)
+	{
+		glVertexAttribPointer(ID, size, type, norm, stride, pointer);
+	}
+	// Integer attributes, read as int or uint in the shader.
+	static void setInteger(GLint size, GLenum type, GLsizei stride, const GLvoid * pointer)
+	{
+		glVertexAttribIPointer(ID, size, type, stride, pointer);
+	}
+};
+
+// The wrappers own their GL name through Name: they can be moved but not
+// copied, and delete the name when destroyed. destroy() does it early, for
+// objects that outlive the context.
+class VertexArray
+{
+private:
+	Name<VertexArrayObjects> _name;
+public:
+	VertexArray() = default;
+	VertexArray(VertexArray&&) = default;
+	VertexArray& operator=(VertexArray&&) = default;
+	VertexArray(const VertexArray&) = delete;
+	VertexArray& operator=(const VertexArray&) = delete;
+	GLuint id() const
+	{
+		return _name.id();
+	}
+	void bind()
+	{
+		glBindVertexArray(_name.id());
+	}
+	void destroy()
+	{
+		_name.reset();
+	}
+	static void drawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid * indices)
+	{
+		glDrawElements(mode, count, type, indices);
+	}
+};
+
+template <GLenum TARGET>
+class Buffer
+{
+private:
+	Name<BufferObjects> _name;
+public:
+	Buffer() = default;
+	Buffer(Buffer&&) = default;
+	Buffer& operator=(Buffer&&) = default;
+	Buffer(const Buffer&) = delete;
+	Buffer& operator=(const Buffer&) = delete;
+	GLuint id() const
+	{
+		return _name.id();
+	}
+	void bind()
+	{
+		glBindBuffer(TARGET, _name.id());
+	}
+	void destroy()
+	{
+		_name.reset();
+	}
+	// For indexed targets: binds to binding point index, as the shader's
+	// layout(binding = index) names it.
+	void bindBase(GLuint index)
+	{
+		glBindBufferBase(TARGET, index, _name.id());
+	}
+	static void data(GLsizeiptr size, const GLvoid * data, GLenum usage)
+	{
+		glBufferData(TARGET, size, data, usage);
+	}
+	static void staticData(GLsizeiptr size, const GLvoid * data)
+	{
+		Buffer::data(size, data, GL_STATIC_DRAW);
+	}
+	static void streamData(GLsizeiptr size, const GLvoid * data)
+	{
+		Buffer::data(size, data, GL_STREAM_DRAW);
+	}
+};
+
+class ArrayBuffer : public Buffer<GL_ARRAY_BUFFER>{};
+class ElementArrayBuffer : public Buffer<GL_ELEMENT_ARRAY_BUFFER>{};
+class ShaderStorageBuffer : public Buffer<GL_SHADER_STORAGE_BUFFER>{};
+class PixelPackBuffer : public Buffer<GL_PIXEL_PACK_BUFFER>{};
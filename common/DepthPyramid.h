@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Matrix4f.h"
+
+#include <xmmintrin.h>
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+
+// Hierarchical Z for occlusion culling: a chain of depth images, each half
+// the size of the previous one and holding the farthest depth of the 2x2
+// texels under it. Built from any window depth in [0, 1], GL's
+// glReadPixels(GL_DEPTH_COMPONENT) of the last frame or SoftRaster::depth()
+// of a low resolution occluder pass.
+//
+// visible() projects a bounding box and picks the level where its screen
+// rectangle spans at most 2x2 texels, so every test reads four values
+// whatever the size of the object. The box is hidden when its nearest
+// point is behind the farthest depth of all four.
+class DepthPyramid
+{
+	std::vector<std::vector<float> > _levels;
+	std::vector<int> _widths;
+	std::vector<int> _heights;
+public:
+	// depth: width * height values, bottom row first.
+	void build(const float * depth, int width, int height)
+	{
+		_levels.resize(1);
+		_widths.assign(1, width);
+		_heights.assign(1, height);
+		_levels[0].assign(depth, depth + std::size_t(width) * height);
+		while (width > 1 || height > 1)
+		{
+			int w = (width + 1) / 2;
+			int h = (height + 1) / 2;
+			const std::vector<float>& fine = _levels.back();
+			std::vector<float> coarse(std::size_t(w) * h);
+			for (int y = 0; y < h; y++)
+			{
+				// Odd sizes repeat the last row and column.
+				const float * r0 = &fine[std::size_t(2 * y) * width];
+				const float * r1 = &fine[std::size_t(std::min(2 * y + 1, height - 1)) * width];
+				for (int x = 0; x < w; x++)
+				{
+					int x1 = std::min(2 * x + 1, width - 1);
+					coarse[std::size_t(y) * w + x] = std::max(std::max(r0[2 * x], r0[x1]), std::max(r1[2 * x], r1[x1]));
+				}
+			}
+			_levels.push_back(coarse);
+			_widths.push_back(w);
+			_heights.push_back(h);
+			width = w;
+			height = h;
+		}
+	}
+	int levels() const
+	{
+		return int(_levels.size());
+	}
+	int width(int level) const
+	{
+		return _widths[level];
+	}
+	int height(int level) const
+	{
+		return _heights[level];
+	}
+	const float * level(int level) const
+	{
+		return &_levels[level][0];
+	}
+	// Normalized device coordinate bounds of the box from minimum to maximum
+	// in the space mvp transforms. False when the box reaches behind the
+	// camera, where the bounds are meaningless.
+	static bool project(const float * minimum, const float * maximum, const Matrix4f& mvp, float * lo, float * hi)
+	{
+		// Corner (i, j, k) = x[i] + y[j] + z[k] with the translation in x.
+		__m128 x[2], y[2], z[2];
+		for (int i = 0; i < 2; i++)
+		{
+			const float * c = i ? maximum : minimum;
+			x[i] = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&mvp._data[0]), _mm_set1_ps(c[0])), _mm_loadu_ps(&mvp._data[12]));
+			y[i] = _mm_mul_ps(_mm_loadu_ps(&mvp._data[4]), _mm_set1_ps(c[1]));
+			z[i] = _mm_mul_ps(_mm_loadu_ps(&mvp._data[8]), _mm_set1_ps(c[2]));
+		}
+		for (int a = 0; a < 3; a++)
+		{
+			lo[a] = 1e30f;
+			hi[a] = -1e30f;
+		}
+		for (int corner = 0; corner < 8; corner++)
+		{
+			alignas(16) float clip[4];
+			_mm_store_ps(clip, _mm_add_ps(_mm_add_ps(x[corner & 1], y[(corner >> 1) & 1]), z[corner >> 2]));
+			if (clip[3] <= 1e-5f)
+			{
+				return false;
+			}
+			for (int a = 0; a < 3; a++)
+			{
+				float ndc = clip[a] / clip[3];
+				lo[a] = std::min(lo[a], ndc);
+				hi[a] = std::max(hi[a], ndc);
+			}
+		}
+		return true;
+	}
+	// Whether the box may intersect the view volume of mvp.
+	static bool inFrustum(const float * minimum, const float * maximum, const Matrix4f& mvp)
+	{
+		float lo[3], hi[3];
+		if (!project(minimum, maximum, mvp, lo, hi))
+		{
+			return true;
+		}
+		return hi[0] >= -1.0f && lo[0] <= 1.0f && hi[1] >= -1.0f && lo[1] <= 1.0f && hi[2] >= -1.0f && lo[2] <= 1.0f;
+	}
+	// Whether the box may be in front of the depth the pyramid was built
+	// from, seen with the mvp that depth was rendered with. Boxes outside
+	// the frustum are not visible, boxes crossing the near plane always are.
+	bool visible(const float * minimum, const float * maximum, const Matrix4f& mvp) const
+	{
+		float lo[3], hi[3];
+		if (!project(minimum, maximum, mvp, lo, hi))
+		{
+			return true;
+		}
+		if (hi[0] < -1.0f || lo[0] > 1.0f || hi[1] < -1.0f || lo[1] > 1.0f || hi[2] < -1.0f || lo[2] > 1.0f)
+		{
+			return false;
+		}
+		if (lo[2] < -1.0f || _levels.empty())
+		{
+			return true;
+		}
+		int w = _widths[0];
+		int h = _heights[0];
+		int x0 = std::max(int((lo[0] * 0.5f + 0.5f) * w), 0);
+		int x1 = std::min(int((hi[0] * 0.5f + 0.5f) * w), w - 1);
+		int y0 = std::max(int((lo[1] * 0.5f + 0.5f) * h), 0);
+		int y1 = std::min(int((hi[1] * 0.5f + 0.5f) * h), h - 1);
+		int l = 0;
+		while ((x1 >> l) - (x0 >> l) > 1 || (y1 >> l) - (y0 >> l) > 1)
+		{
+			l++;
+		}
+		const float * d = &_levels[l][0];
+		int stride = _widths[l];
+		float farthest = 0;
+		for (int ty = y0 >> l; ty <= y1 >> l; ty++)
+		{
+			for (int tx = x0 >> l; tx <= x1 >> l; tx++)
+			{
+				farthest = std::max(farthest, d[std::size_t(ty) * stride + tx]);
+			}
+		}
+		return lo[2] * 0.5f + 0.5f <= farthest;
+	}
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Quaternion.h"
+
+#include <iostream>
+#include <cmath>
+
+
+// A rigid transform as real + dual * e, e * e = 0: the real part is the
+// rotation, the dual part half the translation times the rotation. Products
+// compose transforms like Quaternion::apply does rotations, and weighted
+// sums of them blend without the shrinking of blended matrices, which is
+// what skinning needs. Literal type like Quaternion.
+class DualQuaternion
+{
+private:
+	Quaternion _real;
+	Quaternion _dual;
+public:
+	constexpr DualQuaternion(const Quaternion &real, const Quaternion &dual) : _real(real), _dual(dual)
+	{}
+	static constexpr DualQuaternion identity()
+	{
+		return DualQuaternion(Quaternion(1, 0, 0, 0), Quaternion(0, 0, 0, 0));
+	}
+	// Rotates by rotation, then translates by (x, y, z).
+	static constexpr DualQuaternion rigid(const Quaternion &rotation, float x, float y, float z)
+	{
+		Quaternion dual(0, x * 0.5f, y * 0.5f, z * 0.5f);
+		dual.apply(rotation);
+		return DualQuaternion(rotation, dual);
+	}
+	static constexpr DualQuaternion translation(float x, float y, float z)
+	{
+		return rigid(Quaternion(1, 0, 0, 0), x, y, z);
+	}
+	constexpr const Quaternion& real() const
+	{
+		return _real;
+	}
+	constexpr const Quaternion& dual() const
+	{
+		return _dual;
+	}
+	// this = this * q: q is applied first, like Quaternion::apply.
+	constexpr void apply(const DualQuaternion &q)
+	{
+		Quaternion real = _real;
+		real.apply(q._real);
+		Quaternion dual = _real;
+		dual.apply(q._dual);
+		Quaternion cross = _dual;
+		cross.apply(q._real);
+		dual.add(cross);
+		_real = real;
+		_dual = dual;
+	}
+	// The inverse transform, for unit dual quaternions.
+	constexpr DualQuaternion conjugate() const
+	{
+		return DualQuaternion(_real.conjugate(), _dual.conjugate());
+	}
+	// Adds weight * q, on the same side of the 4D sphere as this so the
+	// blend takes the short way around.
+	constexpr void accumulate(const DualQuaternion &q, float weight)
+	{
+		if (_real.dot(q._real) < 0)
+		{
+			weight = -weight;
+		}
+		Quaternion real = q._real;
+		real.scale(weight);
+		Quaternion dual = q._dual;
+		dual.scale(weight);
+		_real.add(real);
+		_dual.add(dual);
+	}
+	// Back to a rigid transform after a blend.
+	void normalize()
+	{
+		float inverse = 1.0f / std::sqrt(_real.dot(_real));
+		_real.scale(inverse);
+		_dual.scale(inverse);
+	}
+	// out = rotation * p + translation. With translate false, only rotates,
+	// for normals.
+	constexpr void transform(const float * p, float * out, bool translate = true) const
+	{
+		float w = _real[0], x = _real[1], y = _real[2], z = _real[3];
+		// v + 2 r x (r x v + w v)
+		float cx = y * p[2] - z * p[1] + w * p[0];
+		float cy = z * p[0] - x * p[2] + w * p[1];
+		float cz = x * p[1] - y * p[0] + w * p[2];
+		float rx = p[0] + 2.0f * (y * cz - z * cy);
+		float ry = p[1] + 2.0f * (z * cx - x * cz);
+		float rz = p[2] + 2.0f * (x * cy - y * cx);
+		if (translate)
+		{
+			// 2 * dual * conjugate(real)
+			float dw = _dual[0], dx = _dual[1], dy = _dual[2], dz = _dual[3];
+			rx += 2.0f * (w * dx - dw * x + y * dz - z * dy);
+			ry += 2.0f * (w * dy - dw * y + z * dx - x * dz);
+			rz += 2.0f * (w * dz - dw * z + x * dy - y * dx);
+		}
+		out[0] = rx;
+		out[1] = ry;
+		out[2] = rz;
+	}
+	void print() const
+	{
+		std::cout << "(" << _real[0] << "," << _real[1] << "," << _real[2] << "," << _real[3] << ") + e("
+			<< _dual[0] << "," << _dual[1] << "," << _dual[2] << "," << _dual[3] << ")" << std::endl;
+	}
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <vector>
+#include <new>
+#include <cstdint>
+#include <cstddef>
+
+
+// Bump allocator over a fixed block of memory. Allocating is a pointer
+// increment, freeing happens all at once with reset(). Not thread safe: give
+// every thread its own arena.
+class LinearArena
+{
+private:
+	char * _begin;
+	char * _end;
+	char * _current;
+	std::size_t _allocations;
+	std::size_t _peak;
+public:
+	LinearArena() : _begin(NULL), _end(NULL), _current(NULL), _allocations(0), _peak(0)
+	{}
+	LinearArena(void * memory, std::size_t size)
+	{
+		init(memory, size);
+	}
+	void init(void * memory, std::size_t size)
+	{
+		_begin = static_cast<char *>(memory);
+		_end = _begin + size;
+		_current = _begin;
+		_allocations = 0;
+		_peak = 0;
+	}
+	void * allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t))
+	{
+		uintptr_t p = reinterpret_cast<uintptr_t>(_current);
+		p = (p + alignment - 1) & ~uintptr_t(alignment - 1);
+		char * result = reinterpret_cast<char *>(p);
+		if (result + size > _end)
+		{
+			throw 0;
+		}
+		_current = result + size;
+		_allocations++;
+		return result;
+	}
+	// Uninitialized storage for count objects of T.
+	template <typename T>
+	T * allocate(std::size_t count)
+	{
+		return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+	}
+	void reset()
+	{
+		std::size_t used = _current - _begin;
+		if (used > _peak)
+		{
+			_peak = used;
+		}
+		_current = _begin;
+		_allocations = 0;
+	}
+	std::size_t used() const
+	{
+		return _current - _begin;
+	}
+	std::size_t capacity() const
+	{
+		return _end - _begin;
+	}
+	std::size_t allocations() const
+	{
+		return _allocations;
+	}
+	// Largest amount of memory used between two resets.
+	std::size_t peak() const
+	{
+		return used() > _peak ? used() : _peak;
+	}
+};
+
+
+// Allocator adaptor so standard containers can take their storage from an
+// arena. deallocate() is a no-op, the memory comes back with reset().
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+	LinearArena * arena;
+
+	ArenaAllocator(LinearArena& a) : arena(&a)
+	{}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena)
+	{}
+	T * allocate(std::size_t n)
+	{
+		return arena->allocate<T>(n);
+	}
+	void deallocate(T *, std::size_t)
+	{}
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const
+	{
+		return arena == other.arena;
+	}
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const
+	{
+		return arena != other.arena;
+	}
+};
+
+
+// Storage for everything that lives for one frame. One block is allocated up
+// front and split into a shared arena and one sub-arena per thread, so
+// threads never contend for the bump pointer; a job picks its sub-arena with
+// JobSystem::index(). reset() at the end of the frame is O(1) per arena, no
+// destructors run, and must not overlap with any thread allocating.
+class FrameArena
+{
+private:
+	char * _memory;
+	LinearArena _shared;
+	std::vector<LinearArena> _threads;
+	uint64_t _frame;
+public:
+	FrameArena(std::size_t shared, std::size_t perThread, unsigned threads) : _frame(0)
+	{
+		std::size_t size = shared + perThread * threads;
+		_memory = static_cast<char *>(operator new(size));
+		_shared.init(_memory, shared);
+		_threads.resize(threads);
+		for (unsigned i = 0; i < threads; i++)
+		{
+			_threads[i].init(_memory + shared + i * perThread, perThread);
+		}
+	}
+	~FrameArena()
+	{
+		operator delete(_memory);
+	}
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+	// Only to be used from the thread that drives the frame.
+	LinearArena& shared()
+	{
+		return _shared;
+	}
+	LinearArena& thread(unsigned index)
+	{
+		return _threads[index];
+	}
+	unsigned threads() const
+	{
+		return _threads.size();
+	}
+	uint64_t frame() const
+	{
+		return _frame;
+	}
+	std::size_t used() const
+	{
+		std::size_t total = _shared.used();
+		for (std::size_t i = 0; i < _threads.size(); i++)
+		{
+			total += _threads[i].used();
+		}
+		return total;
+	}
+	std::size_t allocations() const
+	{
+		std::size_t total = _shared.allocations();
+		for (std::size_t i = 0; i < _threads.size(); i++)
+		{
+			total += _threads[i].allocations();
+		}
+		return total;
+	}
+	// End of frame: everything allocated since the last reset is gone.
+	void reset()
+	{
+		_shared.reset();
+		for (std::size_t i = 0; i < _threads.size(); i++)
+		{
+			_threads[i].reset();
+		}
+		_frame++;
+	}
+};
@@ -0,0 +1,278 @@
+#pragma once
+
+// Deterministic frame capture for the examples.
+//
+// With --capture N an example renders N frames into a hidden window, reads
+// every frame back asynchronously through a PixelReadback ring and
+// compares it against golden images <golden>/<name>_<frame>.ppm, or writes
+// them with --update. Without --capture every call is a no-op. finish()
+// releases the GL objects and must be called while the context is still
+// current.
+//
+// ctest checks several frames of StaticNoise, StaticNoise2, IndexBuffer and
+// Cube1 against the images in golden/. Rewrite them with --update after an intended change.
+//
+//   --capture N      number of frames to render and check
+//   --golden DIR     directory of the golden images (default "golden")
+//   --update         write the golden images instead of comparing
+//   --tolerance T    largest per-channel difference still considered equal
+//   --seed S         seed for the example's random generator (default 1)
+
+#include "GL.h"
+#include "PixelReadback.h"
+#include "Random.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+
+
+class FrameCapture
+{
+public:
+	static const int RING = 3;
+private:
+	std::string _name;
+	int _width;
+	int _height;
+	int _frames;
+	std::string _golden;
+	bool _update;
+	int _tolerance;
+	uint64_t _seed;
+
+	PixelReadback<RING> _readback;
+	int _failed;
+	std::vector<unsigned char> _pixels;
+	std::vector<double> _times;
+	std::chrono::steady_clock::time_point _last;
+
+	std::string path(int frame) const
+	{
+		std::ostringstream s;
+		s << _golden << "/" << _name << "_" << std::setw(4) << std::setfill('0') << frame << ".ppm";
+		return s.str();
+	}
+	static uint64_t hash(const unsigned char * data, std::size_t size)
+	{
+		uint64_t h = 14695981039346656037ULL;
+		for (std::size_t i = 0; i < size; i++)
+		{
+			h = (h ^ data[i]) * 1099511628211ULL;
+		}
+		return h;
+	}
+	// The framebuffer is bottom-up, the images are stored top-down.
+	void write(int frame, const unsigned char * rgba)
+	{
+		std::ofstream f(path(frame).c_str(), std::ios::binary);
+		f << "P6\n" << _width << " " << _height << "\n255\n";
+		std::vector<unsigned char> row(_width * 3);
+		for (int y = _height - 1; y >= 0; y--)
+		{
+			for (int x = 0; x < _width; x++)
+			{
+				memcpy(&row[x * 3], &rgba[(y * _width + x) * 4], 3);
+			}
+			f.write(reinterpret_cast<const char *>(&row[0]), row.size());
+		}
+		if (!f)
+		{
+			std::cerr << path(frame) << ": could not be written" << std::endl;
+			_failed++;
+		}
+	}
+	void compare(int frame, const unsigned char * rgba)
+	{
+		std::ifstream f(path(frame).c_str(), std::ios::binary);
+		std::string magic;
+		int w = 0, h = 0, max = 0;
+		f >> magic >> w >> h >> max;
+		f.get();
+		if (!f || magic != "P6" || w != _width || h != _height || max != 255)
+		{
+			std::cout << std::setw(4) << frame << "  missing or invalid golden image " << path(frame) << std::endl;
+			_failed++;
+			return;
+		}
+		_pixels.resize(_width * _height * 3);
+		f.read(reinterpret_cast<char *>(&_pixels[0]), _pixels.size());
+		int differing = 0;
+		int largest = 0;
+		double squared = 0;
+		for (int y = 0; y < _height; y++)
+		{
+			const unsigned char * golden = &_pixels[(_height - 1 - y) * _width * 3];
+			for (int x = 0; x < _width; x++)
+			{
+				bool differs = false;
+				for (int c = 0; c < 3; c++)
+				{
+					int d = std::abs(int(rgba[(y * _width + x) * 4 + c]) - int(golden[x * 3 + c]));
+					largest = std::max(largest, d);
+					squared += d * d;
+					differs = differs || d > _tolerance;
+				}
+				differing += differs;
+			}
+		}
+		double mse = squared / (double(_width) * _height * 3);
+		std::cout << std::setw(4) << frame << "  " << (differing ? "FAIL" : "ok  ")
+			<< "  hash " << std::hex << std::setw(16) << std::setfill('0') << hash(rgba, _width * _height * 4)
+			<< std::dec << std::setfill(' ') << "  max diff " << std::setw(3) << largest
+			<< "  pixels over tolerance " << differing;
+		if (mse > 0)
+		{
+			std::cout << "  psnr " << std::setprecision(4) << 10.0 * log10(255.0 * 255.0 / mse) << " dB";
+		}
+		std::cout << std::endl;
+		if (differing)
+		{
+			_failed++;
+		}
+	}
+	// Check the oldest frame in flight. With wait false it returns false
+	// instead of stalling if the GPU has not finished it yet.
+	bool retire(bool wait)
+	{
+		return _readback.retire(wait, [this](const void * pixels, int frame)
+		{
+			const unsigned char * rgba = static_cast<const unsigned char *>(pixels);
+			if (rgba == NULL)
+			{
+				std::cout << std::setw(4) << frame << "  could not be mapped" << std::endl;
+				_failed++;
+			}
+			else if (_update)
+			{
+				write(frame, rgba);
+			}
+			else
+			{
+				compare(frame, rgba);
+			}
+		});
+	}
+public:
+	FrameCapture(int argc, char** argv, const char * name, int width, int height)
+		: _name(name), _width(width), _height(height), _frames(0), _golden("golden"),
+		_update(false), _tolerance(0), _seed(1),
+		_readback(GL_RGBA, GL_UNSIGNED_BYTE, 4), _failed(0)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool value = i + 1 < argc;
+			if (arg == "--capture" && value)
+			{
+				_frames = atoi(argv[++i]);
+			}
+			else if (arg == "--golden" && value)
+			{
+				_golden = argv[++i];
+			}
+			else if (arg == "--update")
+			{
+				_update = true;
+			}
+			else if (arg == "--tolerance" && value)
+			{
+				_tolerance = atoi(argv[++i]);
+			}
+			else if (arg == "--seed" && value)
+			{
+				_seed = strtoull(argv[++i], NULL, 10);
+			}
+		}
+	}
+	bool enabled() const
+	{
+		return _frames > 0;
+	}
+	uint64_t seed() const
+	{
+		return _seed;
+	}
+	// Call before creating the window.
+	void hints() const
+	{
+		if (enabled())
+		{
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		}
+	}
+	bool done() const
+	{
+		return enabled() && _readback.submitted() >= _frames;
+	}
+	// Call after drawing a frame and before swapping buffers. Starts the
+	// readback of this frame and checks any earlier one that is ready.
+	void frame()
+	{
+		if (!enabled() || done())
+		{
+			return;
+		}
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (_readback.submitted() > 0)
+		{
+			_times.push_back(std::chrono::duration<double, std::milli>(now - _last).count());
+		}
+		_last = now;
+		if (_readback.submitted() - _readback.retired() == RING)
+		{
+			retire(true);
+		}
+		_readback.submit(_width, _height);
+		while (_readback.retired() < _readback.submitted() - 1 && retire(false))
+		{}
+	}
+	// Check the frames still in flight and print the report. Returns the
+	// process exit code: 0 if every frame matched.
+	int finish()
+	{
+		if (!enabled())
+		{
+			return 0;
+		}
+		while (retire(true))
+		{}
+		int checked = _readback.retired();
+		_readback.destroy();
+		if (!_times.empty())
+		{
+			std::vector<double> t(_times);
+			std::sort(t.begin(), t.end());
+			double sum = 0;
+			for (std::size_t i = 0; i < t.size(); i++)
+			{
+				sum += t[i];
+			}
+			std::cout << std::setprecision(3) << std::fixed
+				<< "frame time ms: min " << t.front()
+				<< "  mean " << sum / t.size()
+				<< "  median " << t[t.size() / 2]
+				<< "  p95 " << t[std::min(t.size() - 1, t.size() * 95 / 100)]
+				<< "  max " << t.back() << std::endl;
+			std::cout.unsetf(std::ios::floatfield);
+		}
+		if (_update)
+		{
+			std::cout << _name << ": wrote " << checked << " golden images to " << _golden << std::endl;
+		}
+		else
+		{
+			std::cout << _name << ": " << checked - _failed << "/" << checked << " frames match" << std::endl;
+		}
+		return _failed == 0 ? 0 : 1;
+	}
+};
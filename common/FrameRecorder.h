@@ -0,0 +1,443 @@
+#pragma once
+
+// Records the rendered frames of an example for offline review.
+//
+// frame() starts an asynchronous readback through a PixelReadback ring and
+// never waits for the GPU unless every buffer of the ring is still in
+// flight. Finished readbacks are copied into a pool
+// of frame buffers and handed to an encoder thread through a lock-free
+// queue, so converting and writing the frames happens off the render thread.
+// finish() drains the pipeline, releases the GL objects and must be called
+// while the context is still current.
+//
+//   --record PATH        a .y4m file for a 4:2:0 video, otherwise a directory
+//                        for a PNG sequence <PATH>/<name>_<frame>.png
+//   --record-frames N    stop after N frames (default: until the window closes)
+//   --fps F              frame rate written to the Y4M header (default 60)
+
+#include "GL.h"
+#include "PixelReadback.h"
+#include "SpscQueue.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+
+class FrameRecorder
+{
+public:
+	static const int RING = 4;
+	static const int BUFFERS = 8;
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Frame
+	{
+		int buffer;
+		int number;
+	};
+
+	std::string _name;
+	std::string _path;
+	int _width;
+	int _height;
+	int _frames;
+	int _fps;
+	bool _y4m;
+
+	PixelReadback<RING> _readback;
+
+	std::vector<unsigned char> _buffers[BUFFERS];
+	SpscQueue<Frame, BUFFERS> _ready;
+	SpscQueue<int, BUFFERS> _free;
+	std::thread _encoder;
+	std::atomic<bool> _stop;
+	std::atomic<int> _failed;
+	std::ofstream _video;
+
+	// Render thread cost and stalls, encoder cost.
+	double _recordTime;
+	double _recordMax;
+	double _frameTime;
+	Clock::time_point _last;
+	int _encoderStalls;
+	double _encodeTime;
+
+	static double milliseconds(Clock::time_point t0, Clock::time_point t1)
+	{
+		return std::chrono::duration<double, std::milli>(t1 - t0).count();
+	}
+
+	static uint32_t crc32(uint32_t crc, const unsigned char * data, std::size_t size)
+	{
+		static uint32_t table[256];
+		static bool initialized = false;
+		if (!initialized)
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				table[n] = c;
+			}
+			initialized = true;
+		}
+		crc = ~crc;
+		for (std::size_t i = 0; i < size; i++)
+		{
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+	// zlib's checksum. 5552 is the most bytes b can take from a reduced
+	// state before it overflows 32 bits.
+	static uint32_t adler32(const unsigned char * data, std::size_t size)
+	{
+		const std::size_t NMAX = 5552;
+		uint32_t a = 1, b = 0;
+		while (size > 0)
+		{
+			std::size_t n = std::min(size, NMAX);
+			size -= n;
+			for (std::size_t i = 0; i < n; i++)
+			{
+				a += data[i];
+				b += a;
+			}
+			data += n;
+			a %= 65521;
+			b %= 65521;
+		}
+		return (b << 16) | a;
+	}
+	static void put32(std::vector<unsigned char>& out, uint32_t v)
+	{
+		out.push_back(v >> 24);
+		out.push_back(v >> 16);
+		out.push_back(v >> 8);
+		out.push_back(v);
+	}
+	static void chunk(std::ofstream& f, const char * type, const std::vector<unsigned char>& data)
+	{
+		std::vector<unsigned char> header;
+		put32(header, data.size());
+		header.insert(header.end(), type, type + 4);
+		uint32_t crc = crc32(0, &header[4], 4);
+		crc = crc32(crc, data.data(), data.size());
+		std::vector<unsigned char> trailer;
+		put32(trailer, crc);
+		f.write(reinterpret_cast<const char *>(&header[0]), header.size());
+		f.write(reinterpret_cast<const char *>(data.data()), data.size());
+		f.write(reinterpret_cast<const char *>(&trailer[0]), trailer.size());
+	}
+
+	// 8 bit RGB PNG with the image data in stored (uncompressed) deflate
+	// blocks: no zlib needed and the encoder keeps up with any frame rate.
+	// Convert with any image tool if size matters.
+	void writePNG(int number, const unsigned char * rgba, std::vector<unsigned char>& scratch)
+	{
+		std::ostringstream name;
+		name << _path << "/" << _name << "_" << std::setw(5) << std::setfill('0') << number << ".png";
+		std::ofstream f(name.str().c_str(), std::ios::binary);
+		static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+		f.write(reinterpret_cast<const char *>(signature), 8);
+
+		std::vector<unsigned char> ihdr;
+		put32(ihdr, _width);
+		put32(ihdr, _height);
+		ihdr.push_back(8);
+		ihdr.push_back(2);
+		ihdr.push_back(0);
+		ihdr.push_back(0);
+		ihdr.push_back(0);
+		chunk(f, "IHDR", ihdr);
+
+		// Filter byte 0 and RGB for every row, top row first.
+		std::size_t stride = 1 + _width * 3;
+		std::vector<unsigned char> raw(stride * _height);
+		for (int y = 0; y < _height; y++)
+		{
+			unsigned char * row = &raw[y * stride];
+			const unsigned char * src = &rgba[(_height - 1 - y) * _width * 4];
+			row[0] = 0;
+			for (int x = 0; x < _width; x++)
+			{
+				memcpy(&row[1 + x * 3], &src[x * 4], 3);
+			}
+		}
+
+		scratch.clear();
+		scratch.push_back(0x78);
+		scratch.push_back(0x01);
+		for (std::size_t offset = 0; offset < raw.size(); offset += 65535)
+		{
+			std::size_t length = std::min<std::size_t>(65535, raw.size() - offset);
+			scratch.push_back(offset + length == raw.size());
+			scratch.push_back(length);
+			scratch.push_back(length >> 8);
+			scratch.push_back(~length);
+			scratch.push_back(~length >> 8);
+			scratch.insert(scratch.end(), raw.begin() + offset, raw.begin() + offset + length);
+		}
+		put32(scratch, adler32(raw.data(), raw.size()));
+		chunk(f, "IDAT", scratch);
+		chunk(f, "IEND", std::vector<unsigned char>());
+		if (!f)
+		{
+			std::cerr << name.str() << ": could not be written" << std::endl;
+			_failed++;
+		}
+	}
+
+	// BT.601 limited range, chroma averaged over 2x2 pixels.
+	void writeY4M(const unsigned char * rgba, std::vector<unsigned char>& yuv)
+	{
+		int cw = (_width + 1) / 2;
+		int ch = (_height + 1) / 2;
+		yuv.resize(_width * _height + 2 * cw * ch);
+		unsigned char * Y = &yuv[0];
+		unsigned char * U = Y + _width * _height;
+		unsigned char * V = U + cw * ch;
+		for (int y = 0; y < _height; y++)
+		{
+			const unsigned char * src = &rgba[(_height - 1 - y) * _width * 4];
+			for (int x = 0; x < _width; x++)
+			{
+				int r = src[x * 4], g = src[x * 4 + 1], b = src[x * 4 + 2];
+				Y[y * _width + x] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+			}
+		}
+		for (int cy = 0; cy < ch; cy++)
+		{
+			int y0 = _height - 1 - 2 * cy;
+			int y1 = y0 > 0 ? y0 - 1 : y0;
+			for (int cx = 0; cx < cw; cx++)
+			{
+				int x0 = 2 * cx;
+				int x1 = x0 + 1 < _width ? x0 + 1 : x0;
+				int r = 0, g = 0, b = 0;
+				const int p[4] = {y0 * _width + x0, y0 * _width + x1, y1 * _width + x0, y1 * _width + x1};
+				for (int i = 0; i < 4; i++)
+				{
+					r += rgba[p[i] * 4];
+					g += rgba[p[i] * 4 + 1];
+					b += rgba[p[i] * 4 + 2];
+				}
+				U[cy * cw + cx] = ((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128;
+				V[cy * cw + cx] = ((112 * r - 94 * g - 18 * b + 512) >> 10) + 128;
+			}
+		}
+		_video << "FRAME\n";
+		_video.write(reinterpret_cast<const char *>(&yuv[0]), yuv.size());
+		if (!_video)
+		{
+			std::cerr << _path << ": could not be written" << std::endl;
+			_failed++;
+		}
+	}
+
+	void encode()
+	{
+		std::vector<unsigned char> scratch;
+		for (;;)
+		{
+			Frame frame;
+			if (!_ready.pop(frame))
+			{
+				if (_stop.load(std::memory_order_acquire) && _ready.size() == 0)
+				{
+					return;
+				}
+				std::this_thread::sleep_for(std::chrono::microseconds(500));
+				continue;
+			}
+			Clock::time_point t0 = Clock::now();
+			const unsigned char * rgba = &_buffers[frame.buffer][0];
+			if (_y4m)
+			{
+				writeY4M(rgba, scratch);
+			}
+			else
+			{
+				writePNG(frame.number, rgba, scratch);
+			}
+			_encodeTime += milliseconds(t0, Clock::now());
+			while (!_free.push(frame.buffer))
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// Copy the oldest readback into a free buffer and queue it for the
+	// encoder. With wait false it returns false instead of stalling if the
+	// GPU has not finished the readback yet.
+	bool retire(bool wait)
+	{
+		return _readback.retire(wait, [this](const void * rgba, int number)
+		{
+			// The encoder is behind: waiting here keeps every frame, dropping
+			// would keep the frame rate.
+			int buffer;
+			if (!_free.pop(buffer))
+			{
+				_encoderStalls++;
+				while (!_free.pop(buffer))
+				{
+					std::this_thread::yield();
+				}
+			}
+			if (rgba != NULL)
+			{
+				memcpy(&_buffers[buffer][0], rgba, _width * _height * 4);
+				Frame frame = {buffer, number};
+				_ready.push(frame);
+			}
+			else
+			{
+				_failed++;
+				_free.push(buffer);
+			}
+		});
+	}
+
+	void start()
+	{
+		if (_y4m)
+		{
+			_video.open(_path.c_str(), std::ios::binary);
+			_video << "YUV4MPEG2 W" << _width << " H" << _height << " F" << _fps << ":1 Ip A1:1 C420jpeg\n";
+			if (!_video)
+			{
+				std::cerr << _path << ": could not be opened" << std::endl;
+				_failed++;
+			}
+		}
+		else
+		{
+			std::error_code error;
+			std::filesystem::create_directories(_path, error);
+		}
+		for (int i = 0; i < BUFFERS; i++)
+		{
+			_buffers[i].resize(_width * _height * 4);
+			_free.push(i);
+		}
+		_encoder = std::thread(&FrameRecorder::encode, this);
+	}
+public:
+	FrameRecorder(int argc, char** argv, const char * name, int width, int height)
+		: _name(name), _width(width), _height(height), _frames(0), _fps(60), _y4m(false),
+		_readback(GL_RGBA, GL_UNSIGNED_BYTE, 4), _stop(false), _failed(0),
+		_recordTime(0), _recordMax(0), _frameTime(0), _encoderStalls(0), _encodeTime(0)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool value = i + 1 < argc;
+			if (arg == "--record" && value)
+			{
+				_path = argv[++i];
+			}
+			else if (arg == "--record-frames" && value)
+			{
+				_frames = atoi(argv[++i]);
+			}
+			else if (arg == "--fps" && value)
+			{
+				_fps = atoi(argv[++i]);
+			}
+		}
+		_y4m = _path.size() > 4 && _path.compare(_path.size() - 4, 4, ".y4m") == 0;
+	}
+	~FrameRecorder()
+	{
+		if (_encoder.joinable())
+		{
+			_stop.store(true, std::memory_order_release);
+			_encoder.join();
+		}
+	}
+	bool enabled() const
+	{
+		return !_path.empty();
+	}
+	bool done() const
+	{
+		return enabled() && _frames > 0 && _readback.submitted() >= _frames;
+	}
+	// Call after drawing a frame and before swapping buffers.
+	void frame()
+	{
+		if (!enabled() || done())
+		{
+			return;
+		}
+		Clock::time_point t0 = Clock::now();
+		if (_readback.submitted() == 0)
+		{
+			start();
+		}
+		else
+		{
+			_frameTime += milliseconds(_last, t0);
+		}
+		_last = t0;
+
+		while (retire(_readback.submitted() - _readback.retired() == RING))
+		{}
+		_readback.submit(_width, _height);
+
+		double t = milliseconds(t0, Clock::now());
+		_recordTime += t;
+		_recordMax = std::max(_recordMax, t);
+	}
+	// Write the frames still in flight and print the report. Returns the
+	// process exit code: 0 if every frame was written.
+	int finish()
+	{
+		int submitted = _readback.submitted();
+		if (!enabled() || submitted == 0)
+		{
+			return 0;
+		}
+		while (retire(true))
+		{}
+		_stop.store(true, std::memory_order_release);
+		_encoder.join();
+		_video.close();
+		int retired = _readback.retired();
+		int gpuStalls = _readback.stalls();
+		_readback.destroy();
+
+		double record = _recordTime / submitted;
+		std::cout << std::setprecision(3) << std::fixed
+			<< _name << ": recorded " << retired << " frames to " << _path << std::endl
+			<< "render thread ms/frame: mean " << record << "  max " << _recordMax;
+		if (submitted > 1)
+		{
+			double frame = _frameTime / (submitted - 1);
+			std::cout << "  (" << 100.0 * record / frame << "% of " << frame << " ms frames)";
+		}
+		std::cout << std::endl
+			<< "encoder ms/frame: " << _encodeTime / retired
+			<< "  gpu stalls " << gpuStalls << "  encoder stalls " << _encoderStalls << std::endl;
+		std::cout.unsetf(std::ios::floatfield);
+		return _failed == 0 ? 0 : 1;
+	}
+};
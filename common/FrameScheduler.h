@@ -0,0 +1,364 @@
+#pragma once
+
+// Frame pacing for the examples, replacing a loop that polls and swaps as
+// fast as it can.
+//
+//   vsync    swap interval 1, the driver blocks in the swap
+//   fixed    swap interval 0, frames start on a deadline every 1/rate
+//            seconds: the thread sleeps in glfwWaitEventsTimeout until
+//            shortly before it, then spins the last stretch, since sleeps
+//            overshoot by up to a scheduler tick
+//   demand   sleeps in glfwWaitEvents and renders only after input, a
+//            resize or invalidate(), for tools and static scenes
+//
+// A frame is
+//
+//   while (scheduler.wait())
+//   {
+//       ... update from input, draw ...
+//       scheduler.present();
+//   }
+//
+// wait() returns after polling events, as late as the mode allows: in fixed
+// mode it wakes the measured render time before the deadline instead of at
+// the start of the frame. sample() polls again, for an example that wants to
+// read input right before drawing after a long update. present() swaps, and
+// in fixed mode or with --low-latency waits with glFinish until the frame is
+// on its way. The driver then cannot queue frames ahead and add their
+// latency to the next input, and fixed mode measures the whole render time
+// it wakes ahead of the deadline, at the cost of the CPU and GPU no longer
+// overlapping across frames.
+//
+// Input latency is measured from the moment GLFW hands the first key,
+// button, cursor or scroll event of a frame to the scheduler to the return
+// of present(). The scheduler installs its callbacks on the window and
+// calls the ones installed before it; it uses the window user pointer.
+// destroy() puts the previous callbacks back and must be called before the
+// window is destroyed.
+//
+//   --pacing MODE    vsync, fixed or demand (default: chosen by the example)
+//   --rate HZ        frame rate of fixed pacing (default 60)
+//   --low-latency    glFinish after every swap in any mode
+
+#include "GL.h"
+#include "Window.h"
+
+#include <string>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+
+
+class FrameScheduler
+{
+public:
+	enum Mode
+	{
+		VSYNC,
+		FIXED,
+		ON_DEMAND
+	};
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	GLFWwindow * _window;
+	Mode _mode;
+	bool _finish;
+	Clock::duration _period;
+	// Closer than this to a deadline the thread spins instead of sleeping.
+	Clock::duration _spin;
+	Clock::time_point _deadline;
+	// Running average of the time from wait() returning to present().
+	Clock::duration _render;
+	Clock::time_point _start;
+	std::atomic<bool> _dirty;
+
+	// Earliest input not yet sampled, and earliest input of this frame.
+	bool _pending;
+	Clock::time_point _input;
+	bool _sampled;
+	Clock::time_point _sampledInput;
+
+	unsigned _frames;
+	unsigned _latencies;
+	double _latency;
+	double _intervals;
+	Clock::time_point _presented;
+
+	GLFWkeyfun _key;
+	GLFWmousebuttonfun _button;
+	GLFWcursorposfun _cursor;
+	GLFWscrollfun _scroll;
+	GLFWframebuffersizefun _resize;
+	GLFWwindowrefreshfun _refresh;
+
+	static FrameScheduler * self(GLFWwindow * window)
+	{
+		return static_cast<FrameScheduler *>(glfwGetWindowUserPointer(window));
+	}
+	void input()
+	{
+		if (!_pending)
+		{
+			_pending = true;
+			_input = Clock::now();
+		}
+		_dirty = true;
+	}
+	static void key(GLFWwindow * window, int key, int scancode, int action, int mods)
+	{
+		FrameScheduler * s = self(window);
+		s->input();
+		if (s->_key)
+		{
+			s->_key(window, key, scancode, action, mods);
+		}
+	}
+	static void button(GLFWwindow * window, int button, int action, int mods)
+	{
+		FrameScheduler * s = self(window);
+		s->input();
+		if (s->_button)
+		{
+			s->_button(window, button, action, mods);
+		}
+	}
+	static void cursor(GLFWwindow * window, double x, double y)
+	{
+		FrameScheduler * s = self(window);
+		s->input();
+		if (s->_cursor)
+		{
+			s->_cursor(window, x, y);
+		}
+	}
+	static void scroll(GLFWwindow * window, double x, double y)
+	{
+		FrameScheduler * s = self(window);
+		s->input();
+		if (s->_scroll)
+		{
+			s->_scroll(window, x, y);
+		}
+	}
+	static void resize(GLFWwindow * window, int width, int height)
+	{
+		FrameScheduler * s = self(window);
+		s->_dirty = true;
+		if (s->_resize)
+		{
+			s->_resize(window, width, height);
+		}
+	}
+	static void refresh(GLFWwindow * window)
+	{
+		FrameScheduler * s = self(window);
+		s->_dirty = true;
+		if (s->_refresh)
+		{
+			s->_refresh(window);
+		}
+	}
+	static double seconds(Clock::duration d)
+	{
+		return std::chrono::duration<double>(d).count();
+	}
+public:
+	// The window's context must be current.
+	FrameScheduler(int argc, char** argv, Window& window, Mode mode = VSYNC)
+		: FrameScheduler(argc, argv, window.handle(), mode)
+	{}
+	FrameScheduler(int argc, char** argv, GLFWwindow * window, Mode mode = VSYNC)
+		: _window(window), _mode(mode), _finish(false), _spin(std::chrono::microseconds(1500)),
+		_render(Clock::duration::zero()), _dirty(true), _pending(false), _sampled(false),
+		_frames(0), _latencies(0), _latency(0), _intervals(0)
+	{
+		double rate = 60;
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool value = i + 1 < argc;
+			if (arg == "--pacing" && value)
+			{
+				std::string name = argv[++i];
+				if (name == "vsync")
+				{
+					_mode = VSYNC;
+				}
+				else if (name == "fixed")
+				{
+					_mode = FIXED;
+				}
+				else if (name == "demand")
+				{
+					_mode = ON_DEMAND;
+				}
+				else
+				{
+					throw 0;
+				}
+			}
+			else if (arg == "--rate" && value)
+			{
+				rate = atof(argv[++i]);
+			}
+			else if (arg == "--low-latency")
+			{
+				_finish = true;
+			}
+		}
+		if (rate <= 0)
+		{
+			throw 0;
+		}
+		_period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+		glfwSwapInterval(_mode == FIXED ? 0 : 1);
+		_finish = _finish || _mode == FIXED;
+
+		glfwSetWindowUserPointer(_window, this);
+		_key = glfwSetKeyCallback(_window, key);
+		_button = glfwSetMouseButtonCallback(_window, button);
+		_cursor = glfwSetCursorPosCallback(_window, cursor);
+		_scroll = glfwSetScrollCallback(_window, scroll);
+		_resize = glfwSetFramebufferSizeCallback(_window, resize);
+		_refresh = glfwSetWindowRefreshCallback(_window, refresh);
+
+		_deadline = Clock::now() + _period;
+		_presented = Clock::now();
+	}
+	FrameScheduler(const FrameScheduler&) = delete;
+	FrameScheduler& operator=(const FrameScheduler&) = delete;
+	~FrameScheduler()
+	{
+		destroy();
+	}
+	void destroy()
+	{
+		if (_window == NULL)
+		{
+			return;
+		}
+		glfwSetKeyCallback(_window, _key);
+		glfwSetMouseButtonCallback(_window, _button);
+		glfwSetCursorPosCallback(_window, _cursor);
+		glfwSetScrollCallback(_window, _scroll);
+		glfwSetFramebufferSizeCallback(_window, _resize);
+		glfwSetWindowRefreshCallback(_window, _refresh);
+		glfwSetWindowUserPointer(_window, NULL);
+		_window = NULL;
+	}
+	Mode mode() const
+	{
+		return _mode;
+	}
+	// Blocks until the next frame should start. False once the window is
+	// closing.
+	bool wait()
+	{
+		switch (_mode)
+		{
+		case VSYNC:
+			break;
+		case FIXED:
+		{
+			Clock::time_point wake = _deadline - _render;
+			Clock::time_point now = Clock::now();
+			while (now + _spin < wake && !glfwWindowShouldClose(_window))
+			{
+				glfwWaitEventsTimeout(seconds(wake - _spin - now));
+				now = Clock::now();
+			}
+			while (Clock::now() < wake)
+			{
+				std::this_thread::yield();
+			}
+			break;
+		}
+		case ON_DEMAND:
+			while (!_dirty && !glfwWindowShouldClose(_window))
+			{
+				glfwWaitEvents();
+			}
+			break;
+		}
+		_dirty = false;
+		sample();
+		_start = Clock::now();
+		return !glfwWindowShouldClose(_window);
+	}
+	// Polls events; input from here on counts towards the next frame.
+	void sample()
+	{
+		glfwPollEvents();
+		if (_pending && !_sampled)
+		{
+			_sampled = true;
+			_sampledInput = _input;
+		}
+		_pending = false;
+	}
+	void present()
+	{
+		glfwSwapBuffers(_window);
+		if (_finish)
+		{
+			glFinish();
+		}
+		Clock::time_point now = Clock::now();
+		if (_sampled)
+		{
+			_latency += seconds(now - _sampledInput);
+			_latencies++;
+			_sampled = false;
+		}
+		_intervals += seconds(now - _presented);
+		_presented = now;
+		_frames++;
+		// Weighted to adapt within a few frames when the scene changes.
+		_render = (_render * 7 + (now - _start)) / 8;
+		if (_mode == FIXED)
+		{
+			_deadline += _period;
+			// A missed deadline restarts the schedule instead of rushing
+			// frames out to catch up.
+			if (_deadline < now)
+			{
+				_deadline = now + _period;
+			}
+		}
+	}
+	// Requests a frame in demand mode, from any thread.
+	void invalidate()
+	{
+		_dirty = true;
+		glfwPostEmptyEvent();
+	}
+	// Statistics since the last reset().
+	unsigned frames() const
+	{
+		return _frames;
+	}
+	// Milliseconds between presents.
+	double interval() const
+	{
+		return _frames ? _intervals * 1000.0 / _frames : 0.0;
+	}
+	// Milliseconds from input to present, over the frames that had input.
+	double latency() const
+	{
+		return _latencies ? _latency * 1000.0 / _latencies : 0.0;
+	}
+	unsigned inputFrames() const
+	{
+		return _latencies;
+	}
+	void reset()
+	{
+		_frames = 0;
+		_latencies = 0;
+		_latency = 0;
+		_intervals = 0;
+	}
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+// OpenGL and GLFW for all examples. With USE_GLEW the entry points are
+// loaded by GLEW, otherwise they are linked directly from the GL library.
+
+#ifdef USE_GLEW
+#include <GL/glew.h>
+#else
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#endif
+#include <GLFW/glfw3.h>
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "GL.h"
+#include "NamePool.h"
+
+
+// GPU time of a stretch of commands, from GL_TIME_ELAPSED queries in a ring
+// so reading a result never waits for the GPU. Wrap the work of a frame in
+// begin() and end(); collect() then picks up the results of earlier frames
+// that have arrived, oldest first, and leaves the rest for the next frame.
+// A frame that finds every query still in flight is not timed, and neither
+// is the first: it pays for first use, and llvmpipe reports nonsense for it.
+class GpuTimer
+{
+	static const int RING = 4;
+	Name<QueryObjects> _queries[RING];
+	unsigned long _begun;
+	unsigned long _read;
+	bool _active;
+	double _total;
+	unsigned long _samples;
+public:
+	GpuTimer() : _begun(0), _read(0), _active(false), _total(0), _samples(0)
+	{}
+	void begin()
+	{
+		_active = _begun - _read < RING;
+		if (_active)
+		{
+			glBeginQuery(GL_TIME_ELAPSED, _queries[_begun % RING].id());
+		}
+	}
+	void end()
+	{
+		if (_active)
+		{
+			glEndQuery(GL_TIME_ELAPSED);
+			_begun++;
+			_active = false;
+		}
+	}
+	void collect()
+	{
+		while (_read < _begun)
+		{
+			GLuint query = _queries[_read % RING].id();
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+			{
+				break;
+			}
+			GLuint64 elapsed;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			if (_read > 0)
+			{
+				_total += elapsed * 1e-6;
+				_samples++;
+			}
+			_read++;
+		}
+	}
+	// Mean in milliseconds of the results collected since the last call.
+	double mean()
+	{
+		double ms = _samples > 0 ? _total / _samples : 0;
+		_total = 0;
+		_samples = 0;
+		return ms;
+	}
+	// Releases the queries early, for timers that outlive the context.
+	void destroy()
+	{
+		for (int i = 0; i < RING; i++)
+		{
+			_queries[i].reset();
+		}
+	}
+};
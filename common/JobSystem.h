@@ -0,0 +1,493 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+struct Job;
+typedef void (*JobFunction)(Job *, const void *);
+
+// A unit of work. Jobs are two cache lines, aligned, and carry their
+// arguments inline, so creating one never touches the heap.
+struct alignas(64) Job
+{
+	JobFunction function;
+	Job * parent;
+	std::atomic<int32_t> unfinished;
+	char data[128 - sizeof(JobFunction) - sizeof(Job *) - sizeof(std::atomic<int32_t>)];
+};
+
+
+// Chase-Lev work-stealing deque. The owning worker pushes and pops at the
+// bottom, any other worker steals from the top.
+template <std::size_t SIZE>
+class WorkStealingDeque
+{
+private:
+	static const std::size_t MASK = SIZE - 1;
+	static_assert((SIZE & MASK) == 0, "size must be a power of two");
+	alignas(64) std::atomic<int64_t> _top;
+	alignas(64) std::atomic<int64_t> _bottom;
+	std::atomic<Job *> _jobs[SIZE];
+public:
+	WorkStealingDeque() : _top(0), _bottom(0)
+	{}
+	// False if the deque is full.
+	bool push(Job * job)
+	{
+		int64_t b = _bottom.load(std::memory_order_relaxed);
+		if (b - _top.load(std::memory_order_acquire) >= int64_t(SIZE))
+		{
+			return false;
+		}
+		_jobs[b & MASK].store(job, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		_bottom.store(b + 1, std::memory_order_relaxed);
+		return true;
+	}
+	Job * pop()
+	{
+		int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+		_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = _top.load(std::memory_order_relaxed);
+		if (t > b)
+		{
+			_bottom.store(b + 1, std::memory_order_relaxed);
+			return NULL;
+		}
+		Job * job = _jobs[b & MASK].load(std::memory_order_relaxed);
+		if (t == b)
+		{
+			// Last job, race against thieves for it.
+			if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				job = NULL;
+			}
+			_bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+	Job * steal()
+	{
+		int64_t t = _top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = _bottom.load(std::memory_order_acquire);
+		if (t >= b)
+		{
+			return NULL;
+		}
+		Job * job = _jobs[t & MASK].load(std::memory_order_relaxed);
+		if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return NULL;
+		}
+		return job;
+	}
+};
+
+
+// Work-stealing job scheduler. The thread that constructs it becomes worker
+// 0 and helps executing jobs whenever it waits; the remaining workers run on
+// their own threads. Every worker allocates jobs from its own ring of
+// blocks of POOL_SIZE jobs. A job in flight is skipped when the ring wraps
+// around to it, and if the next few are in flight too the ring grows by a
+// block. A job run while the worker's deque is full executes right away.
+//
+// Other threads may use the system too. Their jobs come from a ring shared
+// between them and go into an injection queue that workers take from when
+// their own deque is empty; both are behind a mutex.
+//
+// A thread that finds no job yields and tries again up to SPIN times, then
+// sleeps until a job is run or the job it waits for has finished.
+class JobSystem
+{
+public:
+	static const std::size_t POOL_SIZE = 8192;
+	static const unsigned SPIN = 64;
+private:
+	// Busy slots tried before the ring grows.
+	static const std::size_t PROBES = 16;
+	struct Worker
+	{
+		WorkStealingDeque<POOL_SIZE> deque;
+		std::vector<Job *> blocks;
+		std::size_t allocated;
+		uint32_t random;
+
+		Worker(uint32_t seed) : allocated(0), random(seed)
+		{
+			blocks.push_back(new Job[POOL_SIZE]());
+		}
+		~Worker()
+		{
+			for (std::size_t i = 0; i < blocks.size(); i++)
+			{
+				delete[] blocks[i];
+			}
+		}
+		Job * allocate()
+		{
+			for (std::size_t i = 0; i < PROBES; i++)
+			{
+				Job * job = &blocks[allocated / POOL_SIZE][allocated % POOL_SIZE];
+				allocated = (allocated + 1) % (blocks.size() * POOL_SIZE);
+				if (job->unfinished.load(std::memory_order_acquire) <= 0)
+				{
+					return job;
+				}
+			}
+			blocks.push_back(new Job[POOL_SIZE]());
+			allocated = (blocks.size() - 1) * POOL_SIZE + 1;
+			return &blocks.back()[0];
+		}
+	};
+	std::vector<Worker *> _workers;
+	std::vector<std::thread> _threads;
+	std::atomic<bool> _running;
+	// Idle workers sleep on _idle, threads in wait() on _blocked.
+	std::mutex _mutex;
+	std::condition_variable _idle;
+	std::condition_variable _blocked;
+	std::atomic<unsigned> _sleeping;
+	std::atomic<unsigned> _waiting;
+	// Jobs of threads that are not workers.
+	std::mutex _injection;
+	Worker * _external;
+	std::deque<Job *> _injected;
+	std::atomic<std::size_t> _pending;
+
+	// The system the calling thread is a worker of, and its index there.
+	static inline thread_local const JobSystem * _owner = NULL;
+	static inline thread_local unsigned _index = 0;
+
+	bool external() const
+	{
+		return _owner != this;
+	}
+	Worker& worker()
+	{
+		return *_workers[_index];
+	}
+	Job * take()
+	{
+		if (_pending.load(std::memory_order_seq_cst) == 0)
+		{
+			return NULL;
+		}
+		std::lock_guard<std::mutex> lock(_injection);
+		if (_injected.empty())
+		{
+			return NULL;
+		}
+		Job * job = _injected.front();
+		_injected.pop_front();
+		_pending.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+	Job * get()
+	{
+		if (external())
+		{
+			Job * job = take();
+			return job != NULL ? job : scan();
+		}
+		Worker& self = worker();
+		Job * job = self.deque.pop();
+		if (job == NULL)
+		{
+			job = take();
+		}
+		if (job != NULL || _workers.size() == 1)
+		{
+			return job;
+		}
+		// xorshift picks the victim, so workers do not gang up on one deque.
+		self.random ^= self.random << 13;
+		self.random ^= self.random >> 17;
+		self.random ^= self.random << 5;
+		unsigned victim = self.random % _workers.size();
+		if (victim == _index)
+		{
+			return NULL;
+		}
+		return _workers[victim]->deque.steal();
+	}
+	// Tries every other worker once, before going to sleep.
+	Job * scan()
+	{
+		std::size_t n = _workers.size();
+		std::size_t first = external() ? 0 : _index + 1;
+		std::size_t others = external() ? n : n - 1;
+		for (std::size_t i = 0; i < others; i++)
+		{
+			Job * job = _workers[(first + i) % n]->deque.steal();
+			if (job != NULL)
+			{
+				return job;
+			}
+		}
+		return NULL;
+	}
+	// Sleepers register before they look for work a last time, while run()
+	// and finish() look for sleepers after publishing theirs. With both
+	// sequentially consistent, either the sleeper sees the job or the other
+	// side sees the sleeper and wakes it, under the mutex it waits on.
+	// Finishing a job only wakes threads in wait().
+	void wake(std::condition_variable& sleepers, bool all)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (all)
+		{
+			sleepers.notify_all();
+		}
+		else
+		{
+			sleepers.notify_one();
+		}
+	}
+	// Sleeps until there is a job to take, which it returns, or waiting has
+	// finished or the system is shutting down.
+	Job * sleep(const Job * waiting)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		std::atomic<unsigned>& sleepers = waiting != NULL ? _waiting : _sleeping;
+		std::condition_variable& condition = waiting != NULL ? _blocked : _idle;
+		sleepers.fetch_add(1, std::memory_order_seq_cst);
+		Job * job = NULL;
+		while (_running.load(std::memory_order_seq_cst)
+			&& (waiting == NULL || waiting->unfinished.load(std::memory_order_seq_cst) > 0)
+			&& (job = take()) == NULL && (job = scan()) == NULL
+			&& (external() || (job = worker().deque.pop()) == NULL))
+		{
+			condition.wait(lock);
+		}
+		sleepers.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+	// Executes a job if there is one; otherwise yields, or sleeps once tries
+	// reaches SPIN.
+	void help(unsigned& tries, const Job * waiting)
+	{
+		Job * job = get();
+		if (job == NULL && ++tries >= SPIN)
+		{
+			job = sleep(waiting);
+		}
+		if (job != NULL)
+		{
+			execute(job);
+			tries = 0;
+		}
+		else if (tries < SPIN)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			tries = 0;
+		}
+	}
+	void finish(Job * job)
+	{
+		Job * parent = job->parent;
+		if (job->unfinished.fetch_sub(1, std::memory_order_seq_cst) == 1)
+		{
+			if (_waiting.load(std::memory_order_seq_cst) > 0)
+			{
+				wake(_blocked, true);
+			}
+			if (parent != NULL)
+			{
+				finish(parent);
+			}
+		}
+	}
+	void execute(Job * job)
+	{
+		job->function(job, job->data);
+		finish(job);
+	}
+	void loop(unsigned index)
+	{
+		_owner = this;
+		_index = index;
+		unsigned tries = 0;
+		while (_running.load(std::memory_order_relaxed))
+		{
+			help(tries, NULL);
+		}
+	}
+	static void empty(Job *, const void *)
+	{}
+public:
+	JobSystem(unsigned threads) : _running(true), _sleeping(0), _waiting(0), _external(new Worker(0)), _pending(0)
+	{
+		if (threads == 0)
+		{
+			threads = 1;
+		}
+		for (unsigned i = 0; i < threads; i++)
+		{
+			_workers.push_back(new Worker(2463534242u + i));
+		}
+		_owner = this;
+		_index = 0;
+		for (unsigned i = 1; i < threads; i++)
+		{
+			_threads.push_back(std::thread(&JobSystem::loop, this, i));
+		}
+	}
+	~JobSystem()
+	{
+		_running.store(false);
+		wake(_idle, true);
+		for (std::size_t i = 0; i < _threads.size(); i++)
+		{
+			_threads[i].join();
+		}
+		for (std::size_t i = 0; i < _workers.size(); i++)
+		{
+			delete _workers[i];
+		}
+		delete _external;
+		if (_owner == this)
+		{
+			_owner = NULL;
+		}
+	}
+	unsigned size() const
+	{
+		return _workers.size();
+	}
+	// The calling worker in [0, size()), or size() on other threads, so
+	// per-worker data can have one extra slot for them.
+	unsigned index() const
+	{
+		return external() ? size() : _index;
+	}
+	// Create a job that runs function with a copy of size bytes of data.
+	// The parent, if any, is not finished until this job is.
+	Job * create(JobFunction function, Job * parent = NULL, const void * data = NULL, std::size_t size = 0)
+	{
+		if (size > sizeof(Job::data))
+		{
+			throw 0;
+		}
+		std::unique_lock<std::mutex> lock(_injection, std::defer_lock);
+		if (external())
+		{
+			lock.lock();
+		}
+		Job * job = external() ? _external->allocate() : worker().allocate();
+		job->function = function;
+		job->parent = parent;
+		job->unfinished.store(1, std::memory_order_relaxed);
+		if (parent != NULL)
+		{
+			parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (size > 0)
+		{
+			memcpy(job->data, data, size);
+		}
+		return job;
+	}
+	template <typename T>
+	Job * create(JobFunction function, Job * parent, const T& data)
+	{
+		static_assert(sizeof(T) <= sizeof(Job::data), "job data too large");
+		return create(function, parent, &data, sizeof(T));
+	}
+	// A job that does nothing, used to group children under one parent.
+	Job * group()
+	{
+		return create(empty);
+	}
+	void run(Job * job)
+	{
+		if (external())
+		{
+			std::lock_guard<std::mutex> lock(_injection);
+			_injected.push_back(job);
+			_pending.fetch_add(1, std::memory_order_seq_cst);
+		}
+		else if (!worker().deque.push(job))
+		{
+			execute(job);
+			return;
+		}
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (_sleeping.load(std::memory_order_seq_cst) > 0)
+		{
+			wake(_idle, false);
+		}
+		else if (_waiting.load(std::memory_order_seq_cst) > 0)
+		{
+			wake(_blocked, false);
+		}
+	}
+	// Execute other jobs until job and all of its children have finished.
+	void wait(const Job * job)
+	{
+		unsigned tries = 0;
+		while (job->unfinished.load(std::memory_order_acquire) > 0)
+		{
+			help(tries, job);
+		}
+	}
+
+	typedef void (*RangeFunction)(std::size_t begin, std::size_t end, void * context);
+private:
+	struct Range
+	{
+		JobSystem * system;
+		RangeFunction function;
+		void * context;
+		std::size_t begin;
+		std::size_t end;
+		std::size_t grain;
+	};
+	static_assert(sizeof(Range) <= sizeof(Job::data), "range too large");
+
+	// Halve the range until it fits the grain, leaving the halves to be
+	// stolen. Splitting lazily keeps the number of live jobs logarithmic.
+	static void split(Job * job, const void * data)
+	{
+		Range range = *static_cast<const Range *>(data);
+		while (range.end - range.begin > range.grain)
+		{
+			std::size_t middle = range.begin + (range.end - range.begin) / 2;
+			Range right = range;
+			right.begin = middle;
+			range.end = middle;
+			range.system->run(range.system->create(split, job, right));
+		}
+		range.function(range.begin, range.end, range.context);
+	}
+public:
+	// Call function on [0, count) in chunks of grain items. A grain of 0
+	// picks one that gives every worker about eight chunks.
+	void parallel_for(std::size_t count, RangeFunction function, void * context, std::size_t grain = 0)
+	{
+		if (grain == 0)
+		{
+			grain = count / (size() * 8);
+			if (grain == 0)
+			{
+				grain = 1;
+			}
+		}
+		Range range = {this, function, context, 0, count, grain};
+		Job * job = create(split, NULL, range);
+		run(job);
+		wait(job);
+	}
+};
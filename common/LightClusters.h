@@ -0,0 +1,276 @@
+#pragma once
+
+#include <xmmintrin.h>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+
+// A point light as the shaders read it from a std430 buffer: view space
+// position and radius of influence, then color and intensity.
+struct PointLight
+{
+	float x, y, z, radius;
+	float r, g, b, intensity;
+};
+
+
+// Splits the view frustum of Matrix4f::perspective(n, f, r, t) into X * Y
+// screen tiles and Z depth slices, spaced exponentially so clusters stay
+// roughly cubic, and lists the lights touching every cluster. The result is
+// a grid of (offset, count) pairs into one index list, which is the layout
+// the fragment shader reads: a pixel only loops over the lights of its own
+// cluster.
+//
+// assign() works on four lights at a time: their screen and depth ranges
+// are computed in SSE registers, then every candidate row of clusters is
+// tested four tiles at a time against the light's sphere.
+class LightClusters
+{
+public:
+	static const int X = 16;
+	static const int Y = 9;
+	static const int Z = 24;
+	static const int COUNT = X * Y * Z;
+	// Light indices are packed with the cluster into 32 bits.
+	static const uint32_t MAX_LIGHTS = 1 << 20;
+private:
+	float _near;
+	float _far;
+	float _right;
+	float _top;
+	float _scale;
+	float _depth[Z + 1];
+	// Conservative view space bounds of every cluster. x depends on slice
+	// and column, y on slice and row, z on the slice only.
+	alignas(16) float _minX[Z][X];
+	alignas(16) float _maxX[Z][X];
+	float _minY[Z][Y];
+	float _maxY[Z][Y];
+	std::vector<uint32_t> _grid;
+	std::vector<uint32_t> _indices;
+	std::vector<uint32_t> _pairs;
+	std::vector<uint32_t> _cursor;
+
+	static int tile(float ndc, int tiles)
+	{
+		int t = int(std::floor((ndc + 1.0f) * 0.5f * tiles));
+		return std::min(std::max(t, 0), tiles - 1);
+	}
+	int slice(float depth) const
+	{
+		if (depth <= _near)
+		{
+			return 0;
+		}
+		return std::min(int(std::log(depth / _near) * _scale), Z - 1);
+	}
+	// Smallest and largest ndc coordinate of [lo, hi] over the depth range
+	// [dn, df] of a frustum with half extent e at the near plane.
+	static void project(__m128 lo, __m128 hi, __m128 dn, __m128 df, float scale, __m128& ndcLo, __m128& ndcHi)
+	{
+		__m128 zero = _mm_setzero_ps();
+		__m128 s = _mm_set1_ps(scale);
+		__m128 loNear = _mm_div_ps(_mm_mul_ps(lo, s), dn);
+		__m128 loFar = _mm_div_ps(_mm_mul_ps(lo, s), df);
+		__m128 hiNear = _mm_div_ps(_mm_mul_ps(hi, s), dn);
+		__m128 hiFar = _mm_div_ps(_mm_mul_ps(hi, s), df);
+		__m128 negative = _mm_cmplt_ps(lo, zero);
+		ndcLo = _mm_or_ps(_mm_and_ps(negative, loNear), _mm_andnot_ps(negative, loFar));
+		__m128 positive = _mm_cmpgt_ps(hi, zero);
+		ndcHi = _mm_or_ps(_mm_and_ps(positive, hiNear), _mm_andnot_ps(positive, hiFar));
+	}
+	void add(uint32_t light, float cx, float cy, float cz, float radius, int i0, int i1, int j0, int j1, int k0, int k1)
+	{
+		float r2 = radius * radius;
+		__m128 x = _mm_set1_ps(cx);
+		__m128 zero = _mm_setzero_ps();
+		for (int k = k0; k <= k1; k++)
+		{
+			float dz = std::max(std::max(-_depth[k + 1] - cz, cz + _depth[k]), 0.0f);
+			for (int j = j0; j <= j1; j++)
+			{
+				float dy = std::max(std::max(_minY[k][j] - cy, cy - _maxY[k][j]), 0.0f);
+				float rest = r2 - dy * dy - dz * dz;
+				if (rest < 0)
+				{
+					continue;
+				}
+				__m128 limit = _mm_set1_ps(rest);
+				for (int i = i0 & ~3; i <= i1; i += 4)
+				{
+					__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(&_minX[k][i]), x), _mm_sub_ps(x, _mm_load_ps(&_maxX[k][i]))), zero);
+					int hits = _mm_movemask_ps(_mm_cmple_ps(_mm_mul_ps(dx, dx), limit));
+					for (int b = 0; b < 4; b++)
+					{
+						if ((hits & (1 << b)) && i + b >= i0 && i + b <= i1)
+						{
+							uint32_t cluster = (k * Y + j) * X + i + b;
+							_pairs.push_back((cluster << 20) | light);
+						}
+					}
+				}
+			}
+		}
+	}
+public:
+	// The parameters of Matrix4f::perspective: near and far distance, half
+	// width and half height of the near plane.
+	LightClusters(float n, float f, float r, float t)
+		: _near(n), _far(f), _right(r), _top(t), _grid(2 * COUNT), _cursor(COUNT)
+	{
+		_scale = Z / std::log(f / n);
+		for (int k = 0; k <= Z; k++)
+		{
+			_depth[k] = n * std::pow(f / n, float(k) / Z);
+		}
+		for (int k = 0; k < Z; k++)
+		{
+			float d0 = _depth[k] / n;
+			float d1 = _depth[k + 1] / n;
+			for (int i = 0; i < X; i++)
+			{
+				float e0 = (-1.0f + 2.0f * i / X) * r;
+				float e1 = (-1.0f + 2.0f * (i + 1) / X) * r;
+				_minX[k][i] = std::min(e0 * d0, e0 * d1);
+				_maxX[k][i] = std::max(e1 * d0, e1 * d1);
+			}
+			for (int j = 0; j < Y; j++)
+			{
+				float e0 = (-1.0f + 2.0f * j / Y) * t;
+				float e1 = (-1.0f + 2.0f * (j + 1) / Y) * t;
+				_minY[k][j] = std::min(e0 * d0, e0 * d1);
+				_maxY[k][j] = std::max(e1 * d0, e1 * d1);
+			}
+		}
+	}
+	// Z / log(f / n): slice = log(depth / n) * scale.
+	float scale() const
+	{
+		return _scale;
+	}
+	// lights are in view space, at most MAX_LIGHTS of them.
+	void assign(const PointLight * lights, std::size_t count)
+	{
+		_pairs.clear();
+		count = std::min<std::size_t>(count, MAX_LIGHTS);
+		for (std::size_t base = 0; base < count; base += 4)
+		{
+			alignas(16) float cx[4], cy[4], cz[4], cr[4];
+			for (int k = 0; k < 4; k++)
+			{
+				// Padding lanes sit behind the camera and are culled.
+				const PointLight * l = base + k < count ? &lights[base + k] : NULL;
+				cx[k] = l ? l->x : 0.0f;
+				cy[k] = l ? l->y : 0.0f;
+				cz[k] = l ? l->z : 1.0f;
+				cr[k] = l ? l->radius : 0.0f;
+			}
+			__m128 x = _mm_load_ps(cx);
+			__m128 y = _mm_load_ps(cy);
+			__m128 r = _mm_load_ps(cr);
+			__m128 depth = _mm_sub_ps(_mm_setzero_ps(), _mm_load_ps(cz));
+			__m128 dmin = _mm_sub_ps(depth, r);
+			__m128 dmax = _mm_add_ps(depth, r);
+			__m128 dn = _mm_max_ps(dmin, _mm_set1_ps(_near));
+			__m128 df = _mm_max_ps(_mm_min_ps(dmax, _mm_set1_ps(_far)), dn);
+			__m128 xLo, xHi, yLo, yHi;
+			project(_mm_sub_ps(x, r), _mm_add_ps(x, r), dn, df, _near / _right, xLo, xHi);
+			project(_mm_sub_ps(y, r), _mm_add_ps(y, r), dn, df, _near / _top, yLo, yHi);
+			__m128 one = _mm_set1_ps(1.0f);
+			__m128 minusOne = _mm_set1_ps(-1.0f);
+			__m128 visible = _mm_and_ps(_mm_cmpge_ps(dmax, _mm_set1_ps(_near)), _mm_cmple_ps(dmin, _mm_set1_ps(_far)));
+			visible = _mm_and_ps(visible, _mm_and_ps(_mm_cmple_ps(xLo, one), _mm_cmpge_ps(xHi, minusOne)));
+			visible = _mm_and_ps(visible, _mm_and_ps(_mm_cmple_ps(yLo, one), _mm_cmpge_ps(yHi, minusOne)));
+			int mask = _mm_movemask_ps(visible);
+			if (mask == 0)
+			{
+				continue;
+			}
+			alignas(16) float ndc[4][4], nearest[4], farthest[4];
+			_mm_store_ps(ndc[0], xLo);
+			_mm_store_ps(ndc[1], xHi);
+			_mm_store_ps(ndc[2], yLo);
+			_mm_store_ps(ndc[3], yHi);
+			_mm_store_ps(nearest, dn);
+			_mm_store_ps(farthest, df);
+			for (int k = 0; k < 4; k++)
+			{
+				if (mask & (1 << k))
+				{
+					add(uint32_t(base + k), cx[k], cy[k], cz[k], cr[k],
+						tile(ndc[0][k], X), tile(ndc[1][k], X), tile(ndc[2][k], Y), tile(ndc[3][k], Y),
+						slice(nearest[k]), slice(farthest[k]));
+				}
+			}
+		}
+
+		// Counting sort of the (cluster, light) pairs into the grid.
+		std::fill(_grid.begin(), _grid.end(), 0);
+		for (std::size_t p = 0; p < _pairs.size(); p++)
+		{
+			_grid[2 * (_pairs[p] >> 20) + 1]++;
+		}
+		uint32_t offset = 0;
+		for (int c = 0; c < COUNT; c++)
+		{
+			_grid[2 * c] = offset;
+			_cursor[c] = offset;
+			offset += _grid[2 * c + 1];
+		}
+		_indices.resize(std::max<std::size_t>(_pairs.size(), 1));
+		for (std::size_t p = 0; p < _pairs.size(); p++)
+		{
+			_indices[_cursor[_pairs[p] >> 20]++] = _pairs[p] & (MAX_LIGHTS - 1);
+		}
+	}
+	// (offset, count) per cluster, index (k * Y + j) * X + i.
+	const std::vector<uint32_t>& grid() const
+	{
+		return _grid;
+	}
+	const std::vector<uint32_t>& indices() const
+	{
+		return _indices;
+	}
+	std::size_t references() const
+	{
+		return _pairs.size();
+	}
+	uint32_t densest() const
+	{
+		uint32_t most = 0;
+		for (int c = 0; c < COUNT; c++)
+		{
+			most = std::max(most, _grid[2 * c + 1]);
+		}
+		return most;
+	}
+	// Minimum and maximum corner of every cluster as two vec4, for light
+	// assignment in a compute shader.
+	void bounds(std::vector<float>& result) const
+	{
+		result.resize(COUNT * 8);
+		for (int k = 0; k < Z; k++)
+		{
+			for (int j = 0; j < Y; j++)
+			{
+				for (int i = 0; i < X; i++)
+				{
+					float * b = &result[((k * Y + j) * X + i) * 8];
+					b[0] = _minX[k][i];
+					b[1] = _minY[k][j];
+					b[2] = -_depth[k + 1];
+					b[3] = 0;
+					b[4] = _maxX[k][i];
+					b[5] = _maxY[k][j];
+					b[6] = -_depth[k];
+					b[7] = 0;
+				}
+			}
+		}
+	}
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "Trig.h"
+#include "SimdTrig.h"
+
+#include <xmmintrin.h>
+
+#include <iostream>
+#include <iomanip>
+
+
+// Column-major 4x4 matrix, laid out as OpenGL expects it.
+class Matrix4f
+{
+public:
+	union
+	{
+		float _data[16];
+		struct{float c1[4], c2[4], c3[4], c4[4];};
+		struct{float e11,e21,e31,e41,e12,e22,e32,e42,e13,e23,e33,e43,e14,e24,e34,e44;};
+	};
+public:
+	constexpr Matrix4f() : _data{}
+	{}
+	// Everything but the SSE multiply and print is constexpr and only touches
+	// _data, the one union member a constant expression may use, so fixed
+	// projections and rest poses can be built at compile time:
+	//   static constexpr Matrix4f projection = [] { Matrix4f m; m.frustum(1, 200, 1, 1.2f); return m; }();
+	constexpr void frustum(float n, float f, float r, float t)
+	{
+		zero();
+		_data[0] = n / r;
+		_data[5] = n / t;
+		_data[10] = (f + n) / (n - f);
+		_data[11] = (2.0f * f * n) / (n - f);
+		_data[14] = -1.0f;
+	}
+	// glFrustum(-r, r, -t, t, n, f): clip w = -z. frustum() above keeps the
+	// depth terms swapped, which the cube shaders were written against.
+	constexpr void perspective(float n, float f, float r, float t)
+	{
+		zero();
+		_data[0] = n / r;
+		_data[5] = n / t;
+		_data[10] = (f + n) / (n - f);
+		_data[11] = -1.0f;
+		_data[14] = (2.0f * f * n) / (n - f);
+	}
+	constexpr void zero()
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			_data[i] = 0;
+		}
+	}
+	constexpr void translate(float t1, float t2, float t3)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			_data[12 + i] = (_data[i] * t1) + (_data[4 + i] * t2) + (_data[8 + i] * t3) + _data[12 + i];
+		}
+	}
+	constexpr void multiply(const Matrix4f& m)
+	{
+		float result[16] = {};
+		for (int c = 0; c < 4; c++) {
+			for (int r = 0; r < 4; r++) {
+				int index = c * 4 + r;
+				float total = 0;
+				for (int i = 0; i < 4; i++) {
+					int p = i * 4 + r;
+					int q = c * 4 + i;
+					total += m._data[p] * _data[q];
+				}
+				result[index] = total;
+			}
+		}
+		for (int i = 0; i < 16; i++) {
+			_data[i] = result[i];
+		}
+	}
+	// r = a * b, one column of r per linear combination of the columns of a.
+	static void multiply(const Matrix4f& a, const Matrix4f& b, Matrix4f& r)
+	{
+		__m128 a1 = _mm_loadu_ps(a.c1);
+		__m128 a2 = _mm_loadu_ps(a.c2);
+		__m128 a3 = _mm_loadu_ps(a.c3);
+		__m128 a4 = _mm_loadu_ps(a.c4);
+		for (int c = 0; c < 4; c++)
+		{
+			const float * col = &b._data[c * 4];
+			__m128 x = _mm_mul_ps(a1, _mm_set1_ps(col[0]));
+			x = _mm_add_ps(x, _mm_mul_ps(a2, _mm_set1_ps(col[1])));
+			x = _mm_add_ps(x, _mm_mul_ps(a3, _mm_set1_ps(col[2])));
+			x = _mm_add_ps(x, _mm_mul_ps(a4, _mm_set1_ps(col[3])));
+			_mm_storeu_ps(&r._data[c * 4], x);
+		}
+	}
+	constexpr void identity()
+	{
+		zero();
+		_data[0] = 1;
+		_data[5] = 1;
+		_data[10] = 1;
+		_data[15] = 1;
+	}
+	constexpr void scale(float a)
+	{
+		for (int i = 0; i < 12; i++)
+		{
+			_data[i] = _data[i] * a;
+		}
+	}
+	constexpr void rotateZ(float a)
+	{
+		rotateZ(Trig::sin(a), Trig::cos(a));
+	}
+	constexpr void rotateY(float a)
+	{
+		rotateY(Trig::sin(a), Trig::cos(a));
+	}
+	// Same rotations with sine and cosine from the SIMD kernels, e.g.
+	// m.rotateY<TRIG_MEDIUM>(a), for per-frame and per-instance work.
+	template <TrigPrecision PRECISION>
+	void rotateZ(float a)
+	{
+		float sinus, cosin;
+		SimdTrig<PRECISION>::sincos(a, sinus, cosin);
+		rotateZ(sinus, cosin);
+	}
+	template <TrigPrecision PRECISION>
+	void rotateY(float a)
+	{
+		float sinus, cosin;
+		SimdTrig<PRECISION>::sincos(a, sinus, cosin);
+		rotateY(sinus, cosin);
+	}
+	constexpr void rotateZ(float sinus, float cosin)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			float t1 = _data[i];
+			float t2 = _data[4 + i];
+			_data[i] = t1 * cosin - t2 * sinus;
+			_data[4 + i] = t1 * sinus + t2 * cosin;
+		}
+	}
+	constexpr void rotateY(float sinus, float cosin)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			float t1 = _data[i];
+			float t3 = _data[8 + i];
+			_data[i] = t1 * cosin - t3 * sinus;
+			_data[8 + i] = t1 * sinus + t3 * cosin;
+		}
+	}
+	void print() const
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				std::cout << std::setprecision(2) << _data[(c * 4) + r] << "\t";
+			}
+			std::cout << std::endl;
+		}
+	}
+};
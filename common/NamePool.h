@@ -0,0 +1,312 @@
+#pragma once
+
+#include "GL.h"
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+
+// How a kind of GL object is created and deleted in bulk. recycle says
+// whether a released name may be handed out again, which is only true for
+// objects whose state is fully replaced by their next user.
+struct BufferObjects
+{
+	static const GLsizei batch = 64;
+	static const bool recycle = true;
+	static void generate(GLsizei n, GLuint * ids)
+	{
+		glGenBuffers(n, ids);
+	}
+	static void remove(GLsizei n, const GLuint * ids)
+	{
+		glDeleteBuffers(n, ids);
+	}
+};
+
+struct VertexArrayObjects
+{
+	static const GLsizei batch = 16;
+	static const bool recycle = false;
+	static void generate(GLsizei n, GLuint * ids)
+	{
+		glGenVertexArrays(n, ids);
+	}
+	static void remove(GLsizei n, const GLuint * ids)
+	{
+		glDeleteVertexArrays(n, ids);
+	}
+};
+
+struct QueryObjects
+{
+	static const GLsizei batch = 16;
+	static const bool recycle = true;
+	static void generate(GLsizei n, GLuint * ids)
+	{
+		glGenQueries(n, ids);
+	}
+	static void remove(GLsizei n, const GLuint * ids)
+	{
+		glDeleteQueries(n, ids);
+	}
+};
+
+struct ProgramObjects
+{
+	static const GLsizei batch = 1;
+	static const bool recycle = false;
+	static void generate(GLsizei n, GLuint * ids)
+	{
+		for (GLsizei i = 0; i < n; i++)
+		{
+			ids[i] = glCreateProgram();
+		}
+	}
+	static void remove(GLsizei n, const GLuint * ids)
+	{
+		for (GLsizei i = 0; i < n; i++)
+		{
+			glDeleteProgram(ids[i]);
+		}
+	}
+};
+
+template <GLenum TYPE>
+struct ShaderObjects
+{
+	static const GLsizei batch = 1;
+	static const bool recycle = false;
+	static void generate(GLsizei n, GLuint * ids)
+	{
+		for (GLsizei i = 0; i < n; i++)
+		{
+			ids[i] = glCreateShader(TYPE);
+		}
+	}
+	static void remove(GLsizei n, const GLuint * ids)
+	{
+		for (GLsizei i = 0; i < n; i++)
+		{
+			glDeleteShader(ids[i]);
+		}
+	}
+};
+
+
+// Hands out GL names generated in batches, and takes them back when their
+// owner is destroyed. Released names are held until a fence inserted at the
+// end of the frame has signaled, so the GPU is done with them, and are then
+// either recycled or deleted in one call.
+//
+// One pool per object type is current at a time; it must be created after
+// and destroyed before the GL context. Without a current pool, Name creates
+// and deletes its name directly.
+template <typename OBJECT>
+class NamePool
+{
+public:
+	static const int FRAMES = 4;
+	static const std::size_t KEEP = 256;
+private:
+	struct Retired
+	{
+		GLsync fence;
+		std::vector<GLuint> names;
+	};
+	std::vector<GLuint> _free;
+	std::vector<GLuint> _released;
+	Retired _retired[FRAMES];
+	int _head;
+	int _count;
+	std::size_t _generated;
+	std::size_t _calls;
+	std::size_t _recycled;
+	static NamePool * _current;
+
+	void retire(Retired& r)
+	{
+		glDeleteSync(r.fence);
+		if (OBJECT::recycle)
+		{
+			_recycled += r.names.size();
+			_free.insert(_free.end(), r.names.begin(), r.names.end());
+		}
+		else if (!r.names.empty())
+		{
+			OBJECT::remove(r.names.size(), &r.names[0]);
+		}
+		r.names.clear();
+		if (_free.size() > KEEP * 2)
+		{
+			OBJECT::remove(_free.size() - KEEP, &_free[KEEP]);
+			_free.resize(KEEP);
+		}
+		_head = (_head + 1) % FRAMES;
+		_count--;
+	}
+public:
+	NamePool() : _head(0), _count(0), _generated(0), _calls(0), _recycled(0)
+	{
+		_current = this;
+	}
+	~NamePool()
+	{
+		while (_count > 0)
+		{
+			glClientWaitSync(_retired[_head].fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			retire(_retired[_head]);
+		}
+		_free.insert(_free.end(), _released.begin(), _released.end());
+		if (!_free.empty())
+		{
+			OBJECT::remove(_free.size(), &_free[0]);
+		}
+		_current = NULL;
+	}
+	NamePool(const NamePool&) = delete;
+	NamePool& operator=(const NamePool&) = delete;
+
+	// The current pool, NULL if there is none.
+	static NamePool * current()
+	{
+		return _current;
+	}
+	GLuint acquire()
+	{
+		if (_free.empty())
+		{
+			std::size_t n = _free.size();
+			_free.resize(n + OBJECT::batch);
+			OBJECT::generate(OBJECT::batch, &_free[n]);
+			_generated += OBJECT::batch;
+			_calls++;
+		}
+		GLuint id = _free.back();
+		_free.pop_back();
+		return id;
+	}
+	void release(GLuint id)
+	{
+		_released.push_back(id);
+	}
+	// Call once per frame, after the last command that may use a name
+	// released during the frame has been submitted.
+	void frame()
+	{
+		collect();
+		if (_released.empty())
+		{
+			return;
+		}
+		if (_count == FRAMES)
+		{
+			// The GPU is more than FRAMES frames behind, wait for the oldest.
+			glClientWaitSync(_retired[_head].fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			retire(_retired[_head]);
+		}
+		Retired& r = _retired[(_head + _count) % FRAMES];
+		r.names.swap(_released);
+		r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		_count++;
+	}
+	// Recycle the names of every frame the GPU has finished, without waiting.
+	void collect()
+	{
+		while (_count > 0)
+		{
+			GLenum status = glClientWaitSync(_retired[_head].fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			{
+				break;
+			}
+			retire(_retired[_head]);
+		}
+	}
+	std::size_t generated() const
+	{
+		return _generated;
+	}
+	std::size_t calls() const
+	{
+		return _calls;
+	}
+	std::size_t recycled() const
+	{
+		return _recycled;
+	}
+};
+
+template <typename OBJECT>
+NamePool<OBJECT> * NamePool<OBJECT>::_current = NULL;
+
+
+// Move-only owner of one GL name, from the current pool if there is one.
+// Copying would alias the name, so it is not allowed; moving transfers
+// ownership. The name is released on destruction, or earlier by reset(),
+// which objects outliving the context must call while it is current.
+template <typename OBJECT>
+class Name
+{
+private:
+	GLuint _id;
+public:
+	Name()
+	{
+		NamePool<OBJECT> * pool = NamePool<OBJECT>::current();
+		if (pool != NULL)
+		{
+			_id = pool->acquire();
+		}
+		else
+		{
+			OBJECT::generate(1, &_id);
+		}
+	}
+	~Name()
+	{
+		reset();
+	}
+	Name(Name&& other) noexcept : _id(other._id)
+	{
+		other._id = 0;
+	}
+	Name& operator=(Name&& other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			std::swap(_id, other._id);
+		}
+		return *this;
+	}
+	Name(const Name&) = delete;
+	Name& operator=(const Name&) = delete;
+	void reset()
+	{
+		if (_id != 0)
+		{
+			NamePool<OBJECT> * pool = NamePool<OBJECT>::current();
+			if (pool != NULL)
+			{
+				pool->release(_id);
+			}
+			else
+			{
+				OBJECT::remove(1, &_id);
+			}
+			_id = 0;
+		}
+	}
+	// Gives up ownership: the caller deletes the returned name.
+	GLuint disown()
+	{
+		GLuint id = _id;
+		_id = 0;
+		return id;
+	}
+	GLuint id() const
+	{
+		return _id;
+	}
+};
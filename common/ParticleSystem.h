@@ -0,0 +1,323 @@
+#pragma once
+
+#include "Shader.h"
+#include "Buffer.h"
+#include "Matrix4f.h"
+#include "Uniform.h"
+#include "SpscQueue.h"
+
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#define PARTICLES_GLSL(src) "#version 430\n" #src
+
+
+// A burst of count particles, as the simulation shader reads it. Start
+// positions are spread up to spread around position, velocities up to
+// jitter around velocity, lifetimes between half and one and a half life.
+struct Emission
+{
+	float position[3];
+	float spread;
+	float velocity[3];
+	float jitter;
+	float color[3];
+	float life;
+	uint32_t count;
+	// Set by ParticleSystem::update.
+	uint32_t first;
+	uint32_t padding[2];
+};
+
+
+// Particles that live entirely in GPU buffers. A compute shader advances
+// them and writes newly emitted ones into a ring of capacity slots, oldest
+// first, with random start values from the counter based Random::hash so no
+// state is kept per particle. Drawing is one instanced quad per slot.
+//
+// The CPU only queues Emission records: emit() pushes to a small ring that
+// update() drains, so per-particle data never crosses the bus after the
+// buffer is cleared at construction. emit() may be called from one other
+// thread than update().
+class ParticleSystem
+{
+public:
+	// Emissions consumed per update, the rest wait for the next one.
+	static const unsigned MAX_EMISSIONS = 32;
+private:
+	static constexpr const char * simulateSource = PARTICLES_GLSL
+	(
+		layout(local_size_x = 256) in;
+		struct Particle
+		{
+			vec4 position;
+			vec4 velocity;
+		};
+		struct Emission
+		{
+			vec4 position;
+			vec4 velocity;
+			vec4 color;
+			uvec4 range;
+		};
+		layout(std430, binding = 0) buffer Particles { Particle particles[]; };
+		layout(std430, binding = 1) readonly buffer Emissions { Emission emissions[]; };
+		layout(location = 0) uniform uint capacity;
+		layout(location = 1) uniform uint head;
+		layout(location = 2) uniform uint emitted;
+		layout(location = 3) uniform uint emissionCount;
+		layout(location = 4) uniform uint frame;
+		layout(location = 5) uniform vec4 gravity;
+		uint hash(uint n, uint stream)
+		{
+			uint x = n * 747796405u + stream * 2891336453u;
+			x = ((x >> ((x >> 28u) + 4u)) ^ x) * 277803737u;
+			return (x >> 22u) ^ x;
+		}
+		float random(uint n, uint stream)
+		{
+			return float(hash(n, stream) >> 8u) * (1.0 / 16777216.0);
+		}
+		vec3 signed3(uint n)
+		{
+			return vec3(random(n, frame), random(n + 1u, frame), random(n + 2u, frame)) * 2.0 - 1.0;
+		}
+		void main()
+		{
+			uint i = gl_GlobalInvocationID.x;
+			if (i >= capacity)
+			{
+				return;
+			}
+			// Position of this slot in the ring after the previous update's end.
+			uint slot = (i + capacity - head) % capacity;
+			if (slot < emitted)
+			{
+				uint e = 0u;
+				while (e + 1u < emissionCount && emissions[e + 1u].range.y <= slot)
+				{
+					e++;
+				}
+				Emission emission = emissions[e];
+				uint n = 8u * i;
+				vec3 position = emission.position.xyz + signed3(n) * emission.position.w;
+				vec3 velocity = emission.velocity.xyz + signed3(n + 3u) * emission.velocity.w;
+				float life = emission.color.w * (0.5 + random(n + 6u, frame));
+				uint color = packUnorm4x8(vec4(emission.color.rgb, 1.0));
+				particles[i] = Particle(vec4(position, life), vec4(velocity, uintBitsToFloat(color)));
+			}
+			else if (particles[i].position.w > 0.0)
+			{
+				Particle p = particles[i];
+				float dt = gravity.w;
+				vec3 velocity = p.velocity.xyz + gravity.xyz * dt;
+				vec3 position = p.position.xyz + velocity * dt;
+				// Bounce off the y = 0 floor, losing half the speed.
+				if (position.y < 0.0)
+				{
+					position.y = -position.y;
+					velocity.y = -0.5 * velocity.y;
+				}
+				particles[i] = Particle(vec4(position, p.position.w - dt), vec4(velocity, p.velocity.w));
+			}
+		}
+	);
+	static constexpr const char * vertexSource = PARTICLES_GLSL
+	(
+		struct Particle
+		{
+			vec4 position;
+			vec4 velocity;
+		};
+		layout(std430, binding = 0) readonly buffer Particles { Particle particles[]; };
+		layout(location = 0) uniform mat4 view;
+		layout(location = 1) uniform mat4 projection;
+		layout(location = 2) uniform float size;
+		out vec2 fcorner;
+		out vec4 fcolor;
+		void main()
+		{
+			Particle p = particles[gl_InstanceID];
+			fcorner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+			fcolor = unpackUnorm4x8(floatBitsToUint(p.velocity.w));
+			fcolor.a = clamp(p.position.w, 0.0, 1.0);
+			vec4 v = view * vec4(p.position.xyz, 1.0);
+			v.xy += fcorner * size;
+			// Dead particles collapse outside the clip volume.
+			gl_Position = p.position.w > 0.0 ? projection * v : vec4(2.0, 2.0, 2.0, 1.0);
+		}
+	);
+	static constexpr const char * fragmentSource = PARTICLES_GLSL
+	(
+		in vec2 fcorner;
+		in vec4 fcolor;
+		layout(location = 0) out vec4 FragColor;
+		void main()
+		{
+			float d = dot(fcorner, fcorner);
+			if (d > 1.0)
+			{
+				discard;
+			}
+			FragColor = vec4(fcolor.rgb * fcolor.a * (1.0 - d), 1.0);
+		}
+	);
+
+	ShaderProgram _simulate;
+	ShaderProgram _draw;
+	ShaderStorageBuffer _particles;
+	ShaderStorageBuffer _emissions;
+	VertexArray _va;
+	SpscQueue<Emission, 64> _queue;
+	GLuint _capacity;
+	GLuint _head;
+	GLuint _frame;
+	GLuint _alive;
+	float _gravity[3];
+	bool _status;
+	std::string _info;
+
+	template <GLenum TYPE>
+	bool compile(Shader<TYPE>& shader, const char * source)
+	{
+		shader.source(source);
+		shader.compile();
+		if (!shader.status())
+		{
+			std::string error;
+			shader.info(error);
+			_info += error;
+			return false;
+		}
+		return true;
+	}
+	bool link(ShaderProgram& program)
+	{
+		program.link();
+		if (!program.status())
+		{
+			std::string error;
+			program.info(error);
+			_info += error;
+			return false;
+		}
+		return true;
+	}
+public:
+	// Needs a 4.3 context. Check status() before updating.
+	ParticleSystem(GLuint capacity) : _capacity(capacity), _head(0), _frame(0), _alive(0), _gravity{0, -9.81f, 0}, _status(false)
+	{
+		_particles.bind();
+		ShaderStorageBuffer::data(capacity * 8 * sizeof(GLfloat), NULL, GL_DYNAMIC_COPY);
+		// Zero life: every slot starts dead.
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32F, GL_RED, GL_FLOAT, NULL);
+		_emissions.bind();
+		ShaderStorageBuffer::data(MAX_EMISSIONS * sizeof(Emission), NULL, GL_STREAM_DRAW);
+
+		ComputeShader simulate;
+		VertexShader vertex;
+		FragmentShader fragment;
+		if (compile(simulate, simulateSource) && compile(vertex, vertexSource) && compile(fragment, fragmentSource))
+		{
+			_simulate.attach(simulate);
+			_draw.attach(vertex);
+			_draw.attach(fragment);
+			_status = link(_simulate) && link(_draw);
+			_simulate.detach(simulate);
+			_draw.detach(vertex);
+			_draw.detach(fragment);
+		}
+		simulate.destroy();
+		vertex.destroy();
+		fragment.destroy();
+	}
+	bool status() const
+	{
+		return _status;
+	}
+	void info(std::string& string) const
+	{
+		string = _info;
+	}
+	void gravity(float x, float y, float z)
+	{
+		_gravity[0] = x;
+		_gravity[1] = y;
+		_gravity[2] = z;
+	}
+	// Returns false when the ring is full.
+	bool emit(const Emission& emission)
+	{
+		return _queue.push(emission);
+	}
+	// Upper bound on live particles: slots emitted into, capped at capacity.
+	GLuint alive() const
+	{
+		return _alive;
+	}
+	// Emits the queued bursts and advances every particle by dt seconds.
+	void update(float dt)
+	{
+		Emission batch[MAX_EMISSIONS];
+		unsigned count = 0;
+		GLuint emitted = 0;
+		while (count < MAX_EMISSIONS && emitted < _capacity && _queue.pop(batch[count]))
+		{
+			batch[count].count = std::min(batch[count].count, _capacity - emitted);
+			batch[count].first = emitted;
+			emitted += batch[count].count;
+			count++;
+		}
+		if (count > 0)
+		{
+			_emissions.bind();
+			ShaderStorageBuffer::data(MAX_EMISSIONS * sizeof(Emission), NULL, GL_STREAM_DRAW);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(Emission), batch);
+		}
+
+		_simulate.use();
+		glUniform1ui(0, _capacity);
+		glUniform1ui(1, _head);
+		glUniform1ui(2, emitted);
+		glUniform1ui(3, count);
+		glUniform1ui(4, _frame);
+		glUniform4f(5, _gravity[0], _gravity[1], _gravity[2], dt);
+		_particles.bindBase(0);
+		_emissions.bindBase(1);
+		ShaderProgram::dispatch((_capacity + 255) / 256);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		_head = (_head + emitted) % _capacity;
+		_alive = std::min(_capacity, _alive + emitted);
+		_frame++;
+	}
+	// Additive sprites of size world units, drawn without writing depth.
+	// Depth writes are enabled again afterwards and blending left disabled.
+	void draw(const Matrix4f& view, const Matrix4f& projection, float size)
+	{
+		_draw.use();
+		Uniform<0>::matrix4f(view);
+		Uniform<1>::matrix4f(projection);
+		glUniform1f(2, size);
+		_particles.bindBase(0);
+		_va.bind();
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE);
+		glDepthMask(GL_FALSE);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, _alive);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+	}
+	void destroy()
+	{
+		_particles.destroy();
+		_emissions.destroy();
+		_va.destroy();
+		_simulate.destroy();
+		_draw.destroy();
+	}
+};
+
+#undef PARTICLES_GLSL
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "Shader.h"
+#include "Buffer.h"
+
+#include <string>
+#include <cstddef>
+
+
+// Size in bytes of one component of a GL data type.
+template <GLenum TYPE> struct GLTypeSize;
+template <> struct GLTypeSize<GL_BYTE> { static const std::size_t SIZE = 1; };
+template <> struct GLTypeSize<GL_UNSIGNED_BYTE> { static const std::size_t SIZE = 1; };
+template <> struct GLTypeSize<GL_SHORT> { static const std::size_t SIZE = 2; };
+template <> struct GLTypeSize<GL_UNSIGNED_SHORT> { static const std::size_t SIZE = 2; };
+template <> struct GLTypeSize<GL_HALF_FLOAT> { static const std::size_t SIZE = 2; };
+template <> struct GLTypeSize<GL_INT> { static const std::size_t SIZE = 4; };
+template <> struct GLTypeSize<GL_UNSIGNED_INT> { static const std::size_t SIZE = 4; };
+template <> struct GLTypeSize<GL_FLOAT> { static const std::size_t SIZE = 4; };
+
+// GL enum of an index type, only the three glDrawElements accepts.
+template <typename INDEX> struct IndexType;
+template <> struct IndexType<GLubyte> { static const GLenum TYPE = GL_UNSIGNED_BYTE; };
+template <> struct IndexType<GLushort> { static const GLenum TYPE = GL_UNSIGNED_SHORT; };
+template <> struct IndexType<GLuint> { static const GLenum TYPE = GL_UNSIGNED_INT; };
+
+
+// One vertex attribute: SIZE components of TYPE at byte OFFSET of the vertex.
+template <GLuint ID, GLint SIZE, GLenum TYPE, std::size_t OFFSET, GLboolean NORMALIZED = GL_FALSE>
+class Attribute
+{
+public:
+	static const std::size_t END = OFFSET + SIZE * GLTypeSize<TYPE>::SIZE;
+	static void setup(GLsizei stride)
+	{
+		VertexAttribute<ID>::enable();
+		VertexAttribute<ID>::set(SIZE, TYPE, NORMALIZED, stride, (char*)0 + OFFSET);
+	}
+};
+
+// Layout of an interleaved vertex struct VERTEX, one Attribute per field.
+template <typename VERTEX, typename... ATTRIBUTES>
+class VertexFormat
+{
+	static_assert(sizeof...(ATTRIBUTES) > 0, "a vertex format needs attributes");
+	static_assert(((ATTRIBUTES::END <= sizeof(VERTEX)) && ...), "attribute outside of the vertex");
+public:
+	typedef VERTEX Vertex;
+	static const GLsizei STRIDE = sizeof(VERTEX);
+	static void setup()
+	{
+		(ATTRIBUTES::setup(STRIDE), ...);
+	}
+};
+
+
+// A vertex array with its vertex and index buffer and the program that draws
+// it. Everything that does not change from draw to draw is a template
+// argument: FORMAT is a VertexFormat, PROGRAM a class with static vertex and
+// fragment shader sources, MODE the primitive type and INDEX the C++ index
+// type. draw() inlines to use, bind and one glDrawElements with constant mode
+// and type.
+template <typename FORMAT, typename PROGRAM, GLenum MODE, typename INDEX>
+class Pipeline
+{
+public:
+	typedef typename FORMAT::Vertex Vertex;
+	typedef INDEX Index;
+	static const GLenum DRAW_MODE = MODE;
+	static const GLenum INDEX_TYPE = IndexType<INDEX>::TYPE;
+private:
+	VertexShader _vertexShader;
+	FragmentShader _fragmentShader;
+	ShaderProgram _program;
+	VertexArray _va;
+	ArrayBuffer _vb;
+	ElementArrayBuffer _ib;
+	GLsizei _count;
+	bool _status;
+	std::string _info;
+public:
+	// Compiles and links the program and sets up the vertex array. Check
+	// status() before drawing.
+	Pipeline() : _count(0), _status(false)
+	{
+		_vertexShader.source(PROGRAM::vertex);
+		_fragmentShader.source(PROGRAM::fragment);
+		_vertexShader.compile();
+		_fragmentShader.compile();
+		if (!_vertexShader.status() || !_fragmentShader.status())
+		{
+			std::string error;
+			_vertexShader.info(error);
+			_info += error;
+			_fragmentShader.info(error);
+			_info += error;
+			return;
+		}
+		// The linked program keeps its code, so the shaders are detached
+		// right away and destroy() has nothing to undo on any path.
+		_program.attach(_vertexShader);
+		_program.attach(_fragmentShader);
+		_program.link();
+		_program.detach(_vertexShader);
+		_program.detach(_fragmentShader);
+		if (!_program.status())
+		{
+			_program.info(_info);
+			return;
+		}
+		_status = true;
+
+		_va.bind();
+		_vb.bind();
+		FORMAT::setup();
+		_ib.bind();
+		glBindVertexArray(0);
+	}
+	bool status() const
+	{
+		return _status;
+	}
+	void info(std::string& string) const
+	{
+		string = _info;
+	}
+	void vertices(const Vertex * data, std::size_t count, GLenum usage = GL_STATIC_DRAW)
+	{
+		_vb.bind();
+		ArrayBuffer::data(count * sizeof(Vertex), data, usage);
+	}
+	template <std::size_t N>
+	void vertices(const Vertex (&data)[N])
+	{
+		vertices(data, N);
+	}
+	void indices(const Index * data, std::size_t count, GLenum usage = GL_STATIC_DRAW)
+	{
+		_va.bind();
+		ElementArrayBuffer::data(count * sizeof(Index), data, usage);
+		_count = count;
+	}
+	template <std::size_t N>
+	void indices(const Index (&data)[N])
+	{
+		indices(data, N);
+	}
+	// For setting uniforms before draw().
+	void use()
+	{
+		_program.use();
+	}
+	void draw()
+	{
+		_program.use();
+		_va.bind();
+		VertexArray::drawElements(MODE, _count, INDEX_TYPE, 0);
+	}
+	// count indices starting at index first.
+	void draw(GLsizei count, GLsizei first = 0)
+	{
+		_program.use();
+		_va.bind();
+		VertexArray::drawElements(MODE, count, INDEX_TYPE, (char*)0 + first * sizeof(Index));
+	}
+	void destroy()
+	{
+		_va.destroy();
+		_vb.destroy();
+		_ib.destroy();
+		_vertexShader.destroy();
+		_fragmentShader.destroy();
+		_program.destroy();
+	}
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "GL.h"
+#include "Buffer.h"
+
+#include <vector>
+#include <cstddef>
+
+
+// Reads the framebuffer back through a ring of RING pixel pack buffers, so
+// the CPU does not wait for the frame it just drew. submit() queues a
+// glReadPixels into the next buffer behind a fence. retire() maps the oldest
+// readback in flight once its fence has signaled, latest() the newest one,
+// skipping those before it. Both hand the mapped pixels, NULL if mapping
+// failed, and the readback's number to read(pixels, frame).
+//
+// The first submit() creates the buffers, and a new size reallocates them
+// and drops the readbacks in flight. A full ring makes submit() wait for
+// the oldest readback and drop it unread; callers that need every frame
+// retire it first. destroy() releases the buffers and fences and must be
+// called while the context is current.
+template <int RING>
+class PixelReadback
+{
+	GLenum _format;
+	GLenum _type;
+	std::size_t _pixelSize;
+	std::vector<PixelPackBuffer> _buffers;
+	GLsync _fence[RING];
+	int _width;
+	int _height;
+	int _submitted;
+	int _retired;
+	int _stalls;
+
+	bool signaled(int frame, bool wait)
+	{
+		GLsync fence = _fence[frame % RING];
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status == GL_TIMEOUT_EXPIRED && wait)
+		{
+			_stalls++;
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		}
+		return status != GL_TIMEOUT_EXPIRED;
+	}
+	void drop()
+	{
+		for (; _retired < _submitted; _retired++)
+		{
+			glDeleteSync(_fence[_retired % RING]);
+		}
+	}
+	template <typename READ>
+	void map(int frame, READ& read)
+	{
+		_buffers[frame % RING].bind();
+		const void * pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size(), GL_MAP_READ_BIT);
+		read(pixels, frame);
+		if (pixels != NULL)
+		{
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+public:
+	// format and type as for glReadPixels, pixelSize the bytes they take.
+	PixelReadback(GLenum format, GLenum type, std::size_t pixelSize)
+		: _format(format), _type(type), _pixelSize(pixelSize),
+		_width(0), _height(0), _submitted(0), _retired(0), _stalls(0)
+	{}
+	~PixelReadback()
+	{
+		destroy();
+	}
+	PixelReadback(const PixelReadback&) = delete;
+	PixelReadback& operator=(const PixelReadback&) = delete;
+
+	int width() const
+	{
+		return _width;
+	}
+	int height() const
+	{
+		return _height;
+	}
+	std::size_t size() const
+	{
+		return std::size_t(_width) * _height * _pixelSize;
+	}
+	// Readbacks submitted and retired so far; the difference is in flight.
+	int submitted() const
+	{
+		return _submitted;
+	}
+	int retired() const
+	{
+		return _retired;
+	}
+	// Times retire(), latest() or submit() had to wait for the GPU.
+	int stalls() const
+	{
+		return _stalls;
+	}
+	// Queue a readback of the lower left width x height pixels.
+	void submit(int width, int height)
+	{
+		if (_buffers.empty())
+		{
+			_buffers.resize(RING);
+		}
+		if (width != _width || height != _height)
+		{
+			drop();
+			_width = width;
+			_height = height;
+			for (int i = 0; i < RING; i++)
+			{
+				_buffers[i].bind();
+				PixelPackBuffer::data(size(), NULL, GL_STREAM_READ);
+			}
+		}
+		if (_submitted - _retired == RING)
+		{
+			signaled(_retired, true);
+			glDeleteSync(_fence[_retired % RING]);
+			_retired++;
+		}
+		_buffers[_submitted % RING].bind();
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, _format, _type, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		_fence[_submitted % RING] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		_submitted++;
+	}
+	// Read the oldest readback in flight. With wait false it returns false
+	// instead of stalling if the GPU has not finished it yet.
+	template <typename READ>
+	bool retire(bool wait, READ read)
+	{
+		if (_retired == _submitted || !signaled(_retired, wait))
+		{
+			return false;
+		}
+		glDeleteSync(_fence[_retired % RING]);
+		map(_retired++, read);
+		return true;
+	}
+	// Read the newest finished readback and retire the older ones unread.
+	// False if none finished since the last call. Fences signal in order;
+	// a full ring waits for the oldest, so the next submit() has a slot.
+	template <typename READ>
+	bool latest(READ read)
+	{
+		if (_retired == _submitted || !signaled(_retired, _submitted - _retired == RING))
+		{
+			return false;
+		}
+		do
+		{
+			glDeleteSync(_fence[_retired % RING]);
+			_retired++;
+		}
+		while (_retired < _submitted && signaled(_retired, false));
+		map(_retired - 1, read);
+		return true;
+	}
+	void destroy()
+	{
+		if (!_buffers.empty())
+		{
+			drop();
+			_buffers.clear();
+			_width = 0;
+			_height = 0;
+		}
+	}
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Trig.h"
+#include "SimdTrig.h"
+
+#include <iostream>
+#include <array>
+#include <cstddef>
+
+
+// Literal type: construction, apply and axisAngle work in constant
+// expressions, e.g. for rest poses.
+class Quaternion
+{
+private:
+	std::array<float, 4> _data;
+public:
+	constexpr Quaternion(float q0, float q1, float q2, float q3) : _data{{q0, q1, q2, q3}}
+	{}
+	constexpr Quaternion(std::array<float, 4> data) : _data(data)
+	{}
+	constexpr Quaternion(const Quaternion &q) : _data(q._data)
+	{}
+	constexpr Quaternion& operator=(const Quaternion &q)
+	{
+		_data = q._data;
+		return *this;
+	}
+	constexpr float& operator[](std::size_t i)
+	{
+		return _data[i];
+	}
+	constexpr float operator[](std::size_t i) const
+	{
+		return _data[i];
+	}
+	constexpr void apply(const Quaternion &q)
+	{
+		std::array<float, 4> Q(_data);
+		_data[0] = (Q[0] * q[0]) - (Q[1] * q[1]) - (Q[2] * q[2]) - (Q[3] * q[3]);
+		_data[1] = (Q[0] * q[1]) + (Q[1] * q[0]) + (Q[2] * q[3]) - (Q[3] * q[2]);
+		_data[2] = (Q[0] * q[2]) - (Q[1] * q[3]) + (Q[2] * q[0]) + (Q[3] * q[1]);
+		_data[3] = (Q[0] * q[3]) + (Q[1] * q[2]) - (Q[2] * q[1]) + (Q[3] * q[0]);
+	}
+	constexpr void add(const Quaternion &q)
+	{
+		for (std::size_t i = 0; i < 4; i++)
+		{
+			_data[i] += q[i];
+		}
+	}
+	constexpr void scale(float a)
+	{
+		for (std::size_t i = 0; i < 4; i++)
+		{
+			_data[i] *= a;
+		}
+	}
+	constexpr float dot(const Quaternion &q) const
+	{
+		return _data[0] * q[0] + _data[1] * q[1] + _data[2] * q[2] + _data[3] * q[3];
+	}
+	// The inverse rotation, for unit quaternions.
+	constexpr Quaternion conjugate() const
+	{
+		return Quaternion(_data[0], -_data[1], -_data[2], -_data[3]);
+	}
+	static constexpr Quaternion axisAngle(float x, float y, float z, float a)
+	{
+		float s = Trig::sin(a * 0.5f);
+		return Quaternion(Trig::cos(a * 0.5f), x * s, y * s, z * s);
+	}
+	template <TrigPrecision PRECISION>
+	static Quaternion axisAngle(float x, float y, float z, float a)
+	{
+		float s, c;
+		SimdTrig<PRECISION>::sincos(a * 0.5f, s, c);
+		return Quaternion(c, x * s, y * s, z * s);
+	}
+	// count rotations about the same axis, four angles per SIMD step.
+	template <TrigPrecision PRECISION>
+	static void axisAngle(float x, float y, float z, const float * angles, Quaternion * result, std::size_t count)
+	{
+		for (std::size_t i = 0; i < count; i += 4)
+		{
+			alignas(16) float half[4] = {};
+			alignas(16) float s[4];
+			alignas(16) float c[4];
+			std::size_t n = count - i < 4 ? count - i : 4;
+			for (std::size_t k = 0; k < n; k++)
+			{
+				half[k] = angles[i + k] * 0.5f;
+			}
+			__m128 vs, vc;
+			SimdTrig<PRECISION>::sincos(_mm_load_ps(half), vs, vc);
+			_mm_store_ps(s, vs);
+			_mm_store_ps(c, vc);
+			for (std::size_t k = 0; k < n; k++)
+			{
+				result[i + k] = Quaternion(c[k], x * s[k], y * s[k], z * s[k]);
+			}
+		}
+	}
+	void print() const
+	{
+		std::cout << "(" << _data[0] << "," << _data[1] << "," << _data[2] << "," << _data[3] << ")" << std::endl;
+	}
+};
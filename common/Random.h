@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+
+// Small generator with the same output on every platform, unlike drand48 or
+// the standard distributions.
+class Random
+{
+private:
+	uint64_t _state;
+public:
+	Random(uint64_t seed = 1) : _state(seed * 6364136223846793005ULL + 1442695040888963407ULL)
+	{}
+	uint32_t next()
+	{
+		// PCG-XSH-RR
+		uint64_t old = _state;
+		_state = old * 6364136223846793005ULL + 1442695040888963407ULL;
+		uint32_t xorshifted = uint32_t(((old >> 18) ^ old) >> 27);
+		uint32_t rot = uint32_t(old >> 59);
+		return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+	}
+	// Uniform in [0, 1).
+	float uniform()
+	{
+		return (next() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// Counter based: number n of stream without generating the ones before
+	// it, so chunks of a fill or GPU threads need no shared state. The GLSL
+	// in ParticleSystem.h is the same function.
+	static constexpr uint32_t hash(uint32_t n, uint32_t stream)
+	{
+		uint32_t x = n * 747796405u + stream * 2891336453u;
+		x = ((x >> ((x >> 28) + 4)) ^ x) * 277803737u;
+		return (x >> 22) ^ x;
+	}
+	static constexpr float uniform(uint32_t n, uint32_t stream)
+	{
+		return (hash(n, stream) >> 8) * (1.0f / 16777216.0f);
+	}
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "GL.h"
+#include "NamePool.h"
+
+#include <string>
+#include <fstream>
+#include <sstream>
+
+
+// Shaders and programs own their GL name like the wrappers of Buffer.h. A
+// shader is not needed once its program is linked, and GL defers deleting it
+// while it is attached, so it can be destroyed right after link().
+template <GLenum TYPE>
+class Shader
+{
+private:
+	Name<ShaderObjects<TYPE> > _name;
+public:
+	Shader()
+	{
+		if (_name.id() == 0)
+		{
+			throw 0;
+		}
+	}
+	Shader(Shader&&) = default;
+	Shader& operator=(Shader&&) = default;
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+	void source(GLsizei count, const GLchar * const * string, const GLint * length)
+	{
+		glShaderSource(_name.id(), count, string, length);
+	}
+	void source(GLchar const *cstr, GLint length)
+	{
+		source(1, &cstr, &length);
+	}
+	void source(const std::string& string)
+	{
+		source(string.c_str(), string.size());
+	}
+	void source(const std::ifstream& f)
+	{
+		std::stringstream buffer;
+		buffer << f.rdbuf();
+		source(buffer.str());
+	}
+	void compile()
+	{
+		glCompileShader(_name.id());
+	}
+	bool status()
+	{
+		GLint status;
+		get(GL_COMPILE_STATUS, &status);
+		return (status == GL_TRUE);
+	}
+	void info(std::string& string)
+	{
+		GLint length;
+		get(GL_INFO_LOG_LENGTH, &length);
+		string.resize(length);
+		glGetShaderInfoLog(_name.id(), length, &length, &string[0]);
+	}
+	GLuint id() const
+	{
+		return _name.id();
+	}
+	void destroy()
+	{
+		_name.reset();
+	}
+	void get(GLenum pname, GLint * params)
+	{
+		glGetShaderiv(_name.id(), pname, params);
+	}
+};
+
+class VertexShader : public Shader<GL_VERTEX_SHADER>{};
+class FragmentShader : public Shader<GL_FRAGMENT_SHADER>{};
+class ComputeShader : public Shader<GL_COMPUTE_SHADER>{};
+
+class ShaderProgram
+{
+private:
+	Name<ProgramObjects> _name;
+public:
+	ShaderProgram() = default;
+	ShaderProgram(ShaderProgram&&) = default;
+	ShaderProgram& operator=(ShaderProgram&&) = default;
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
+	GLuint id() const
+	{
+		return _name.id();
+	}
+	// Gives up ownership of the name, the caller deletes it.
+	GLuint disown()
+	{
+		return _name.disown();
+	}
+	template <GLenum TYPE>
+	void attach(const Shader<TYPE>& shader)
+	{
+		glAttachShader(_name.id(), shader.id());
+	}
+	void link()
+	{
+		glLinkProgram(_name.id());
+	}
+	void use()
+	{
+		glUseProgram(_name.id());
+	}
+	// Runs an attached compute shader, the program must be in use.
+	static void dispatch(GLuint x, GLuint y = 1, GLuint z = 1)
+	{
+		glDispatchCompute(x, y, z);
+	}
+	void get(GLenum pname, GLint * params)
+	{
+		glGetProgramiv(_name.id(), pname, params);
+	}
+	bool status()
+	{
+		GLint status;
+		get(GL_LINK_STATUS, &status);
+		return (status == GL_TRUE);
+	}
+	void info(std::string& string)
+	{
+		GLint length;
+		get(GL_INFO_LOG_LENGTH, &length);
+		string.resize(length);
+		glGetProgramInfoLog(_name.id(), length, &length, &string[0]);
+	}
+	template <GLenum TYPE>
+	void detach(const Shader<TYPE>& shader)
+	{
+		glDetachShader(_name.id(), shader.id());
+	}
+	void destroy()
+	{
+		_name.reset();
+	}
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <emmintrin.h>
+
+#include <cstddef>
+
+
+// How many polynomial terms the SIMD kernels spend. Largest errors over
+// every float with |a| <= 8192, as measured by TrigTest against double libm:
+//
+//                  sin, cos (absolute)   tan (relative)
+//   TRIG_LOW       3.5e-5                4.8e-5
+//   TRIG_MEDIUM    1.4e-6                2.2e-6
+//   TRIG_HIGH      8.0e-8                2.4e-7
+//
+// The range reduction loses precision beyond |a| = 8192.
+enum TrigPrecision
+{
+	TRIG_LOW,
+	TRIG_MEDIUM,
+	TRIG_HIGH
+};
+
+
+// sin, cos and tan of four floats at once, SSE2 only. The argument is
+// reduced to r in [-pi/4, pi/4] by an extended precision multiple of pi/4,
+// then minimax polynomials of r give sin(r) and cos(r) and the quadrant
+// selects and negates them. tan is the ratio of the two kernels after a
+// double precision reduction, so its relative error stays bounded up to
+// the poles.
+template <TrigPrecision PRECISION = TRIG_HIGH>
+class SimdTrig
+{
+private:
+	static __m128 sinKernel(__m128 r, __m128 z)
+	{
+		__m128 p;
+		if constexpr (PRECISION == TRIG_HIGH)
+		{
+			p = _mm_set1_ps(-1.9515433349513736e-4f);
+			p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(8.332161881639408e-3f));
+			p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(-1.6666654627528033e-1f));
+		}
+		else
+		{
+			p = _mm_set1_ps(8.163419345943381e-3f);
+			p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(-1.666339593271019e-1f));
+		}
+		return _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), p));
+	}
+	static __m128 cosKernel(__m128 z)
+	{
+		__m128 p;
+		if constexpr (PRECISION == TRIG_HIGH)
+		{
+			p = _mm_set1_ps(2.4438569554592015e-5f);
+			p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(-1.3887368529470465e-3f));
+			p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(4.1666646886748614e-2f));
+		}
+		else if constexpr (PRECISION == TRIG_MEDIUM)
+		{
+			p = _mm_set1_ps(-1.3652577936707595e-3f);
+			p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(4.166128462856911e-2f));
+		}
+		else
+		{
+			p = _mm_set1_ps(4.090930000255856e-2f);
+		}
+		__m128 c = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(z, z), p), _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		return _mm_add_ps(c, _mm_set1_ps(1.0f));
+	}
+	static __m128 select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+	// Splits a into its sign and x = |a| and picks j, the even multiple of
+	// pi/4 nearest to x, also as the float y.
+	static __m128 quadrant(__m128 a, __m128i& j, __m128& y, __m128& sign)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+		sign = _mm_and_ps(a, signMask);
+		__m128 x = _mm_andnot_ps(signMask, a);
+		j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+		j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		y = _mm_cvtepi32_ps(j);
+		return x;
+	}
+	// r = x - y * pi/4 with pi/4 in three parts, the first two multiply
+	// exactly.
+	static __m128 reduce(__m128 x, __m128 y)
+	{
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+		return x;
+	}
+	// The same in double. Near the poles of tan r is tiny and the absolute
+	// error of the float reduction would become a large relative error.
+	static __m128d reduce(__m128d x, __m128d y)
+	{
+		x = _mm_sub_pd(x, _mm_mul_pd(y, _mm_set1_pd(0.7853981638327241)));
+		x = _mm_sub_pd(x, _mm_mul_pd(y, _mm_set1_pd(-4.3527578503371744e-10)));
+		x = _mm_sub_pd(x, _mm_mul_pd(y, _mm_set1_pd(2.5850914908970526e-19)));
+		return x;
+	}
+	static __m128 reducePrecise(__m128 x, __m128 y)
+	{
+		__m128d low = reduce(_mm_cvtps_pd(x), _mm_cvtps_pd(y));
+		__m128d high = reduce(_mm_cvtps_pd(_mm_movehl_ps(x, x)), _mm_cvtps_pd(_mm_movehl_ps(y, y)));
+		return _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high));
+	}
+	// Lanes in an odd quadrant, where sin and cos swap.
+	static __m128 odd(__m128i j)
+	{
+		__m128i two = _mm_set1_epi32(2);
+		return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, two), two));
+	}
+	// Bit 2 of j moved to the sign bit.
+	static __m128 negate(__m128i j)
+	{
+		return _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29));
+	}
+public:
+	static void sincos(__m128 a, __m128& s, __m128& c)
+	{
+		__m128i j;
+		__m128 y, sign;
+		__m128 x = quadrant(a, j, y, sign);
+		__m128 r = reduce(x, y);
+		__m128 z = _mm_mul_ps(r, r);
+		__m128 ks = sinKernel(r, z);
+		__m128 kc = cosKernel(z);
+		__m128 swap = odd(j);
+		s = _mm_xor_ps(select(swap, kc, ks), _mm_xor_ps(sign, negate(j)));
+		c = _mm_xor_ps(select(swap, ks, kc), negate(_mm_add_epi32(j, _mm_set1_epi32(2))));
+	}
+	static __m128 sin(__m128 a)
+	{
+		__m128 s, c;
+		sincos(a, s, c);
+		return s;
+	}
+	static __m128 cos(__m128 a)
+	{
+		__m128 s, c;
+		sincos(a, s, c);
+		return c;
+	}
+	static __m128 tan(__m128 a)
+	{
+		__m128i j;
+		__m128 y, sign;
+		__m128 x = quadrant(a, j, y, sign);
+		__m128 r = reducePrecise(x, y);
+		__m128 z = _mm_mul_ps(r, r);
+		__m128 ks = sinKernel(r, z);
+		__m128 kc = cosKernel(z);
+		__m128 swap = odd(j);
+		__m128 t = _mm_div_ps(select(swap, kc, ks), select(swap, ks, kc));
+		return _mm_xor_ps(t, _mm_xor_ps(sign, _mm_and_ps(swap, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)))));
+	}
+
+	// One lane of the above, for per-frame scalar work.
+	static void sincos(float a, float& s, float& c)
+	{
+		__m128 vs, vc;
+		sincos(_mm_set_ss(a), vs, vc);
+		s = _mm_cvtss_f32(vs);
+		c = _mm_cvtss_f32(vc);
+	}
+	static float sin(float a)
+	{
+		return _mm_cvtss_f32(sin(_mm_set_ss(a)));
+	}
+	static float cos(float a)
+	{
+		return _mm_cvtss_f32(cos(_mm_set_ss(a)));
+	}
+	static float tan(float a)
+	{
+		return _mm_cvtss_f32(tan(_mm_set_ss(a)));
+	}
+
+	// count angles at a time, any alignment.
+	static void sincos(const float * a, float * s, float * c, std::size_t count)
+	{
+		std::size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 vs, vc;
+			sincos(_mm_loadu_ps(a + i), vs, vc);
+			_mm_storeu_ps(s + i, vs);
+			_mm_storeu_ps(c + i, vc);
+		}
+		for (; i < count; i++)
+		{
+			sincos(a[i], s[i], c[i]);
+		}
+	}
+	static void tan(const float * a, float * t, std::size_t count)
+	{
+		std::size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			_mm_storeu_ps(t + i, tan(_mm_loadu_ps(a + i)));
+		}
+		for (; i < count; i++)
+		{
+			t[i] = tan(a[i]);
+		}
+	}
+};
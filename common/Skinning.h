@@ -0,0 +1,216 @@
+#pragma once
+
+#include "DualQuaternion.h"
+#include "JobSystem.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+
+// Dual quaternion skinning of one big batch of vertices, all meshes of a
+// frame sharing one bone palette. Everything is kept as structure of arrays:
+// the eight components of every bone, and per vertex the rest position and
+// normal, INFLUENCES bone indices and weights, each in its own stream, so
+// four vertices blend in one pass of SSE instructions with no shuffling.
+// Bones are fetched with a gather under AVX2, one lane at a time otherwise.
+//
+// skin() writes position and normal interleaved, six floats per vertex, as
+// an ArrayBuffer takes them. skin(jobs) splits the vertices over the
+// JobSystem.
+class Skinning
+{
+public:
+	static const int INFLUENCES = 4;
+private:
+	std::size_t _vertices;
+	std::size_t _bones;
+	// Rounded up to four, the padding weighted fully to bone 0.
+	std::size_t _padded;
+	std::vector<float> _bone[8];
+	std::vector<float> _rest[6];
+	std::vector<uint32_t> _index[INFLUENCES];
+	std::vector<float> _weight[INFLUENCES];
+	std::vector<float> _out;
+
+	// Component c of bones index[0..3].
+	__m128 fetch(int c, __m128i index) const
+	{
+#ifdef __AVX2__
+		return _mm_i32gather_ps(&_bone[c][0], index, 4);
+#else
+		alignas(16) uint32_t i[4];
+		_mm_store_si128((__m128i *)i, index);
+		const float * b = &_bone[c][0];
+		return _mm_setr_ps(b[i[0]], b[i[1]], b[i[2]], b[i[3]]);
+#endif
+	}
+	// v + 2 r x (r x v + w v), on four vectors.
+	static void rotate(__m128 w, __m128 x, __m128 y, __m128 z, __m128& vx, __m128& vy, __m128& vz)
+	{
+		__m128 cx = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(y, vz), _mm_mul_ps(z, vy)), _mm_mul_ps(w, vx));
+		__m128 cy = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(z, vx), _mm_mul_ps(x, vz)), _mm_mul_ps(w, vy));
+		__m128 cz = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(x, vy), _mm_mul_ps(y, vx)), _mm_mul_ps(w, vz));
+		__m128 two = _mm_set1_ps(2.0f);
+		vx = _mm_add_ps(vx, _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(y, cz), _mm_mul_ps(z, cy))));
+		vy = _mm_add_ps(vy, _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(z, cx), _mm_mul_ps(x, cz))));
+		vz = _mm_add_ps(vz, _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(x, cy), _mm_mul_ps(y, cx))));
+	}
+	static void blocks(std::size_t begin, std::size_t end, void * context)
+	{
+		static_cast<Skinning *>(context)->skin(begin * 4, end * 4);
+	}
+public:
+	Skinning(std::size_t vertices, std::size_t bones)
+		: _vertices(vertices), _bones(bones), _padded((vertices + 3) & ~std::size_t(3))
+	{
+		for (int c = 0; c < 8; c++)
+		{
+			_bone[c].resize(bones);
+		}
+		for (int c = 0; c < 6; c++)
+		{
+			_rest[c].resize(_padded);
+		}
+		for (int k = 0; k < INFLUENCES; k++)
+		{
+			_index[k].resize(_padded);
+			_weight[k].resize(_padded, k == 0 ? 1.0f : 0.0f);
+		}
+		_out.resize(_padded * 6);
+		for (std::size_t b = 0; b < bones; b++)
+		{
+			bone(b, DualQuaternion::identity());
+		}
+	}
+	std::size_t vertices() const
+	{
+		return _vertices;
+	}
+	std::size_t bones() const
+	{
+		return _bones;
+	}
+	// Rest pose of vertex i. Weights should sum to one, unused influences
+	// have weight 0.
+	void vertex(std::size_t i, const float * position, const float * normal, const uint32_t * bones, const float * weights)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			_rest[c][i] = position[c];
+			_rest[3 + c][i] = normal[c];
+		}
+		for (int k = 0; k < INFLUENCES; k++)
+		{
+			_index[k][i] = bones[k];
+			_weight[k][i] = weights[k];
+		}
+	}
+	// Bone i's transform from the rest pose to the current one.
+	void bone(std::size_t i, const DualQuaternion& q)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			_bone[c][i] = q.real()[c];
+			_bone[4 + c][i] = q.dual()[c];
+		}
+	}
+	// Skins vertices [begin, end), begin a multiple of four.
+	void skin(std::size_t begin, std::size_t end)
+	{
+		end = std::min(end, _padded);
+		for (std::size_t v = begin; v < end; v += 4)
+		{
+			__m128 q[8];
+			__m128 pivot[4];
+			for (int k = 0; k < INFLUENCES; k++)
+			{
+				__m128i index = _mm_loadu_si128((const __m128i *)&_index[k][v]);
+				__m128 weight = _mm_loadu_ps(&_weight[k][v]);
+				__m128 b[8];
+				for (int c = 0; c < 8; c++)
+				{
+					b[c] = fetch(c, index);
+				}
+				if (k == 0)
+				{
+					for (int c = 0; c < 4; c++)
+					{
+						pivot[c] = b[c];
+					}
+				}
+				else
+				{
+					// Flip bones on the far side of the first one's rotation.
+					__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b[0], pivot[0]), _mm_mul_ps(b[1], pivot[1])),
+						_mm_add_ps(_mm_mul_ps(b[2], pivot[2]), _mm_mul_ps(b[3], pivot[3])));
+					weight = _mm_xor_ps(weight, _mm_and_ps(dot, _mm_set1_ps(-0.0f)));
+				}
+				for (int c = 0; c < 8; c++)
+				{
+					q[c] = k == 0 ? _mm_mul_ps(b[c], weight) : _mm_add_ps(q[c], _mm_mul_ps(b[c], weight));
+				}
+			}
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(q[0], q[0]), _mm_mul_ps(q[1], q[1])),
+				_mm_add_ps(_mm_mul_ps(q[2], q[2]), _mm_mul_ps(q[3], q[3]))));
+			__m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), length);
+			for (int c = 0; c < 8; c++)
+			{
+				q[c] = _mm_mul_ps(q[c], inverse);
+			}
+
+			__m128 px = _mm_loadu_ps(&_rest[0][v]);
+			__m128 py = _mm_loadu_ps(&_rest[1][v]);
+			__m128 pz = _mm_loadu_ps(&_rest[2][v]);
+			__m128 nx = _mm_loadu_ps(&_rest[3][v]);
+			__m128 ny = _mm_loadu_ps(&_rest[4][v]);
+			__m128 nz = _mm_loadu_ps(&_rest[5][v]);
+			rotate(q[0], q[1], q[2], q[3], px, py, pz);
+			rotate(q[0], q[1], q[2], q[3], nx, ny, nz);
+			// Translation 2 * (w d - dw r + r x d).
+			__m128 two = _mm_set1_ps(2.0f);
+			px = _mm_add_ps(px, _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(q[0], q[5]), _mm_mul_ps(q[4], q[1])),
+				_mm_sub_ps(_mm_mul_ps(q[2], q[7]), _mm_mul_ps(q[3], q[6])))));
+			py = _mm_add_ps(py, _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(q[0], q[6]), _mm_mul_ps(q[4], q[2])),
+				_mm_sub_ps(_mm_mul_ps(q[3], q[5]), _mm_mul_ps(q[1], q[7])))));
+			pz = _mm_add_ps(pz, _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(q[0], q[7]), _mm_mul_ps(q[4], q[3])),
+				_mm_sub_ps(_mm_mul_ps(q[1], q[6]), _mm_mul_ps(q[2], q[5])))));
+
+			alignas(16) float out[6][4];
+			_mm_store_ps(out[0], px);
+			_mm_store_ps(out[1], py);
+			_mm_store_ps(out[2], pz);
+			_mm_store_ps(out[3], nx);
+			_mm_store_ps(out[4], ny);
+			_mm_store_ps(out[5], nz);
+			float * o = &_out[v * 6];
+			for (int lane = 0; lane < 4; lane++)
+			{
+				for (int c = 0; c < 6; c++)
+				{
+					o[lane * 6 + c] = out[c][lane];
+				}
+			}
+		}
+	}
+	void skin()
+	{
+		skin(0, _padded);
+	}
+	void skin(JobSystem& jobs)
+	{
+		jobs.parallel_for(_padded / 4, blocks, this, 256);
+	}
+	// x, y, z, nx, ny, nz per vertex, after skin().
+	const float * output() const
+	{
+		return &_out[0];
+	}
+};
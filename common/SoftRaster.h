@@ -0,0 +1,711 @@
+#pragma once
+
+#include "Matrix4f.h"
+#include "JobSystem.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+#include <vector>
+#include <bitset>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+
+// Eight lanes of float or int32: one AVX2 register when compiled with
+// -mavx2, otherwise a pair of SSE2 registers, so the rasterizer below is
+// written once for both.
+#ifdef __AVX2__
+struct Int8
+{
+	__m256i v;
+	static Int8 set(int32_t a) { return {_mm256_set1_epi32(a)}; }
+	// a * lane for lanes 0 to 7.
+	static Int8 ramp(int32_t a) { return {_mm256_mullo_epi32(_mm256_set1_epi32(a), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))}; }
+	static Int8 load(const uint32_t * p) { return {_mm256_loadu_si256((const __m256i *)p)}; }
+	void store(uint32_t * p) const { _mm256_storeu_si256((__m256i *)p, v); }
+	friend Int8 operator+(Int8 a, Int8 b) { return {_mm256_add_epi32(a.v, b.v)}; }
+	friend Int8 operator&(Int8 a, Int8 b) { return {_mm256_and_si256(a.v, b.v)}; }
+	friend Int8 operator|(Int8 a, Int8 b) { return {_mm256_or_si256(a.v, b.v)}; }
+	friend Int8 operator<<(Int8 a, int n) { return {_mm256_slli_epi32(a.v, n)}; }
+	// All ones in lanes that are not negative.
+	Int8 positive() const { return {_mm256_cmpgt_epi32(v, _mm256_set1_epi32(-1))}; }
+	int mask() const { return _mm256_movemask_ps(_mm256_castsi256_ps(v)); }
+	static Int8 select(Int8 mask, Int8 a, Int8 b) { return {_mm256_blendv_epi8(b.v, a.v, mask.v)}; }
+};
+struct Float8
+{
+	__m256 v;
+	static Float8 set(float a) { return {_mm256_set1_ps(a)}; }
+	static Float8 ramp() { return {_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)}; }
+	static Float8 load(const float * p) { return {_mm256_loadu_ps(p)}; }
+	void store(float * p) const { _mm256_storeu_ps(p, v); }
+	friend Float8 operator+(Float8 a, Float8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+	friend Float8 operator*(Float8 a, Float8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+	friend Float8 operator/(Float8 a, Float8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+	friend Int8 operator<(Float8 a, Float8 b) { return {_mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ))}; }
+	// Truncated to int after clamping to [0, 255].
+	Int8 byte() const { return {_mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(255.0f)))}; }
+	static Float8 select(Int8 mask, Float8 a, Float8 b) { return {_mm256_blendv_ps(b.v, a.v, _mm256_castsi256_ps(mask.v))}; }
+};
+#else
+struct Int8
+{
+	__m128i lo, hi;
+	static Int8 set(int32_t a) { return {_mm_set1_epi32(a), _mm_set1_epi32(a)}; }
+	static Int8 ramp(int32_t a) { return {_mm_setr_epi32(0, a, 2 * a, 3 * a), _mm_setr_epi32(4 * a, 5 * a, 6 * a, 7 * a)}; }
+	static Int8 load(const uint32_t * p) { return {_mm_loadu_si128((const __m128i *)p), _mm_loadu_si128((const __m128i *)(p + 4))}; }
+	void store(uint32_t * p) const { _mm_storeu_si128((__m128i *)p, lo); _mm_storeu_si128((__m128i *)(p + 4), hi); }
+	friend Int8 operator+(Int8 a, Int8 b) { return {_mm_add_epi32(a.lo, b.lo), _mm_add_epi32(a.hi, b.hi)}; }
+	friend Int8 operator&(Int8 a, Int8 b) { return {_mm_and_si128(a.lo, b.lo), _mm_and_si128(a.hi, b.hi)}; }
+	friend Int8 operator|(Int8 a, Int8 b) { return {_mm_or_si128(a.lo, b.lo), _mm_or_si128(a.hi, b.hi)}; }
+	friend Int8 operator<<(Int8 a, int n) { return {_mm_slli_epi32(a.lo, n), _mm_slli_epi32(a.hi, n)}; }
+	Int8 positive() const { return {_mm_cmpgt_epi32(lo, _mm_set1_epi32(-1)), _mm_cmpgt_epi32(hi, _mm_set1_epi32(-1))}; }
+	int mask() const { return _mm_movemask_ps(_mm_castsi128_ps(lo)) | _mm_movemask_ps(_mm_castsi128_ps(hi)) << 4; }
+	static Int8 select(Int8 mask, Int8 a, Int8 b)
+	{
+		return {_mm_or_si128(_mm_and_si128(mask.lo, a.lo), _mm_andnot_si128(mask.lo, b.lo)),
+			_mm_or_si128(_mm_and_si128(mask.hi, a.hi), _mm_andnot_si128(mask.hi, b.hi))};
+	}
+};
+struct Float8
+{
+	__m128 lo, hi;
+	static Float8 set(float a) { return {_mm_set1_ps(a), _mm_set1_ps(a)}; }
+	static Float8 ramp() { return {_mm_setr_ps(0, 1, 2, 3), _mm_setr_ps(4, 5, 6, 7)}; }
+	static Float8 load(const float * p) { return {_mm_loadu_ps(p), _mm_loadu_ps(p + 4)}; }
+	void store(float * p) const { _mm_storeu_ps(p, lo); _mm_storeu_ps(p + 4, hi); }
+	friend Float8 operator+(Float8 a, Float8 b) { return {_mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi)}; }
+	friend Float8 operator*(Float8 a, Float8 b) { return {_mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi)}; }
+	friend Float8 operator/(Float8 a, Float8 b) { return {_mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi)}; }
+	friend Int8 operator<(Float8 a, Float8 b) { return {_mm_castps_si128(_mm_cmplt_ps(a.lo, b.lo)), _mm_castps_si128(_mm_cmplt_ps(a.hi, b.hi))}; }
+	Int8 byte() const
+	{
+		__m128 zero = _mm_setzero_ps();
+		__m128 top = _mm_set1_ps(255.0f);
+		return {_mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(lo, zero), top)), _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(hi, zero), top))};
+	}
+	static Float8 select(Int8 mask, Float8 a, Float8 b)
+	{
+		__m128 l = _mm_castsi128_ps(mask.lo);
+		__m128 h = _mm_castsi128_ps(mask.hi);
+		return {_mm_or_ps(_mm_and_ps(l, a.lo), _mm_andnot_ps(l, b.lo)), _mm_or_ps(_mm_and_ps(h, a.hi), _mm_andnot_ps(h, b.hi))};
+	}
+};
+#endif
+
+
+// Renders indexed meshes on the CPU, for machines without a GPU. Takes the
+// interleaved vertices of Cube1 and IndexBuffer, position then color, their
+// GLuint indices and the MVP they upload, and follows GL's rules: clipping
+// against -w <= x, y, z <= w, a less-than depth test and perspective correct
+// color. The framebuffer is RGBA8, bottom row first like glReadPixels.
+//
+// A draw runs in three passes on the JobSystem: vertices are transformed in
+// parallel, then chunks of primitives are clipped, set up and binned into
+// 64x64 tiles, each chunk with its own bins, and finally every tile is
+// rasterized by one worker, walking the chunks in order so the result does
+// not depend on the thread count. Triangles are scanned in 8-pixel blocks,
+// edge functions in 28.4 fixed point with a top-left fill rule; lines are
+// stepped along their major axis.
+class SoftRaster
+{
+public:
+	enum Mode
+	{
+		TRIANGLES,
+		LINES
+	};
+	static const int TILE = 64;
+	// Keeps the fixed point edge functions within 32 bits.
+	static const int MAX_SIZE = 1920;
+private:
+	static const int SUBPIXEL = 16;
+
+	// Clip space position and color, what the vertex shader would output.
+	struct ClipVertex
+	{
+		float x, y, z, w;
+		float r, g, b;
+	};
+	// v = c + dx * x + dy * y in pixels.
+	struct Plane
+	{
+		float c, dx, dy;
+	};
+	struct Triangle
+	{
+		int32_t minX, minY, maxX, maxY;
+		// Edge functions a * x + b * y + c in sixteenths of a pixel.
+		int32_t a[3];
+		int32_t b[3];
+		int64_t c[3];
+		// z, 1 / w and color / w.
+		Plane z, w, red, green, blue;
+	};
+	struct Line
+	{
+		int32_t minX, minY, maxX, maxY;
+		float x0, y0, x1, y1;
+		float z0, z1, w0, w1;
+		float c0[3], c1[3];
+	};
+	// The primitives of one range of the index list and, per tile, which of
+	// them touch it.
+	struct Chunk
+	{
+		std::vector<Triangle> triangles;
+		std::vector<Line> lines;
+		std::vector<std::vector<uint32_t> > bins;
+	};
+
+	JobSystem& _jobs;
+	int _width;
+	int _height;
+	int _tilesX;
+	int _tilesY;
+	bool _depthTest;
+	std::vector<uint32_t> _color;
+	std::vector<float> _depth;
+	std::vector<ClipVertex> _clip;
+	std::vector<Chunk> _chunks;
+	std::vector<uint64_t> _tileFragments;
+
+	// The draw in progress.
+	Mode _mode;
+	const float * _vertices;
+	std::size_t _stride;
+	const uint32_t * _indices;
+	std::size_t _primitives;
+	Matrix4f _mvp;
+
+	static void transform(std::size_t begin, std::size_t end, void * context)
+	{
+		SoftRaster * s = static_cast<SoftRaster *>(context);
+		const float * m = s->_mvp._data;
+		for (std::size_t i = begin; i < end; i++)
+		{
+			const float * v = s->_vertices + i * s->_stride;
+			ClipVertex& c = s->_clip[i];
+			c.x = m[0] * v[0] + m[4] * v[1] + m[8] * v[2] + m[12];
+			c.y = m[1] * v[0] + m[5] * v[1] + m[9] * v[2] + m[13];
+			c.z = m[2] * v[0] + m[6] * v[1] + m[10] * v[2] + m[14];
+			c.w = m[3] * v[0] + m[7] * v[1] + m[11] * v[2] + m[15];
+			c.r = v[3];
+			c.g = v[4];
+			c.b = v[5];
+		}
+	}
+
+	// Signed distance to clip plane p, inside when not negative.
+	static float distance(const ClipVertex& v, int p)
+	{
+		switch (p)
+		{
+		case 0: return v.w + v.x;
+		case 1: return v.w - v.x;
+		case 2: return v.w + v.y;
+		case 3: return v.w - v.y;
+		case 4: return v.w + v.z;
+		default: return v.w - v.z;
+		}
+	}
+	static int outcode(const ClipVertex& v)
+	{
+		int code = 0;
+		for (int p = 0; p < 6; p++)
+		{
+			code |= (distance(v, p) < 0) << p;
+		}
+		return code;
+	}
+	static ClipVertex lerp(const ClipVertex& a, const ClipVertex& b, float t)
+	{
+		ClipVertex v;
+		v.x = a.x + (b.x - a.x) * t;
+		v.y = a.y + (b.y - a.y) * t;
+		v.z = a.z + (b.z - a.z) * t;
+		v.w = a.w + (b.w - a.w) * t;
+		v.r = a.r + (b.r - a.r) * t;
+		v.g = a.g + (b.g - a.g) * t;
+		v.b = a.b + (b.b - a.b) * t;
+		return v;
+	}
+	// Window coordinates in pixels, z in [0, 1], then 1 / w and color / w.
+	void window(const ClipVertex& c, float * out) const
+	{
+		float w = 1.0f / c.w;
+		out[0] = (c.x * w * 0.5f + 0.5f) * _width;
+		out[1] = (c.y * w * 0.5f + 0.5f) * _height;
+		out[2] = c.z * w * 0.5f + 0.5f;
+		out[3] = w;
+		out[4] = c.r * w;
+		out[5] = c.g * w;
+		out[6] = c.b * w;
+	}
+	void bin(Chunk& chunk, uint32_t index, int minX, int minY, int maxX, int maxY)
+	{
+		for (int ty = minY / TILE; ty <= maxY / TILE; ty++)
+		{
+			for (int tx = minX / TILE; tx <= maxX / TILE; tx++)
+			{
+				chunk.bins[ty * _tilesX + tx].push_back(index);
+			}
+		}
+	}
+	void setup(Chunk& chunk, const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+	{
+		float p[3][7];
+		window(v0, p[0]);
+		window(v1, p[1]);
+		window(v2, p[2]);
+		int64_t x[3], y[3];
+		for (int i = 0; i < 3; i++)
+		{
+			x[i] = std::llrint(p[i][0] * SUBPIXEL);
+			y[i] = std::llrint(p[i][1] * SUBPIXEL);
+		}
+		int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (area == 0)
+		{
+			return;
+		}
+		// No culling: clockwise triangles are flipped to counterclockwise.
+		int order[3] = {0, 1, 2};
+		if (area < 0)
+		{
+			std::swap(order[1], order[2]);
+			area = -area;
+		}
+		Triangle t;
+		int64_t minX = std::min(x[0], std::min(x[1], x[2]));
+		int64_t minY = std::min(y[0], std::min(y[1], y[2]));
+		int64_t maxX = std::max(x[0], std::max(x[1], x[2]));
+		int64_t maxY = std::max(y[0], std::max(y[1], y[2]));
+		// Pixels whose centers may be covered, clamped to the framebuffer.
+		t.minX = int32_t(std::max<int64_t>((minX - SUBPIXEL / 2 + SUBPIXEL - 1) / SUBPIXEL, 0));
+		t.minY = int32_t(std::max<int64_t>((minY - SUBPIXEL / 2 + SUBPIXEL - 1) / SUBPIXEL, 0));
+		t.maxX = int32_t(std::min<int64_t>((maxX - SUBPIXEL / 2) / SUBPIXEL, _width - 1));
+		t.maxY = int32_t(std::min<int64_t>((maxY - SUBPIXEL / 2) / SUBPIXEL, _height - 1));
+		if (t.minX > t.maxX || t.minY > t.maxY)
+		{
+			return;
+		}
+		for (int e = 0; e < 3; e++)
+		{
+			int i = order[e];
+			int j = order[(e + 1) % 3];
+			int64_t a = y[i] - y[j];
+			int64_t b = x[j] - x[i];
+			// Pixels exactly on an edge belong to the triangle only if it is
+			// a top edge, horizontal with the inside below, or a left edge.
+			bool topLeft = (a == 0 && b < 0) || a > 0;
+			t.a[e] = int32_t(a);
+			t.b[e] = int32_t(b);
+			t.c[e] = -(a * x[i] + b * y[i]) - (topLeft ? 0 : 1);
+		}
+		// Attribute planes from the snapped positions.
+		float fx[3], fy[3];
+		for (int i = 0; i < 3; i++)
+		{
+			fx[i] = float(x[order[i]]) / SUBPIXEL;
+			fy[i] = float(y[order[i]]) / SUBPIXEL;
+		}
+		float inverse = float(SUBPIXEL * SUBPIXEL) / float(area);
+		Plane * planes[5] = {&t.z, &t.w, &t.red, &t.green, &t.blue};
+		int slots[5] = {2, 3, 4, 5, 6};
+		for (int k = 0; k < 5; k++)
+		{
+			float v0 = p[order[0]][slots[k]];
+			float v1 = p[order[1]][slots[k]];
+			float v2 = p[order[2]][slots[k]];
+			Plane& plane = *planes[k];
+			plane.dx = ((v1 - v0) * (fy[2] - fy[0]) - (v2 - v0) * (fy[1] - fy[0])) * inverse;
+			plane.dy = ((v2 - v0) * (fx[1] - fx[0]) - (v1 - v0) * (fx[2] - fx[0])) * inverse;
+			plane.c = v0 - plane.dx * fx[0] - plane.dy * fy[0];
+		}
+		chunk.triangles.push_back(t);
+		bin(chunk, uint32_t(chunk.triangles.size() - 1), t.minX, t.minY, t.maxX, t.maxY);
+	}
+	void triangle(Chunk& chunk, const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+	{
+		int c0 = outcode(v0);
+		int c1 = outcode(v1);
+		int c2 = outcode(v2);
+		if (c0 & c1 & c2)
+		{
+			return;
+		}
+		if ((c0 | c1 | c2) == 0)
+		{
+			setup(chunk, v0, v1, v2);
+			return;
+		}
+		// Sutherland-Hodgman against the planes the triangle crosses, then a
+		// fan of the remaining polygon.
+		ClipVertex buffers[2][9];
+		ClipVertex * in = buffers[0];
+		ClipVertex * out = buffers[1];
+		int count = 3;
+		in[0] = v0;
+		in[1] = v1;
+		in[2] = v2;
+		int crossed = c0 | c1 | c2;
+		for (int p = 0; p < 6 && count >= 3; p++)
+		{
+			if (!(crossed & (1 << p)))
+			{
+				continue;
+			}
+			int n = 0;
+			for (int i = 0; i < count; i++)
+			{
+				const ClipVertex& a = in[i];
+				const ClipVertex& b = in[(i + 1) % count];
+				float da = distance(a, p);
+				float db = distance(b, p);
+				if (da >= 0)
+				{
+					out[n++] = a;
+				}
+				if ((da >= 0) != (db >= 0))
+				{
+					out[n++] = lerp(a, b, da / (da - db));
+				}
+			}
+			std::swap(in, out);
+			count = n;
+		}
+		for (int i = 1; i + 1 < count; i++)
+		{
+			setup(chunk, in[0], in[i], in[i + 1]);
+		}
+	}
+	void line(Chunk& chunk, const ClipVertex& v0, const ClipVertex& v1)
+	{
+		// Liang-Barsky: the parameter range of the segment inside all planes.
+		float t0 = 0;
+		float t1 = 1;
+		for (int p = 0; p < 6; p++)
+		{
+			float d0 = distance(v0, p);
+			float d1 = distance(v1, p);
+			if (d0 < 0 && d1 < 0)
+			{
+				return;
+			}
+			if (d0 < 0)
+			{
+				t0 = std::max(t0, d0 / (d0 - d1));
+			}
+			else if (d1 < 0)
+			{
+				t1 = std::min(t1, d0 / (d0 - d1));
+			}
+		}
+		if (t0 > t1)
+		{
+			return;
+		}
+		float p0[7], p1[7];
+		window(lerp(v0, v1, t0), p0);
+		window(lerp(v0, v1, t1), p1);
+		Line l;
+		l.x0 = p0[0];
+		l.y0 = p0[1];
+		l.x1 = p1[0];
+		l.y1 = p1[1];
+		l.z0 = p0[2];
+		l.z1 = p1[2];
+		l.w0 = p0[3];
+		l.w1 = p1[3];
+		for (int k = 0; k < 3; k++)
+		{
+			l.c0[k] = p0[4 + k];
+			l.c1[k] = p1[4 + k];
+		}
+		l.minX = std::max(int(std::floor(std::min(l.x0, l.x1))) - 1, 0);
+		l.minY = std::max(int(std::floor(std::min(l.y0, l.y1))) - 1, 0);
+		l.maxX = std::min(int(std::floor(std::max(l.x0, l.x1))) + 1, _width - 1);
+		l.maxY = std::min(int(std::floor(std::max(l.y0, l.y1))) + 1, _height - 1);
+		if (l.minX > l.maxX || l.minY > l.maxY)
+		{
+			return;
+		}
+		chunk.lines.push_back(l);
+		bin(chunk, uint32_t(chunk.lines.size() - 1), l.minX, l.minY, l.maxX, l.maxY);
+	}
+	static void assemble(std::size_t begin, std::size_t end, void * context)
+	{
+		SoftRaster * s = static_cast<SoftRaster *>(context);
+		std::size_t chunks = s->_chunks.size();
+		int corners = s->_mode == TRIANGLES ? 3 : 2;
+		for (std::size_t c = begin; c < end; c++)
+		{
+			Chunk& chunk = s->_chunks[c];
+			std::size_t first = s->_primitives * c / chunks;
+			std::size_t last = s->_primitives * (c + 1) / chunks;
+			for (std::size_t p = first; p < last; p++)
+			{
+				const uint32_t * i = s->_indices + p * corners;
+				if (corners == 3)
+				{
+					s->triangle(chunk, s->_clip[i[0]], s->_clip[i[1]], s->_clip[i[2]]);
+				}
+				else
+				{
+					s->line(chunk, s->_clip[i[0]], s->_clip[i[1]]);
+				}
+			}
+		}
+	}
+
+	uint64_t rasterize(const Triangle& t, int tileX, int tileY)
+	{
+		int x0 = std::max(t.minX, tileX) & ~7;
+		int x1 = std::min(t.maxX, tileX + TILE - 1);
+		int y0 = std::max(t.minY, tileY);
+		int y1 = std::min(t.maxY, tileY + TILE - 1);
+		Int8 step[3], ramp[3];
+		for (int e = 0; e < 3; e++)
+		{
+			step[e] = Int8::set(t.a[e] * SUBPIXEL * 8);
+			ramp[e] = Int8::ramp(t.a[e] * SUBPIXEL);
+		}
+		Float8 lane = Float8::ramp() + Float8::set(0.5f);
+		Float8 zdx = Float8::set(t.z.dx), wdx = Float8::set(t.w.dx);
+		Float8 rdx = Float8::set(t.red.dx), gdx = Float8::set(t.green.dx), bdx = Float8::set(t.blue.dx);
+		Int8 alpha = Int8::set(int32_t(0xff000000));
+		uint64_t fragments = 0;
+		for (int y = y0; y <= y1; y++)
+		{
+			int64_t sy = int64_t(y) * SUBPIXEL + SUBPIXEL / 2;
+			int64_t sx = int64_t(x0) * SUBPIXEL + SUBPIXEL / 2;
+			Int8 e[3];
+			for (int k = 0; k < 3; k++)
+			{
+				e[k] = Int8::set(int32_t(t.a[k] * sx + t.b[k] * sy + t.c[k])) + ramp[k];
+			}
+			float cy = y + 0.5f;
+			uint32_t * color = &_color[std::size_t(y) * _width];
+			float * depth = &_depth[std::size_t(y) * _width];
+			for (int x = x0; x <= x1; x += 8)
+			{
+				Int8 covered = (e[0] | e[1] | e[2]).positive();
+				if (covered.mask() != 0)
+				{
+					Float8 px = lane + Float8::set(float(x));
+					Float8 z = Float8::set(t.z.c + t.z.dy * cy) + zdx * px;
+					Int8 pass = covered;
+					if (_depthTest)
+					{
+						Float8 d = Float8::load(depth + x);
+						pass = covered & (z < d);
+						Float8::select(pass, z, d).store(depth + x);
+					}
+					int bits = pass.mask();
+					if (bits != 0)
+					{
+						Float8 w = Float8::set(1.0f) / (Float8::set(t.w.c + t.w.dy * cy) + wdx * px);
+						Float8 scale = w * Float8::set(255.0f);
+						Int8 r = ((Float8::set(t.red.c + t.red.dy * cy) + rdx * px) * scale + Float8::set(0.5f)).byte();
+						Int8 g = ((Float8::set(t.green.c + t.green.dy * cy) + gdx * px) * scale + Float8::set(0.5f)).byte();
+						Int8 b = ((Float8::set(t.blue.c + t.blue.dy * cy) + bdx * px) * scale + Float8::set(0.5f)).byte();
+						Int8 rgba = r | (g << 8) | (b << 16) | alpha;
+						Int8::select(pass, rgba, Int8::load(color + x)).store(color + x);
+						fragments += std::bitset<8>(bits).count();
+					}
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					e[k] = e[k] + step[k];
+				}
+			}
+		}
+		return fragments;
+	}
+	void fragment(int x, int y, float z, float w, const float * c)
+	{
+		std::size_t i = std::size_t(y) * _width + x;
+		if (_depthTest)
+		{
+			if (!(z < _depth[i]))
+			{
+				return;
+			}
+			_depth[i] = z;
+		}
+		uint32_t rgba = 0xff000000;
+		for (int k = 0; k < 3; k++)
+		{
+			float v = std::min(std::max(c[k] / w * 255.0f + 0.5f, 0.0f), 255.0f);
+			rgba |= uint32_t(v) << (8 * k);
+		}
+		_color[i] = rgba;
+	}
+	// One fragment per pixel column (or row, if steeper) whose center lies
+	// in [start, end) of the major axis.
+	uint64_t rasterize(const Line& l, int tileX, int tileY)
+	{
+		float dx = l.x1 - l.x0;
+		float dy = l.y1 - l.y0;
+		bool steep = std::fabs(dy) > std::fabs(dx);
+		float major0 = steep ? l.y0 : l.x0;
+		float length = steep ? dy : dx;
+		if (length == 0)
+		{
+			return 0;
+		}
+		float lo = std::min(major0, major0 + length);
+		float hi = std::max(major0, major0 + length);
+		int first = int(std::ceil(lo - 0.5f));
+		int last = int(std::ceil(hi - 0.5f)) - 1;
+		if (length < 0)
+		{
+			first = int(std::floor(lo - 0.5f)) + 1;
+			last = int(std::floor(hi - 0.5f));
+		}
+		int tileMajor = steep ? tileY : tileX;
+		int limit = steep ? _height : _width;
+		first = std::max(first, std::max(tileMajor, 0));
+		last = std::min(last, std::min(tileMajor + TILE, limit) - 1);
+		uint64_t fragments = 0;
+		for (int m = first; m <= last; m++)
+		{
+			float t = (m + 0.5f - major0) / length;
+			float minor = steep ? l.x0 + t * dx : l.y0 + t * dy;
+			int n = int(std::floor(minor));
+			int x = steep ? n : m;
+			int y = steep ? m : n;
+			if (x < tileX || x >= tileX + TILE || y < tileY || y >= tileY + TILE || x < 0 || x >= _width || y < 0 || y >= _height)
+			{
+				continue;
+			}
+			float c[3];
+			for (int k = 0; k < 3; k++)
+			{
+				c[k] = l.c0[k] + (l.c1[k] - l.c0[k]) * t;
+			}
+			fragment(x, y, l.z0 + (l.z1 - l.z0) * t, l.w0 + (l.w1 - l.w0) * t, c);
+			fragments++;
+		}
+		return fragments;
+	}
+	static void tiles(std::size_t begin, std::size_t end, void * context)
+	{
+		SoftRaster * s = static_cast<SoftRaster *>(context);
+		for (std::size_t tile = begin; tile < end; tile++)
+		{
+			int tileX = int(tile % s->_tilesX) * TILE;
+			int tileY = int(tile / s->_tilesX) * TILE;
+			uint64_t fragments = 0;
+			for (std::size_t c = 0; c < s->_chunks.size(); c++)
+			{
+				const Chunk& chunk = s->_chunks[c];
+				const std::vector<uint32_t>& bin = chunk.bins[tile];
+				for (std::size_t i = 0; i < bin.size(); i++)
+				{
+					if (s->_mode == TRIANGLES)
+					{
+						fragments += s->rasterize(chunk.triangles[bin[i]], tileX, tileY);
+					}
+					else
+					{
+						fragments += s->rasterize(chunk.lines[bin[i]], tileX, tileY);
+					}
+				}
+			}
+			s->_tileFragments[tile] = fragments;
+		}
+	}
+public:
+	// width must be a multiple of 8, both at most MAX_SIZE.
+	SoftRaster(JobSystem& jobs, int width, int height)
+		: _jobs(jobs), _width(width), _height(height), _depthTest(true), _mode(TRIANGLES),
+		_vertices(NULL), _stride(0), _indices(NULL), _primitives(0)
+	{
+		if (width <= 0 || height <= 0 || width % 8 != 0 || width > MAX_SIZE || height > MAX_SIZE)
+		{
+			throw 0;
+		}
+		_tilesX = (width + TILE - 1) / TILE;
+		_tilesY = (height + TILE - 1) / TILE;
+		_color.resize(std::size_t(width) * height);
+		_depth.resize(std::size_t(width) * height);
+		_tileFragments.resize(_tilesX * _tilesY);
+		// A few chunks per worker, so binning balances like the tiles do.
+		_chunks.resize(jobs.size() * 4);
+		for (std::size_t c = 0; c < _chunks.size(); c++)
+		{
+			_chunks[c].bins.resize(_tilesX * _tilesY);
+		}
+	}
+	int width() const
+	{
+		return _width;
+	}
+	int height() const
+	{
+		return _height;
+	}
+	// GL_DEPTH_TEST, on by default. As in GL, depth is only written while
+	// the test is on.
+	void depthTest(bool enable)
+	{
+		_depthTest = enable;
+	}
+	// Color as 0xAABBGGRR, depth 1.
+	void clear(uint32_t rgba = 0xff000000)
+	{
+		std::fill(_color.begin(), _color.end(), rgba);
+		std::fill(_depth.begin(), _depth.end(), 1.0f);
+	}
+	// vertices: vertexCount vertices of stride floats, each starting with
+	// x, y, z, r, g, b. count indices, three per triangle or two per line.
+	void draw(Mode mode, const float * vertices, std::size_t vertexCount, std::size_t stride,
+		const uint32_t * indices, std::size_t count, const Matrix4f& mvp)
+	{
+		_mode = mode;
+		_vertices = vertices;
+		_stride = stride;
+		_indices = indices;
+		_primitives = count / (mode == TRIANGLES ? 3 : 2);
+		_mvp = mvp;
+		_clip.resize(vertexCount);
+		_jobs.parallel_for(vertexCount, transform, this);
+		for (std::size_t c = 0; c < _chunks.size(); c++)
+		{
+			_chunks[c].triangles.clear();
+			_chunks[c].lines.clear();
+			for (std::size_t t = 0; t < _chunks[c].bins.size(); t++)
+			{
+				_chunks[c].bins[t].clear();
+			}
+		}
+		_jobs.parallel_for(_chunks.size(), assemble, this, 1);
+		_jobs.parallel_for(_tileFragments.size(), tiles, this, 1);
+	}
+	// Fragments written by the last draw.
+	uint64_t fragments() const
+	{
+		uint64_t sum = 0;
+		for (std::size_t i = 0; i < _tileFragments.size(); i++)
+		{
+			sum += _tileFragments[i];
+		}
+		return sum;
+	}
+	const uint32_t * pixels() const
+	{
+		return &_color[0];
+	}
+	const float * depth() const
+	{
+		return &_depth[0];
+	}
+};
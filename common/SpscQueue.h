@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. SIZE must be a power of two. Head and tail live on their own cache
+// lines so the two threads only share a line when they touch the same item.
+template <typename T, unsigned SIZE>
+class SpscQueue
+{
+	static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+private:
+	alignas(64) std::atomic<unsigned> _head;
+	alignas(64) std::atomic<unsigned> _tail;
+	alignas(64) T _items[SIZE];
+public:
+	SpscQueue() : _head(0), _tail(0)
+	{}
+	// Producer only. Returns false if the queue is full.
+	bool push(const T& item)
+	{
+		unsigned tail = _tail.load(std::memory_order_relaxed);
+		if (tail - _head.load(std::memory_order_acquire) == SIZE)
+		{
+			return false;
+		}
+		_items[tail & (SIZE - 1)] = item;
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+	// Consumer only. Returns false if the queue is empty.
+	bool pop(T& item)
+	{
+		unsigned head = _head.load(std::memory_order_relaxed);
+		if (head == _tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		item = _items[head & (SIZE - 1)];
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+	// Exact only when called from the producer or the consumer.
+	unsigned size() const
+	{
+		return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+	}
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+
+// sin, cos and tan usable in constant expressions, so matrices built from
+// constant angles are computed by the compiler. Evaluated in double after a
+// Cody-Waite reduction to [-pi/4, pi/4], the float results match a correctly
+// rounded libm for |a| < 1e6 and are the same on every platform. Larger
+// arguments lose precision in the reduction.
+class Trig
+{
+public:
+	static constexpr double PI = 3.14159265358979323846;
+private:
+	static constexpr double PI_2_HI = 1.57079632673412561417;
+	static constexpr double PI_2_LO = 6.07710050650619224932e-11;
+
+	// Taylor series, the first omitted term is below 1e-16 on [-pi/4, pi/4].
+	static constexpr double sinKernel(double x)
+	{
+		double x2 = x * x;
+		return x * (1.0 + x2 * (-1.0 / 6 + x2 * (1.0 / 120 + x2 * (-1.0 / 5040 + x2 * (1.0 / 362880
+			+ x2 * (-1.0 / 39916800 + x2 * (1.0 / 6227020800.0 + x2 * (-1.0 / 1307674368000.0))))))));
+	}
+	static constexpr double cosKernel(double x)
+	{
+		double x2 = x * x;
+		return 1.0 + x2 * (-1.0 / 2 + x2 * (1.0 / 24 + x2 * (-1.0 / 720 + x2 * (1.0 / 40320
+			+ x2 * (-1.0 / 3628800 + x2 * (1.0 / 479001600.0 + x2 * (-1.0 / 87178291200.0
+			+ x2 * (1.0 / 20922789888000.0))))))));
+	}
+	// a = quadrant * pi/2 + r with r in [-pi/4, pi/4].
+	static constexpr double reduce(double a, long long& quadrant)
+	{
+		double k = a * (2.0 / PI);
+		quadrant = static_cast<long long>(k >= 0 ? k + 0.5 : k - 0.5);
+		return (a - quadrant * PI_2_HI) - quadrant * PI_2_LO;
+	}
+public:
+	static constexpr float sin(float a)
+	{
+		long long quadrant = 0;
+		double r = reduce(a, quadrant);
+		switch (quadrant & 3)
+		{
+		case 0: return float(sinKernel(r));
+		case 1: return float(cosKernel(r));
+		case 2: return float(-sinKernel(r));
+		default: return float(-cosKernel(r));
+		}
+	}
+	static constexpr float cos(float a)
+	{
+		long long quadrant = 0;
+		double r = reduce(a, quadrant);
+		switch (quadrant & 3)
+		{
+		case 0: return float(cosKernel(r));
+		case 1: return float(-sinKernel(r));
+		case 2: return float(-cosKernel(r));
+		default: return float(sinKernel(r));
+		}
+	}
+	static constexpr float tan(float a)
+	{
+		long long quadrant = 0;
+		double r = reduce(a, quadrant);
+		double s = sinKernel(r);
+		double c = cosKernel(r);
+		return float(quadrant & 1 ? -c / s : s / c);
+	}
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "GL.h"
+#include "Matrix4f.h"
+
+
+template <GLuint ID>
+class Uniform
+{
+public:
+	static void matrix4f(const Matrix4f& m)
+	{
+		glUniformMatrix4fv(ID, 1, GL_FALSE, m._data);
+	}
+};
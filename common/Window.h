@@ -0,0 +1,75 @@
+#pragma once
+
+#include "GL.h"
+
+#include <cstddef>
+
+
+class Window
+{
+private:
+	GLFWwindow * _window;
+public:
+	void static init()
+	{
+		if (glfwInit() == GL_FALSE)
+		{
+			throw 0;
+		}
+	}
+	void static terminate()
+	{
+		glfwTerminate();
+	}
+	void static events()
+	{
+		glfwPollEvents();
+	}
+	Window(int width, int height, const char * title)
+	{
+		_window = glfwCreateWindow(width, height, title, NULL, NULL);
+		if (_window == NULL)
+		{
+			terminate();
+			throw 0;
+		}
+	}
+	// A window whose context shares objects with the context of share.
+	Window(int width, int height, const char * title, const Window& share)
+	{
+		_window = glfwCreateWindow(width, height, title, NULL, share._window);
+		if (_window == NULL)
+		{
+			terminate();
+			throw 0;
+		}
+	}
+	void current()
+	{
+		glfwMakeContextCurrent(_window);
+#ifdef USE_GLEW
+		if (glewInit() != GLEW_OK)
+		{
+			destroy();
+			terminate();
+			throw 0;
+		}
+#endif
+	}
+	bool closing() const
+	{
+		return glfwWindowShouldClose(_window);
+	}
+	void swap() const
+	{
+		glfwSwapBuffers(_window);
+	}
+	void destroy()
+	{
+		glfwDestroyWindow(_window);
+	}
+	GLFWwindow * handle() const
+	{
+		return _window;
+	}
+};
@@ -0,0 +1,13 @@
+#version 430
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) uniform mat4 mvp;
+
+out vec3 vertexColor;
+
+void main()
+{
+	vertexColor = color;
+	gl_Position = mvp * vec4(position, 1.0);
+}